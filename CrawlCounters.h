@@ -0,0 +1,72 @@
+#ifndef CRAWL_COUNTERS_H
+#define CRAWL_COUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+
+// every crawl counter, as X(id, metric, labelName, labelValue, help). a line here
+// is all a new counter needs: it gets a Counter id, a slot in every worker's
+// block and a metric, with no getter or incrementer to write. consecutive lines
+// with the same metric are one labelled family, which takes the first line's help
+#define CRAWL_COUNTERS(X) \
+    X(ExtractedURLs, "extracted_urls_total", nullptr, nullptr, "URLs taken off the queues for crawling") \
+    X(UniqueHosts, "unique_hosts_total", nullptr, nullptr, "URLs with a host not seen before") \
+    X(DNSLookups, "dns_lookups_total", nullptr, nullptr, "hosts resolved to an address") \
+    X(UniqueIPs, "unique_ips_total", nullptr, nullptr, "hosts with an address not seen before") \
+    X(RobotsChecked, "robots_checked_total", nullptr, nullptr, "robots.txt responses fetched and compiled") \
+    X(RobotsPassed, "robots_passed_total", nullptr, nullptr, "pages their site's robots.txt allowed") \
+    X(PagesCrawled, "pages_crawled_total", nullptr, nullptr, "page responses received, whatever their status") \
+    X(TotalLinks, "links_total", nullptr, nullptr, "links extracted from 2xx pages") \
+    X(TotalBytes, "bytes_total", nullptr, nullptr, "bytes of page responses received") \
+    X(Http2xx, "http_responses_total", "code", "2xx", "page responses by status class") \
+    X(Http3xx, "http_responses_total", "code", "3xx", nullptr) \
+    X(Http4xx, "http_responses_total", "code", "4xx", nullptr) \
+    X(Http5xx, "http_responses_total", "code", "5xx", nullptr) \
+    X(HttpOther, "http_responses_total", "code", "other", nullptr)
+
+enum class Counter {
+#define COUNTER_ID(id, metric, labelName, labelValue, help) id,
+    CRAWL_COUNTERS(COUNTER_ID)
+#undef COUNTER_ID
+};
+
+#define COUNTER_ONE(id, metric, labelName, labelValue, help) +1
+constexpr int COUNTER_COUNT = 0 CRAWL_COUNTERS(COUNTER_ONE);
+#undef COUNTER_ONE
+
+struct CounterInfo {
+    const char* metric;
+    const char* labelName;   // nullptr if the metric has no label
+    const char* labelValue;
+    const char* help;
+};
+
+inline const CounterInfo& counterInfo(Counter counter) {
+    static const CounterInfo info[COUNTER_COUNT] = {
+#define COUNTER_INFO(id, metric, labelName, labelValue, help) { metric, labelName, labelValue, help },
+        CRAWL_COUNTERS(COUNTER_INFO)
+#undef COUNTER_INFO
+    };
+    return info[(int)counter];
+}
+
+// one worker's counters, 64-bit and on cache lines of their own, so counting
+// never moves a line between cores. only the owning worker writes them, with a
+// relaxed load and store instead of a locked add; the stats thread and scrapes
+// sum every worker's block
+struct alignas(64) WorkerCounters {
+    std::atomic<uint64_t> values[COUNTER_COUNT];
+
+    WorkerCounters() {
+        for (std::atomic<uint64_t>& value : values) {
+            value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void add(Counter counter, uint64_t n) {
+        std::atomic<uint64_t>& value = values[(int)counter];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+#endif // CRAWL_COUNTERS_H
@@ -1,453 +1,717 @@
 #include "Crawler.h"
-#include "HTMLParserBase.h"
 #include "Socket.h"
 #include "Utility.h"
+#include "DNSResolver.h"
+#ifdef __linux__
+#include "EpollEngine.h"
+#endif
 
 #include <cstdio>
-#include <regex>
-#include <fstream>
+#include <cstring>
+#include <climits>
+#include <vector>
 #include <algorithm>
 
-Crawler::Crawler(int numThreads) {
-    InitializeCriticalSection(&queueCriticalSection);
-    InitializeCriticalSection(&hostCriticalSection);
-    InitializeCriticalSection(&ipCriticalSection);
+Crawler::Crawler(const CrawlerOptions& options) : options(options), dnsCache(options.dnsNegativeTtl), robotsCache(ROBOTS_CACHE_HOSTS), urlQueues(options.numThreads, options.frontierSize), seenIPs(options.ipSet) {
+    activeThreads = options.numThreads;
+    shutdown = false;
 
+    // options already validated an explicit server, so only resolv.conf can fail here
+    useResolver = false;
+    if (options.dnsServer != "system") {
+        useResolver = DNSResolver::parseServer(options.dnsServer, dnsServer);
+        if (!useResolver) {
+            printf("No IPv4 nameserver in /etc/resolv.conf, falling back to getaddrinfo\n");
+        }
+    }
 
-    // create a manual reset event for signaling shutdown
-    eventQuit = CreateEvent(NULL, TRUE, FALSE, NULL); // manual reset event, initially non signaled
-    if (eventQuit == NULL) {
-        std::cerr << "CreateEvent failed with error: " << GetLastError() << std::endl;
-        exit(EXIT_FAILURE);
+    // --classify sets were validated by parseOptions, so none is refused here
+    for (const DomainRuleSet& set : options.domainSets) {
+        domains.addRuleSet(set.name, set.suffixes);
     }
+    domainHits.reset(new DomainCounters[domains.getSetCount()]);
+    latency.reset(new WorkerLatency[options.numThreads]);
+    counters.reset(new WorkerCounters[options.numThreads]);
+
+    // a recursive crawl with politeness goes past a host's first page: the frontier
+    // dedupes links rather than hosts, the scheduler spaces the pages out on the
+    // host's IP (with its Crawl-delay) and robots.txt is fetched once. without
+    // politeness nothing would space them, so each host still gets one page
+    revisitHosts = options.maxDepth > 0 && options.politenessMs > 0;
+
+    // recursive crawls replace the seed-only queues with a priority frontier
+    if (options.maxDepth > 0) {
+        long maxFrontier = options.maxFrontier;
+        if (maxFrontier == 0) {
+            maxFrontier = options.spillDir.empty() ? 1000000 : LONG_MAX;
+        }
+        frontier.reset(new Frontier(FrontierPriority::create(options.order), seen, revisitHosts ? FrontierDedupe::URL : FrontierDedupe::Host,
+            options.numThreads, options.frontierSize, maxFrontier));
 
-    extractedURLs = 0;
-    uniqueHosts = 0;
-    dnsLookups = 0;
-    uniqueIPs = 0;
-    robotsChecked = 0;
-    robotsPassed = 0;
-    pagesCrawled = 0;
-    totalLinks = 0;
-    totalBytes = 0;
-    http2xx = 0;
-    http3xx = 0;
-    http4xx = 0;
-    http5xx = 0;
-    httpOther = 0;
-
-    tamuLinkPages = 0;
-    tamuLinkPagesExternal = 0;
-
-    activeThreads = numThreads;
-    shutdown = false;
+        if (!options.spillDir.empty() && !frontier->enableSpill(options.spillDir, (long)options.frontierRamMb * 1024 * 1024)) {
+            printf("Cannot write to %s, keeping the frontier in memory\n", options.spillDir.c_str());
+        }
+    }
+
+    if (options.politenessMs > 0) {
+        politeness.reset(new PolitenessScheduler(options.politenessMs, options.frontierSize));
+    }
+
+    if (!options.warcPrefix.empty()) {
+        warc.reset(new WarcWriter(options.warcPrefix, (long long)options.warcSizeMb * 1024 * 1024, (size_t)options.warcQueueMb * 1024 * 1024,
+            options.http != HTTPMode::Close));
+        if (!warc->start()) {
+            printf("Cannot write WARC files to %s, not archiving\n", options.warcPrefix.c_str());
+            warc.reset();
+        }
+    }
 
     // timer starts in Crawler::StatsThread
 }
 
 Crawler::~Crawler() {
-    // delete critical sections
-    DeleteCriticalSection(&queueCriticalSection);
-    DeleteCriticalSection(&hostCriticalSection);
-    DeleteCriticalSection(&ipCriticalSection);
-
-    // close event handle
-    CloseHandle(eventQuit);
 }
 
-// could be a thread but kinda pointless, only takes a few seconds to pre-load 1M
 void Crawler::ReadFile(const std::string& filename) {
-    // read URLs from the file and populate the queue
-    std::ifstream inputFile(filename);
-    if (!inputFile.is_open()) {
+    if (!seeds.open(filename)) {
         std::cerr << "Failed to open file: " << filename << std::endl;
         exit(EXIT_FAILURE);
     }
-    // if opened successfully, get size and set pointer position back to start of file
-    inputFile.seekg(0, std::ios::end);
-    std::streamsize fileSize = inputFile.tellg();
-    inputFile.seekg(0, std::ios::beg);
-    printf("Opened %s with size %lld\n", filename.c_str(), fileSize);
+    printf("Opened %s with size %lld%s\n", filename.c_str(), seeds.getFileSize(), seeds.isCompressed() ? " (gzip)" : "");
+}
 
-    std::string line;
-    while (std::getline(inputFile, line)) {
-        // trim the line
-        line.erase(line.find_last_not_of(" \n\r\t") + 1);
-        line.erase(0, line.find_first_not_of(" \n\r\t"));
-        urlQueue.push(line);
+// producer: stream seed URLs into the queues as fast as workers drain them,
+// so crawling starts at once and only --frontier URLs are ever held in memory
+void Crawler::SeedRun() {
+    std::string_view line;
+    if (frontier) {
+        while (seeds.nextLine(line)) {
+            frontier->waitForRoom();
+            frontier->pushSeed(std::string(line));
+        }
+        seeds.close();
+        frontier->close();
+        return;
     }
 
-    // queueSemaphore = CreateSemaphore(NULL, urlQueue.size(), urlQueue.size(), NULL);
-    inputFile.close();
-}
+    // deal the URLs out round-robin so every worker gets its own share
+    int worker = 0;
+    while (seeds.nextLine(line)) {
+        urlQueues.waitForRoom();
+        urlQueues.push(worker, std::string(line));
+        worker = (worker + 1) % urlQueues.getNumWorkers();
+    }
 
+    seeds.close();
+    urlQueues.close();
+}
 
-// entrypoint for Crawler Threads
-void Crawler::Run() {
-    HTMLParserBase* parser = new HTMLParserBase;
-    Socket socket;
-    std::string url, scheme, host, request, response;
-    int port, statusCode;
-    size_t limit;
+bool Crawler::popURL(int worker, std::string& url, int& depth) {
+    if (frontier) {
+        return frontier->pop(url, depth);
+    }
+    depth = 0;
+    return urlQueues.pop(worker, url);
+}
 
-    char ipBuffer[INET_ADDRSTRLEN]; // buffer to hold IP address string
-    const std::regex tamuRegex(R"(^https?://([a-zA-Z0-9-]+\.)*tamu\.edu(/|$))");
-    const std::regex internalTAMURegex(R"(^([a-zA-Z0-9-]+\.)*tamu\.edu$)");
-    bool containsTAMULink = false;
-
-    while (true) {
-        // check if queue is empty and safely pop a value
-        EnterCriticalSection(&queueCriticalSection);
-        if (urlQueue.empty()) {
-            LeaveCriticalSection(&queueCriticalSection);
-            break; // finished crawling
-        }
-        url = urlQueue.front();
-        urlQueue.pop();
-        LeaveCriticalSection(&queueCriticalSection);
+bool Crawler::tryPopURL(int worker, std::string& url, int& depth) {
+    if (frontier) {
+        return frontier->tryPop(url, depth);
+    }
+    depth = 0;
+    return urlQueues.tryPop(worker, url);
+}
 
-        InterlockedIncrement(&extractedURLs);
+bool Crawler::admitURL(int worker, const std::string& url, Socket& socket, std::string& host, int& port, std::string& request) {
+    if (!admitHost(worker, url, host, port, request)) {
+        return false;
+    }
 
-        // process the URL
-        if (!parseURL(url, scheme, host, port, request)) {
-            // invalid URL, skip
-            // std::cout << "Invalid URL: " << url << std::endl;
-            continue;
-        }
+    auto start = std::chrono::steady_clock::now();
+    bool resolved = socket.resolveDNS(host);
+    recordLatency(worker, Stage::Resolve, start);
+    if (!resolved) {
+        // DNS failed
+        return false;
+    }
+    return admitAddress(worker, socket.getResolvedAddress());
+}
 
-        if (!checkAndInsertHost(host)) {
-            // host already seen, skip
-            continue;
-        }
-        InterlockedIncrement(&uniqueHosts);
+bool Crawler::admitHost(int worker, const std::string& url, std::string& host, int& port, std::string& request) {
+    URLParts parts;
 
-        if (!socket.resolveDNS(host)) {
-            // DNS failed
-            continue;
-        }
-        InterlockedIncrement(&dnsLookups);
+    count(worker, Counter::ExtractedURLs);
 
-        // get IP address as string using inet_ntop
-        in_addr resolvedAddr = socket.getResolvedAddress();
-        if (inet_ntop(AF_INET, &resolvedAddr, ipBuffer, INET_ADDRSTRLEN) == NULL) {
-            std::cerr << "inet_ntop failed with error: " << WSAGetLastError() << std::endl;
-            continue;
-        }
-        std::string ipAddrStr(ipBuffer);
+    // process the URL
+    if (!parseURL(url, parts)) {
+        // invalid URL, skip
+        // std::cout << "Invalid URL: " << url << std::endl;
+        return false;
+    }
 
-        if (!checkAndInsertIP(ipAddrStr)) {
-            // IP already seen, skip
-            continue;
-        }
-        
-        InterlockedIncrement(&uniqueIPs);
+    // assign() reuses the callers' capacity, so steady state does not allocate
+    host.assign(parts.host);
+    port = parts.port;
+    request.assign(parts.request);
 
-        // connect for robots
-        if (!socket.connect(host, port)) {
-            continue;
-        }
+    if (!checkAndInsertHost(host)) {
+        // host already seen: skip, unless this is a later page the frontier let through
+        return revisitHosts;
+    }
+    count(worker, Counter::UniqueHosts);
+    return true;
+}
 
-        // send request to server for robots
-        if (!socket.sendHTTPRequest(host, "/robots.txt", "HEAD")) {
-            continue;
-        }
+bool Crawler::admitAddress(int worker, in_addr addr) {
+    count(worker, Counter::DNSLookups);
 
-        // receive and parse robots response
-        limit = 16 * 1024; // 16kb download limit for 'HEAD /robots.txt'
-        if (!socket.receiveResponse(response, statusCode, limit)) {
-            continue;
-        }
-        InterlockedIncrement(&robotsChecked);
+    if (!checkAndInsertIP(addr)) {
+        // IP already seen: skip, unless the politeness scheduler spaces its hosts out instead
+        return politeness != nullptr;
+    }
 
-        // robots status code check
-        if (statusCode < 400 || statusCode >= 500) {
-            continue;
-        }
-        InterlockedIncrement(&robotsPassed);
+    count(worker, Counter::UniqueIPs);
+    return true;
+}
 
-        // download the page if robots passed
-        if (!socket.connect(host, port)) {
-            continue;
-        }
-        if (!socket.sendHTTPRequest(host, request, "GET")) {
-            continue;
-        }
+bool Crawler::initResolver(DNSResolver& resolver) {
+    return useResolver && resolver.init(dnsServer, options.dnsTimeoutMs, options.dnsRetries);
+}
 
-        // if we successfully get a response at all it's "crawled"
-        limit = 2 * 1024 * 1024; // 2MB limit for actual page
-        if (!socket.receiveResponse(response, statusCode, limit)) {
-            continue;
-        }
-        InterlockedAdd(&totalBytes, (static_cast<LONG>(response.length())));
+DNSCache& Crawler::getDNSCache() {
+    return dnsCache;
+}
 
-        // increment the appropriate HTTP code, parse if valid response
-        if (statusCode >= 200 && statusCode < 300) {
-            InterlockedIncrement(&http2xx);
+HTTPMode Crawler::getHTTPMode() const {
+    return options.http;
+}
 
-            // parse page and extract links
-            size_t headerEnd = response.find("\r\n\r\n");
-            int nLinks = 0;
+PolitenessScheduler* Crawler::getPoliteness() {
+    return politeness.get();
+}
 
-            if (headerEnd != std::string::npos) {
-                std::string htmlBody = response.substr(headerEnd + 4);
+static std::string robotsSite(const std::string& host, int port) {
+    return port == 80 ? host : host + ":" + std::to_string(port);
+}
 
-                // for mem safety
-                std::vector<char> modifiableHtmlBody(htmlBody.begin(), htmlBody.end());
-                modifiableHtmlBody.push_back('\0'); // null terminate
+std::shared_ptr<const RobotsRules> Crawler::findRobots(const std::string& host, int port) {
+    return robotsCache.lookup(robotsSite(host, port));
+}
 
-                std::string baseUrlStr = "http://" + host;
-                std::vector<char> baseUrl(baseUrlStr.begin(), baseUrlStr.end());
-                baseUrl.push_back('\0'); // null terminate
+std::shared_ptr<const RobotsRules> Crawler::addRobots(int worker, const std::string& host, int port, in_addr addr, std::chrono::steady_clock::time_point started,
+    const HTTPResponse& response) {
+    count(worker, Counter::RobotsChecked);
+    archive(host, port, "/robots.txt", addr, started, response);
+    std::shared_ptr<const RobotsRules> rules = RobotsRules::fromResponse(response, ROBOTS_AGENT);
+    robotsCache.insert(robotsSite(host, port), rules);
+    return rules;
+}
 
-                char* linkBuffer = parser->Parse((char*)htmlBody.c_str(), (int)htmlBody.length(), (char*)baseUrlStr.c_str(), (int)(baseUrl.size()), &nLinks);
-                if (nLinks < 0) {
-                    nLinks = 0;
-                }
-                InterlockedAdd(&totalLinks, nLinks);
+void Crawler::processPage(int worker, LinkArena& links, const std::string& host, int port, const std::string& request, int depth, in_addr addr,
+    std::chrono::steady_clock::time_point started, const HTTPResponse& response) {
+    int statusCode = response.statusCode;
 
-                /* this is expensive for some reason
-                // scan for tamu links
-                containsTAMULink = false;
+    // copied out before the links are extracted, while the buffer is still as received
+    archive(host, port, request, addr, started, response);
 
-                for (int i = 0; i < nLinks; i++) {
-                    std::string extractedLink = std::string(linkBuffer + i);
+    // increment the appropriate HTTP code, parse if valid response
+    if (statusCode >= 200 && statusCode < 300) {
+        count(worker, Counter::Http2xx);
+
+        // scan the body in place in the socket buffer and extract links
+        if (!response.body.empty()) {
+            // relative links resolve against the page itself, minus its query string
+            std::string baseUrlStr = "http://" + host;
+            if (port != 80) {
+                baseUrlStr += ":" + std::to_string(port);
+            }
+            baseUrlStr.append(request, 0, request.find('?'));
 
-                    // use regex to match TAMU URLs
-                    if (std::regex_match(extractedLink, tamuRegex)) {
-                        containsTAMULink = true;
-                        break; // all we want to know is how many pages have a link, not how many links
-                    }
-                }
+            auto start = std::chrono::steady_clock::now();
+            links.clear();
+            int nLinks = linkExtractor.extract(response.body, baseUrlStr, links);
+            recordLatency(worker, Stage::Parse, start);
+            count(worker, Counter::TotalLinks, nLinks);
 
-                // increment counters
-                if (containsTAMULink) {
-                    InterlockedIncrement(&tamuLinkPages);
+            // recursive crawls queue the links unless the page is as deep as they go
+            if (frontier && depth < options.maxDepth) {
+                queueLinks(links, depth + 1);
+            }
 
-                    // determine if the originating page is external to TAMU
-                    if (!std::regex_match(host, internalTAMURegex)) {
-                        InterlockedIncrement(&tamuLinkPagesExternal);
-                    }
-                }
-                */
+            if (domains.getSetCount() > 0) {
+                classifyLinks(host, links);
             }
         }
-        else if (statusCode >= 300 && statusCode < 400) {
-            InterlockedIncrement(&http3xx);
-        }
-        else if (statusCode >= 400 && statusCode < 500) {
-            InterlockedIncrement(&http4xx);
-        }
-        else if (statusCode >= 500 && statusCode < 600) {
-            InterlockedIncrement(&http5xx);
-        }
-        else {
-            InterlockedIncrement(&httpOther);
-        }
-
-        InterlockedAdd(&totalBytes, (static_cast<LONG>(response.length())));
-        InterlockedIncrement(&pagesCrawled);
+    }
+    else if (statusCode >= 300 && statusCode < 400) {
+        count(worker, Counter::Http3xx);
+    }
+    else if (statusCode >= 400 && statusCode < 500) {
+        count(worker, Counter::Http4xx);
+    }
+    else if (statusCode >= 500 && statusCode < 600) {
+        count(worker, Counter::Http5xx);
+    }
+    else {
+        count(worker, Counter::HttpOther);
     }
 
-    delete parser;
-    socket.close();
-    InterlockedDecrement(&activeThreads);
+    count(worker, Counter::TotalBytes, response.raw.length());
+    count(worker, Counter::PagesCrawled);
 }
 
-void Crawler::signalShutdown() {
-    shutdown = true;
-    // signal the event to notify the stats thread
-    SetEvent(eventQuit);
+void Crawler::archive(const std::string& host, int port, const std::string& path, in_addr addr, std::chrono::steady_clock::time_point started,
+    const HTTPResponse& response) {
+    if (warc) {
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+        warc->add(host, port, path, addr, (uint64_t)micros, response.raw);
+    }
 }
 
-LARGE_INTEGER Crawler::getStartTime() {
-    return startTime;
-}
+void Crawler::classifyLinks(const std::string& host, const LinkArena& links) {
+    // tallied per page on the stack, then added to the shared counters once
+    long counts[DOMAIN_MAX_SETS] = {};
+    uint64_t pageSets = 0;
 
-void Crawler::decrementActiveThreads() {
-    InterlockedDecrement(&activeThreads);
-}
+    const char* link = links.bytes.data();
+    for (int i = 0; i < links.count; i++) {
+        std::string_view url(link);
+        uint64_t sets = domains.match(DomainMatcher::hostOf(url));
+        pageSets |= sets;
+        for (int set = 0; sets != 0; set++, sets >>= 1) {
+            counts[set] += sets & 1;
+        }
+        link += url.size() + 1;
+    }
+    if (pageSets == 0) {
+        return;
+    }
 
-int Crawler::getActiveThreads() {
-    return InterlockedCompareExchange(&activeThreads, 0, 0);
+    uint64_t ownSets = domains.match(host);
+    for (int set = 0; set < domains.getSetCount(); set++) {
+        if (pageSets & (1ull << set)) {
+            domainHits[set].links += counts[set];
+            domainHits[set].pages++;
+            if (!(ownSets & (1ull << set))) {
+                domainHits[set].externalPages++;
+            }
+        }
+    }
 }
 
-// update stats methods using interlocked functions
-void Crawler::incrementExtractedURLs() {
-    InterlockedIncrement(&extractedURLs);
+void Crawler::queueLinks(const LinkArena& links, int depth) {
+    // one batch per page, so the frontier lock is taken once per page rather than per link
+    static thread_local std::vector<FrontierLink> batch;
+    URLParts parts;
+
+    // the arena holds count null-terminated URLs back to back
+    const char* link = links.bytes.data();
+    for (int i = 0; i < links.count; i++) {
+        size_t length = strlen(link);
+        if (parseURL(std::string_view(link, length), parts)) {
+            FrontierLink entry;
+            entry.url.reserve(7 + parts.host.size() + 6 + parts.request.size());
+            entry.url.append("http://").append(parts.host);
+            if (parts.port != 80) {
+                entry.url.append(":").append(std::to_string(parts.port));
+            }
+            entry.url.append(parts.request);
+            entry.hostLength = parts.host.size();
+            entry.depth = depth;
+            batch.push_back(std::move(entry));
+        }
+        link += length + 1;
+    }
+    frontier->push(batch);
 }
 
-void Crawler::incrementUniqueHosts() {
-    InterlockedIncrement(&uniqueHosts);
-}
+// entrypoint for Crawler Threads
+void Crawler::Run(int worker) {
+    LinkArena links;
+    Socket socket;
+    DNSResolver resolver;
+    std::string url, host, request;
+    HTTPResponse response;
+    int port, depth;
+
+#ifdef __linux__
+    if (options.io == IOBackend::Uring && !socket.enableUring()) {
+        printf("io_uring setup failed, falling back to blocking sockets\n");
+    }
+#endif
 
-void Crawler::incrementDNSLookups() {
-    InterlockedIncrement(&dnsLookups);
-}
+    // each thread owns its resolver, so lookups here still wait but skip the libc resolver
+    if (initResolver(resolver)) {
+        socket.setResolver(&resolver);
+    }
+    socket.setCache(&dnsCache);
+    socket.setKeepAlive(options.http != HTTPMode::Close);
 
-void Crawler::incrementUniqueIPs() {
-    InterlockedIncrement(&uniqueIPs);
-}
+    if (!politeness) {
+        while (popURL(worker, url, depth)) {
+            if (admitURL(worker, url, socket, host, port, request)) {
+                crawlHost(worker, socket, links, host, port, request, depth, response);
+            }
+        }
+    }
+    else {
+        // crawl whatever host is eligible now, otherwise resolve more URLs into the
+        // scheduler; only sleep when every queued host is waiting on its IP
+        CrawlJob job;
+        while (true) {
+            if (politeness->tryNext(job)) {
+                // the job may come from another worker or a cooldown, so dial the address it was resolved to
+                socket.setResolvedAddress(job.addr);
+                int crawlDelayMs = crawlHost(worker, socket, links, job.host, job.port, job.request, job.depth, response);
+                politeness->done(job.addr, crawlDelayMs);
+                continue;
+            }
 
-void Crawler::incrementRobotsChecked() {
-    InterlockedIncrement(&robotsChecked);
-}
+            bool popped = false;
+            if (politeness->hasRoom()) {
+                popped = tryPopURL(worker, url, depth);
+                if (!popped && politeness->pending() == 0) {
+                    // nothing held anywhere, so wait for the seed producer
+                    if (!popURL(worker, url, depth)) {
+                        break;
+                    }
+                    popped = true;
+                }
+            }
+            if (!popped) {
+                politeness->wait(POLITENESS_WAIT_MS);
+                continue;
+            }
 
-void Crawler::incrementRobotsPassed() {
-    InterlockedIncrement(&robotsPassed);
-}
+            if (admitURL(worker, url, socket, host, port, request)) {
+                job.host = host;
+                job.port = port;
+                job.request = request;
+                job.depth = depth;
+                job.addr = socket.getResolvedAddress();
+                politeness->submit(std::move(job));
+            }
+        }
+    }
 
-void Crawler::incrementPagesCrawled() {
-    InterlockedIncrement(&pagesCrawled);
+    socket.close();
+    decrementActiveThreads();
 }
 
-void Crawler::incrementHttpStatus(int statusCode) {
-    if (statusCode >= 200 && statusCode < 300) {
-        InterlockedIncrement(&http2xx);
+int Crawler::crawlHost(int worker, Socket& socket, LinkArena& links, const std::string& host, int port, const std::string& request, int depth, HTTPResponse& response) {
+    // a host whose robots.txt is cached goes straight to the page, and only
+    // connects once the cached rules allow it
+    std::shared_ptr<const RobotsRules> rules = findRobots(host, port);
+    bool fetchRobots = !rules;
+    size_t limit;
+
+    auto start = std::chrono::steady_clock::now();
+    if (fetchRobots) {
+        if (!socket.connect(host, port)) {
+            return 0;
+        }
+        recordLatency(worker, Stage::Connect, start);
+
+        start = std::chrono::steady_clock::now();
+        // send request to server for robots; the page is only requested once they allow it
+        if (!socket.sendHTTPRequest(host, "/robots.txt", "GET")) {
+            return 0;
+        }
+
+        // receive and compile the robots response
+        limit = ROBOTS_LIMIT;
+        if (!socket.receiveResponse(response, limit)) {
+            return 0;
+        }
+        recordLatency(worker, Stage::Robots, start);
+        rules = addRobots(worker, host, port, socket.getResolvedAddress(), start, response);
     }
-    else if (statusCode >= 300 && statusCode < 400) {
-        InterlockedIncrement(&http3xx);
+
+    // check the page against the site's rules
+    if (!rules->allowed(request)) {
+        return rules->getCrawlDelayMs();
     }
-    else if (statusCode >= 400 && statusCode < 500) {
-        InterlockedIncrement(&http4xx);
+    count(worker, Counter::RobotsPassed);
+
+    // download the page, on the robots connection if the server kept it open
+    start = std::chrono::steady_clock::now();
+    if (!fetchRobots || !socket.canReuse()) {
+        if (!socket.connect(host, port)) {
+            return rules->getCrawlDelayMs();
+        }
+        recordLatency(worker, Stage::Connect, start);
+        start = std::chrono::steady_clock::now();
+        if (!socket.sendHTTPRequest(host, request, "GET")) {
+            return rules->getCrawlDelayMs();
+        }
     }
-    else if (statusCode >= 500 && statusCode < 600) {
-        InterlockedIncrement(&http5xx);
+    else if (!socket.sendHTTPRequest(host, request, "GET")) {
+        return rules->getCrawlDelayMs();
     }
-    else {
-        InterlockedIncrement(&httpOther);
+
+    // if we successfully get a response at all it's "crawled"
+    limit = PAGE_LIMIT;
+    if (socket.receiveResponse(response, limit)) {
+        recordLatency(worker, Stage::Page, start);
+        processPage(worker, links, host, port, request, depth, socket.getResolvedAddress(), start, response);
     }
+    return rules->getCrawlDelayMs();
 }
 
-void Crawler::addTotalLinks(LONG links) {
-    InterlockedAdd(&totalLinks, links);
+void Crawler::signalShutdown() {
+    // the workers are done, so this drains everything they archived
+    if (warc) {
+        warc->close();
+    }
+    {
+        std::lock_guard<std::mutex> lock(quitMutex);
+        shutdown = true;
+    }
+    // signal the event to notify the stats thread
+    eventQuit.notify_all();
 }
 
-void Crawler::addTotalBytes(LONG bytes) {
-    InterlockedAdd(&totalBytes, bytes);
+std::chrono::steady_clock::time_point Crawler::getStartTime() {
+    return startTime;
 }
 
-// get stats methods
-LONG Crawler::getExtractedURLs() {
-    return InterlockedCompareExchange(&extractedURLs, 0, 0);
-}
+void Crawler::decrementActiveThreads() {
+    activeThreads--;
 
-LONG Crawler::getUniqueHosts() {
-    return InterlockedCompareExchange(&uniqueHosts, 0, 0);
+    // a worker that is gone can no longer add links, so the frontier stops waiting for it
+    if (frontier) {
+        frontier->leave();
+    }
 }
 
-LONG Crawler::getDNSLookups() {
-    return InterlockedCompareExchange(&dnsLookups, 0, 0);
+int Crawler::getActiveThreads() {
+    return activeThreads.load();
 }
 
-LONG Crawler::getUniqueIPs() {
-    return InterlockedCompareExchange(&uniqueIPs, 0, 0);
+void Crawler::count(int worker, Counter counter, uint64_t n) {
+    counters[worker].add(counter, n);
 }
 
-LONG Crawler::getRobotsChecked() {
-    return InterlockedCompareExchange(&robotsChecked, 0, 0);
+uint64_t Crawler::getCounter(Counter counter) const {
+    uint64_t total = 0;
+    for (int worker = 0; worker < options.numThreads; worker++) {
+        total += counters[worker].values[(int)counter].load(std::memory_order_relaxed);
+    }
+    return total;
 }
 
-LONG Crawler::getRobotsPassed() {
-    return InterlockedCompareExchange(&robotsPassed, 0, 0);
+long Crawler::getQueueSize() {
+    // approximate, so the stats thread never contends with the workers
+    return frontier ? frontier->size() : urlQueues.size();
 }
 
-LONG Crawler::getPagesCrawled() {
-    return InterlockedCompareExchange(&pagesCrawled, 0, 0);
+long Crawler::getFrontierInserted() {
+    return frontier ? frontier->getInserted() : 0;
 }
 
-LONG Crawler::getTotalLinks() {
-    return InterlockedCompareExchange(&totalLinks, 0, 0);
+long Crawler::getFrontierDropped() {
+    return frontier ? frontier->getDropped() : 0;
 }
 
-LONG Crawler::getTotalBytes() {
-    return InterlockedCompareExchange(&totalBytes, 0, 0);
+const WarcWriter* Crawler::getWarc() const {
+    return warc.get();
 }
 
-LONG Crawler::getQueueSize() {
-    EnterCriticalSection(&queueCriticalSection);
-    LONG size = static_cast<LONG>(urlQueue.size());
-    LeaveCriticalSection(&queueCriticalSection);
-    return size;
+const DomainMatcher& Crawler::getDomains() const {
+    return domains;
 }
 
-LONG Crawler::getHttp2xx() {
-    return InterlockedCompareExchange(&http2xx, 0, 0);
+DomainHits Crawler::getDomainHits(int set) const {
+    DomainHits hits;
+    hits.links = domainHits[set].links.load();
+    hits.pages = domainHits[set].pages.load();
+    hits.externalPages = domainHits[set].externalPages.load();
+    return hits;
 }
 
-LONG Crawler::getHttp3xx() {
-    return InterlockedCompareExchange(&http3xx, 0, 0);
+void Crawler::recordLatency(int worker, Stage stage, std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    latency[worker].stages[(int)stage].record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
 }
 
-LONG Crawler::getHttp4xx() {
-    return InterlockedCompareExchange(&http4xx, 0, 0);
+LatencySnapshot Crawler::getLatency(Stage stage) {
+    LatencySnapshot merged;
+    for (int worker = 0; worker < options.numThreads; worker++) {
+        latency[worker].stages[(int)stage].addTo(merged);
+    }
+    return merged;
 }
 
-LONG Crawler::getHttp5xx() {
-    return InterlockedCompareExchange(&http5xx, 0, 0);
+const char* Crawler::stageName(Stage stage) {
+    switch (stage) {
+    case Stage::Resolve: return "dns";
+    case Stage::Connect: return "connect";
+    case Stage::Robots: return "robots";
+    case Stage::Page: return "page";
+    default: return "parse";
+    }
 }
 
-LONG Crawler::getHttpOther() {
-    return InterlockedCompareExchange(&httpOther, 0, 0);
-}
+void Crawler::collectMetrics(std::vector<Metric>& metrics) {
+    auto add = [&metrics](const std::string& name, const char* help, const char* type, double value) {
+        metrics.push_back(Metric{ name, help, type, {}, value });
+    };
+    // a further sample of the family just added, under labels
+    auto addLabelled = [&metrics](const std::string& name, const char* help, const char* type,
+        std::vector<std::pair<std::string, std::string>> labels, double value) {
+        metrics.push_back(Metric{ name, help, type, std::move(labels), value });
+    };
+
+    // the registry's counters, summed over every worker's block
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        const CounterInfo& info = counterInfo((Counter)i);
+        bool first = i == 0 || strcmp(info.metric, counterInfo((Counter)(i - 1)).metric) != 0;
+        Metric metric{ info.metric, first ? info.help : nullptr, "counter", {}, (double)getCounter((Counter)i) };
+        if (info.labelName) {
+            metric.labels.emplace_back(info.labelName, info.labelValue);
+        }
+        metrics.push_back(std::move(metric));
+    }
 
-LARGE_INTEGER Crawler::getFrequency() {
-    return frequency;
-}
+    add("dns_cache_hits_total", "lookups answered from the DNS cache", "counter", (double)dnsCache.getHits());
+    add("dns_cache_misses_total", "lookups sent to the resolver", "counter", (double)dnsCache.getMisses());
+    add("robots_cache_hits_total", "hosts whose robots.txt rules were already cached", "counter", (double)robotsCache.getHits());
+    add("robots_cache_misses_total", "hosts whose robots.txt had to be fetched", "counter", (double)robotsCache.getMisses());
+
+    add("active_threads", "crawling threads still running", "gauge", getActiveThreads());
+    add("queue_size", "URLs queued for the workers", "gauge", (double)getQueueSize());
+    add("dedupe_fingerprints", "host and link fingerprints held for dedupe", "gauge", (double)seen.size());
+    add("dedupe_bytes", "memory held by the dedupe fingerprint set", "gauge", (double)seen.memoryBytes());
+    if (frontier) {
+        add("frontier_inserted_total", "links queued into the frontier", "counter", (double)getFrontierInserted());
+        add("frontier_dropped_total", "links dropped past --max-frontier", "counter", (double)getFrontierDropped());
+        add("frontier_spilled_bytes_total", "compressed frontier bytes written to segment files", "counter", (double)frontier->getSpilledBytes());
+    }
+    if (politeness) {
+        add("politeness_pending_hosts", "hosts waiting for their IP", "gauge", (double)politeness->pending());
+        add("politeness_active_ips", "IPs with a host in flight or cooling down", "gauge", (double)politeness->activeIPs());
+    }
+    if (warc) {
+        add("warc_fetches_total", "fetches archived to WARC files", "counter", (double)warc->getFetches());
+        add("warc_dropped_total", "fetches left out of the archive for a full queue", "counter", (double)warc->getDropped());
+        add("warc_bytes_total", "compressed bytes written to WARC files", "counter", (double)warc->getBytesWritten());
+        add("warc_queued_bytes", "responses waiting for the WARC writer", "gauge", (double)warc->getQueuedBytes());
+    }
 
-LONG Crawler::getTamuLinkPages() {
-    return InterlockedCompareExchange(&tamuLinkPages, 0, 0);
-}
+    for (int set = 0; set < domains.getSetCount(); set++) {
+        DomainHits hits = getDomainHits(set);
+        const std::string& name = domains.getSetName(set);
+        bool first = set == 0;
+        addLabelled("domain_links_total", first ? "links into each --classify rule set" : nullptr, "counter", { { "set", name } }, (double)hits.links);
+        addLabelled("domain_pages_total", first ? "pages with a link into each --classify rule set" : nullptr, "counter", { { "set", name } }, (double)hits.pages);
+        addLabelled("domain_external_pages_total", first ? "of those pages, the ones outside the set" : nullptr, "counter", { { "set", name } },
+            (double)hits.externalPages);
+    }
 
-LONG Crawler::getTamuLinkPagesExternal() {
-    return InterlockedCompareExchange(&tamuLinkPagesExternal, 0, 0);
+    // a summary per stage over the whole run, in seconds as Prometheus expects
+    static const char* quantiles[] = { "0.5", "0.9", "0.99", "0.999" };
+    static const double percents[] = { 50, 90, 99, 99.9 };
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        LatencySnapshot snapshot = getLatency((Stage)stage);
+        const char* name = stageName((Stage)stage);
+        for (int q = 0; q < 4; q++) {
+            addLabelled("stage_latency_seconds", stage == 0 && q == 0 ? "time spent in each crawl stage" : nullptr, "summary",
+                { { "stage", name }, { "quantile", quantiles[q] } }, snapshot.percentile(percents[q]) / 1e6);
+        }
+        addLabelled("stage_latency_seconds_sum", nullptr, "summary", { { "stage", name } }, snapshot.getSum() / 1e6);
+        addLabelled("stage_latency_seconds_count", nullptr, "summary", { { "stage", name } }, (double)snapshot.getCount());
+    }
 }
 
-bool Crawler::checkAndInsertIP(const std::string& ipAddr) {
-    EnterCriticalSection(&ipCriticalSection);
-    bool isNewIP = seenIPs.insert(ipAddr).second;
-    LeaveCriticalSection(&ipCriticalSection);
-    return isNewIP;
+bool Crawler::checkAndInsertIP(in_addr addr) {
+    return seenIPs.insert(addr);
 }
 
 bool Crawler::checkAndInsertHost(const std::string& host) {
-    EnterCriticalSection(&hostCriticalSection);
-    bool isNewHost = seenHosts.insert(host).second;
-    LeaveCriticalSection(&hostCriticalSection);
-    return isNewHost;
+    return seen.insert(FingerprintSet::fingerprint(FingerprintKind::AdmittedHost, host));
 }
 
 void Crawler::printStats() {
     // calculate elapsed time in seconds
-    LARGE_INTEGER now;
-    QueryPerformanceCounter(&now);
-    double elapsedTime = static_cast<double>(now.QuadPart - startTime.QuadPart) / frequency.QuadPart;
+    auto now = std::chrono::steady_clock::now();
+    double elapsedTime = std::chrono::duration<double>(now - startTime).count();
 
     // pretty print stats
-    printf("[%3d] %3d Q %7ld E %7ld H %6ld D %5ld I %5ld R %5ld C %5ld L %4ldK\n",
-        static_cast<int>(elapsedTime), getActiveThreads(), getQueueSize(), getExtractedURLs(), getUniqueHosts(), getDNSLookups(), getUniqueIPs(), getRobotsPassed(), getPagesCrawled(), getTotalLinks() / 1000);
+    auto get = [this](Counter counter) { return (long long)getCounter(counter); };
+    printf("[%3d] %3d Q %7ld E %7lld H %6lld D %5lld I %5lld R %5lld C %5lld L %4lldK\n",
+        static_cast<int>(elapsedTime), getActiveThreads(), getQueueSize(), get(Counter::ExtractedURLs), get(Counter::UniqueHosts), get(Counter::DNSLookups),
+        get(Counter::UniqueIPs), get(Counter::RobotsPassed), get(Counter::PagesCrawled), get(Counter::TotalLinks) / 1000);
+    printf("     *** dns cache %ld hits, %ld misses\n", dnsCache.getHits(), dnsCache.getMisses());
+    printf("     *** robots %lld fetched, %ld cache hits\n", get(Counter::RobotsChecked), robotsCache.getHits());
+    if (frontier) {
+        printf("     *** frontier %ld links queued, %ld dropped, %.1f MB spilled\n", getFrontierInserted(), getFrontierDropped(), frontier->getSpilledBytes() / (1024.0 * 1024.0));
+    }
+    if (politeness) {
+        printf("     *** politeness %ld hosts waiting on %ld IPs\n", politeness->pending(), politeness->activeIPs());
+    }
+
+    // p50/p90/p99/max of what each stage recorded since the last print
+    std::string line;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        LatencySnapshot total = getLatency((Stage)stage);
+        LatencySnapshot interval = total.since(printedLatency[stage]);
+        printedLatency[stage] = total;
+        if (interval.getCount() == 0) {
+            continue;
+        }
+        line += std::string(" ") + stageName((Stage)stage) + " " + formatLatency(interval.percentile(50)) + "/" + formatLatency(interval.percentile(90)) +
+            "/" + formatLatency(interval.percentile(99)) + "/" + formatLatency(interval.getMax());
+    }
+    if (!line.empty()) {
+        printf("     *** latency p50/p90/p99/max:%s\n", line.c_str());
+    }
 }
 
 void Crawler::StatsRun()
 {
-    QueryPerformanceFrequency(&frequency);
-    QueryPerformanceCounter(&startTime);
+    startTime = std::chrono::steady_clock::now();
 
-    LARGE_INTEGER lastTime = startTime;
+    auto lastTime = startTime;
 
-    LONG lastCrawled = 0;
-    LONG lastBytes = 0;
+    uint64_t lastCrawled = 0;
+    uint64_t lastBytes = 0;
 
-    while (WaitForSingleObject(eventQuit, 2000) == WAIT_TIMEOUT)
+    FILE* statsJson = nullptr;
+    if (!options.statsJson.empty()) {
+        statsJson = fopen(options.statsJson.c_str(), "a");
+        if (!statsJson) {
+            printf("Cannot open %s, not writing JSON stats\n", options.statsJson.c_str());
+        }
+    }
+    // one line of every counter, flushed so a tailing reader sees it right away
+    auto writeStatsJson = [this, statsJson]() {
+        std::vector<Metric> metrics;
+        collectMetrics(metrics);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::string line = formatJSONLine(metrics, elapsed);
+        fwrite(line.data(), 1, line.size(), statsJson);
+        fflush(statsJson);
+    };
+
+    while (true)
     {
+        {
+            std::unique_lock<std::mutex> lock(quitMutex);
+            if (eventQuit.wait_for(lock, std::chrono::seconds(2), [this] { return shutdown; })) {
+                break;
+            }
+        }
         printStats();
+        if (statsJson) {
+            writeStatsJson();
+        }
 
         // compute pps and Mbps
-        LARGE_INTEGER currentTime;
-        QueryPerformanceCounter(&currentTime);
-        double elapsedSeconds = static_cast<double>(currentTime.QuadPart - lastTime.QuadPart) / frequency.QuadPart;
+        auto currentTime = std::chrono::steady_clock::now();
+        double elapsedSeconds = std::chrono::duration<double>(currentTime - lastTime).count();
 
-        LONG currentCrawled = getPagesCrawled();
-        LONG currentBytes = getTotalBytes();
+        uint64_t currentCrawled = getCounter(Counter::PagesCrawled);
+        uint64_t currentBytes = getCounter(Counter::TotalBytes);
 
         double pps = (currentCrawled - lastCrawled) / elapsedSeconds;
         double Mbps = ((currentBytes - lastBytes) * 8.0) / (elapsedSeconds * 1024.0 * 1024.0);
@@ -458,19 +722,35 @@ void Crawler::StatsRun()
         lastBytes = currentBytes;
         lastTime = currentTime;
     }
+
+    // the final counts, so the file always ends on the whole run
+    if (statsJson) {
+        writeStatsJson();
+        fclose(statsJson);
+    }
 }
 
 // thread workers
-DWORD WINAPI Crawler::StatsThread(LPVOID param)
+void Crawler::StatsThread(Crawler* crawler)
 {
-    Crawler* crawler = ((Crawler*)param);
     crawler->StatsRun();
-    return 0;
 }
 
-DWORD WINAPI Crawler::CrawlerThread(LPVOID param)
+void Crawler::SeedThread(Crawler* crawler)
+{
+    crawler->SeedRun();
+}
+
+void Crawler::CrawlerThread(Crawler* crawler, int worker)
+{
+    crawler->Run(worker);
+}
+
+#ifdef __linux__
+void Crawler::EventThread(Crawler* crawler, int worker, int maxConnections)
 {
-    Crawler* crawler = ((Crawler*)param);
-    crawler->Run();
-    return 0;
+    EpollEngine engine(*crawler, worker, maxConnections);
+    engine.Run();
+    crawler->decrementActiveThreads();
 }
+#endif
@@ -1,24 +1,111 @@
 #ifndef CRAWLER_H
 #define CRAWLER_H
-#define WIN32_LEAN_AND_MEAN
 
 #include <iostream>
 #include <string>
-#include <queue>
-#include <unordered_set>
-#include <windows.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+
+#include "Options.h"
+#include "Socket.h"
+#include "DNSCache.h"
+#include "FingerprintSet.h"
+#include "IPSet.h"
+#include "WorkQueues.h"
+#include "SeedReader.h"
+#include "PolitenessScheduler.h"
+#include "Frontier.h"
+#include "RobotsRules.h"
+#include "LinkExtractor.h"
+#include "DomainMatcher.h"
+#include "LatencyHistogram.h"
+#include "MetricsServer.h"
+#include "CrawlCounters.h"
+#include "WarcWriter.h"
+
+// download limits for robots.txt (RFC 9309 asks for at least 500 KiB) and the actual page
+#define ROBOTS_LIMIT (512 * 1024)
+#define PAGE_LIMIT (2 * 1024 * 1024)
+
+// robots.txt groups are matched against this product token of our User-agent
+#define ROBOTS_AGENT "ahmadCrawler"
+
+// hosts whose compiled robots.txt is kept
+#define ROBOTS_CACHE_HOSTS 100000
+
+// longest a worker with every held host cooling down sleeps before checking for new URLs
+#define POLITENESS_WAIT_MS 50
+
+// steps of a crawl whose latency each worker records
+enum class Stage {
+    Resolve,  // DNS lookup
+    Connect,  // TCP handshake
+    Robots,   // robots.txt request sent to response complete
+    Page,     // page request sent to response complete
+    Parse     // link extraction
+};
+#define STAGE_COUNT 5
+
+// counted for one --classify rule set
+struct DomainHits {
+    long links;          // extracted links into the set
+    long pages;          // pages with at least one of them
+    long externalPages;  // of those, pages whose own host is outside the set
+};
 
 class Crawler {
     public:
-        Crawler(int numThreads);
+        Crawler(const CrawlerOptions& options);
 
         ~Crawler();
         
-        // read URLs from file and populate queue
+        // map the seed file; SeedRun then streams it into the queues
         void ReadFile(const std::string& filename);
+        void SeedRun();
 
         // crawling thread function
-        void Run();
+        void Run(int worker);
+
+        // next URL for worker from its own queue, or stolen from another, and its depth;
+        // false once all are drained. recursive crawls pop from the frontier instead
+        bool popURL(int worker, std::string& url, int& depth);
+        bool tryPopURL(int worker, std::string& url, int& depth);
+
+        // parse, dedupe and resolve a URL into socket; true if it should be crawled
+        bool admitURL(int worker, const std::string& url, Socket& socket, std::string& host, int& port, std::string& request);
+
+        // the two halves of admitURL around the DNS lookup, for engines that resolve asynchronously
+        bool admitHost(int worker, const std::string& url, std::string& host, int& port, std::string& request);
+        bool admitAddress(int worker, in_addr addr);
+
+        // open resolver towards the configured DNS server; false means use getaddrinfo
+        bool initResolver(DNSResolver& resolver);
+
+        // answers shared by every worker's lookups
+        DNSCache& getDNSCache();
+
+        // whether robots and page requests share a connection
+        HTTPMode getHTTPMode() const;
+
+        // per-IP spacing of resolved hosts; nullptr when --politeness is off and
+        // admitAddress() drops every host after the first on an IP instead
+        PolitenessScheduler* getPoliteness();
+
+        // robots.txt rules already fetched for host:port; nullptr if they must be fetched
+        std::shared_ptr<const RobotsRules> findRobots(const std::string& host, int port);
+
+        // compile a robots.txt response and cache it for host:port. addr and started
+        // (when the request went out) are for --warc, which archives the response
+        std::shared_ptr<const RobotsRules> addRobots(int worker, const std::string& host, int port, in_addr addr, std::chrono::steady_clock::time_point started,
+            const HTTPResponse& response);
+
+        // count a downloaded page and extract its links into the worker's arena,
+        // queueing them on a recursive crawl; archived as addRobots does
+        void processPage(int worker, LinkArena& links, const std::string& host, int port, const std::string& request, int depth, in_addr addr,
+            std::chrono::steady_clock::time_point started, const HTTPResponse& response);
 
         // signal all threads to shutdown
         void signalShutdown();
@@ -27,95 +114,112 @@ class Crawler {
         void decrementActiveThreads();
         int getActiveThreads();
 
+        // time since start, into the worker's histogram for stage
+        void recordLatency(int worker, Stage stage, std::chrono::steady_clock::time_point start);
+
+        // every worker's histogram for stage, merged
+        LatencySnapshot getLatency(Stage stage);
+        static const char* stageName(Stage stage);
+
+        // every counter above, for the metrics endpoint and --stats-json; reads
+        // atomics and relaxed sizes only, so it is safe from any thread at any time
+        void collectMetrics(std::vector<Metric>& metrics);
+
         // print statistics per two seconds
         void printStats();
         void StatsRun();
 
         // get start time
-        LARGE_INTEGER getStartTime();
-        // check and insert into seenIPs and seenHosts queues (thread safe)
-        bool checkAndInsertIP(const std::string& ipAddr);
+        std::chrono::steady_clock::time_point getStartTime();
+        // check and insert into seenIPs and seen (thread safe)
+        bool checkAndInsertIP(in_addr addr);
         bool checkAndInsertHost(const std::string& host);
 
         // thread workers
-        static DWORD WINAPI CrawlerThread(LPVOID param);
-        static DWORD WINAPI StatsThread(LPVOID param);
-
-        // update stats
-        void incrementExtractedURLs();
-        void incrementUniqueHosts();
-        void incrementDNSLookups();
-        void incrementUniqueIPs();
-        void incrementRobotsChecked();
-        void incrementRobotsPassed();
-        void incrementPagesCrawled();
-        void incrementHttpStatus(int statusCode);
-        void addTotalLinks(LONG links);
-        void addTotalBytes(LONG bytes);
-
-        // get stats
-        LONG getExtractedURLs();
-        LONG getUniqueHosts();
-        LONG getDNSLookups();
-        LONG getUniqueIPs();
-        LONG getRobotsChecked();
-        LONG getRobotsPassed();
-        LONG getPagesCrawled();
-        LONG getTotalLinks();
-        LONG getTotalBytes();
-        LONG getQueueSize();
-        LONG getHttp2xx();
-        LONG getHttp3xx();
-        LONG getHttp4xx();
-        LONG getHttp5xx();
-        LONG getHttpOther();
-        LARGE_INTEGER getFrequency();
-
-        LONG getTamuLinkPages();
-        LONG getTamuLinkPagesExternal();
-
-        // synchronization
-        CRITICAL_SECTION queueCriticalSection;
-        // HANDLE queueSemaphore;
-        CRITICAL_SECTION hostCriticalSection;
-        CRITICAL_SECTION ipCriticalSection;
+        static void CrawlerThread(Crawler* crawler, int worker);
+        static void StatsThread(Crawler* crawler);
+        static void SeedThread(Crawler* crawler);
+#ifdef __linux__
+        static void EventThread(Crawler* crawler, int worker, int maxConnections);
+#endif
+
+        // add n to a counter in worker's own block; only ever from that worker's thread
+        void count(int worker, Counter counter, uint64_t n = 1);
+
+        // a counter summed over every worker; lock-free, so safe from any thread
+        uint64_t getCounter(Counter counter) const;
+
+        // get stats kept outside the per-worker counters
+        long getQueueSize();
+        long getFrontierInserted();
+        long getFrontierDropped();
+
+        // the --warc archive; nullptr when it is off
+        const WarcWriter* getWarc() const;
+
+        const DomainMatcher& getDomains() const;
+        DomainHits getDomainHits(int set) const;
 
     private:
+        // robots then page for one admitted host, counting what it gets; returns the
+        // site's Crawl-delay in ms, 0 if it has none or robots.txt was never read
+        int crawlHost(int worker, Socket& socket, LinkArena& links, const std::string& host, int port, const std::string& request, int depth, HTTPResponse& response);
+
+        // count a page's links into each --classify rule set
+        void classifyLinks(const std::string& host, const LinkArena& links);
+
+        // hand one fetch to the WARC writer, if there is one
+        void archive(const std::string& host, int port, const std::string& path, in_addr addr, std::chrono::steady_clock::time_point started,
+            const HTTPResponse& response);
+
+        // normalize the extracted links and hand them to the frontier as one batch
+        void queueLinks(const LinkArena& links, int depth);
+
+        CrawlerOptions options;
+        sockaddr_in dnsServer;
+        bool useResolver;
+        bool revisitHosts;  // later pages on an admitted host are crawled too
+        DNSCache dnsCache;
+        RobotsCache robotsCache;
+        LinkExtractor linkExtractor;  // stateless once it has picked a SIMD level, so shared
+        DomainMatcher domains;        // read-only once built, likewise
+
+        // one block of stage histograms per worker, padded apart; the stats thread
+        // keeps the merged counts it last printed to report each interval alone
+        struct alignas(64) WorkerLatency {
+            LatencyHistogram stages[STAGE_COUNT];
+        };
+        std::unique_ptr<WorkerLatency[]> latency;
+        LatencySnapshot printedLatency[STAGE_COUNT];
+
         // shared
-        std::queue<std::string> urlQueue;
-        std::unordered_set<std::string> seenHosts;
-        std::unordered_set<std::string> seenIPs;
-
-        // stats
-        LONG extractedURLs;
-        LONG uniqueHosts;
-        LONG dnsLookups;
-        LONG uniqueIPs;
-        LONG robotsChecked;
-        LONG robotsPassed;
-        LONG pagesCrawled;
-        LONG totalLinks;
-        LONG totalBytes;
-
-        LONG tamuLinkPages;
-        LONG tamuLinkPagesExternal;
-
-        // HTTP status codes counts
-        LONG http2xx;
-        LONG http3xx;
-        LONG http4xx;
-        LONG http5xx;
-        LONG httpOther;
-
-        LARGE_INTEGER startTime;
-        LARGE_INTEGER frequency;
-
-        // handle to signal shutdown
-        HANDLE eventQuit;
+        WorkQueues urlQueues;
+        SeedReader seeds;
+        FingerprintSet seen;  // admitted hosts, and the frontier's queued hosts or links
+        IPSet seenIPs;
+        std::unique_ptr<PolitenessScheduler> politeness;
+        std::unique_ptr<Frontier> frontier;
+        std::unique_ptr<WarcWriter> warc;  // its own thread does the disk I/O
+
+        // stats: each worker counts into its own padded block, see CrawlCounters.h
+        std::unique_ptr<WorkerCounters[]> counters;
+
+        struct DomainCounters {
+            std::atomic<long> links{0};
+            std::atomic<long> pages{0};
+            std::atomic<long> externalPages{0};
+        };
+        std::unique_ptr<DomainCounters[]> domainHits;  // one per rule set
+
+        std::chrono::steady_clock::time_point startTime;
+
+        // signals shutdown to the stats thread
+        std::mutex quitMutex;
+        std::condition_variable eventQuit;
 
         // control
         bool shutdown;
 
-        LONG activeThreads;
+        std::atomic<long> activeThreads;
 };
 #endif // CRAWLER_H
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "DNSCache.h"
+
+DNSCache::DNSCache(int negativeTtl) : negativeTtl(negativeTtl), hits(0), misses(0) {
+}
+
+DNSCache::Shard& DNSCache::shardFor(const std::string& host) {
+    return shards[std::hash<std::string>()(host) % DNS_CACHE_SHARDS];
+}
+
+bool DNSCache::find(const std::string& host, std::chrono::steady_clock::time_point now, Entry& entry) {
+    Shard& shard = shardFor(host);
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    auto it = shard.entries.find(host);
+    if (it == shard.entries.end()) {
+        return false;
+    }
+    if (it->second.expires <= now) {
+        shard.entries.erase(it);
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+bool DNSCache::lookup(const std::string& host, DNSStatus& status, in_addr& addr) {
+    auto now = std::chrono::steady_clock::now();
+    Entry entry;
+
+    if (find(host, now, entry)) {
+        status = entry.status;
+        addr = entry.addr;
+        hits++;
+        return true;
+    }
+
+    // a name under a nonexistent domain does not exist either
+    if (negativeTtl > 0) {
+        size_t dot = host.find('.');
+        while (dot != std::string::npos && dot + 1 < host.length()) {
+            std::string parent = host.substr(dot + 1);
+            if (find(parent, now, entry) && entry.status == DNSStatus::NXDomain) {
+                status = DNSStatus::NXDomain;
+                hits++;
+                return true;
+            }
+            dot = host.find('.', dot + 1);
+        }
+    }
+
+    misses++;
+    return false;
+}
+
+void DNSCache::insert(const std::string& host, DNSStatus status, in_addr addr, uint32_t ttl) {
+    uint32_t seconds = status == DNSStatus::Ok ? ttl : (uint32_t)negativeTtl;
+    if (seconds == 0) {
+        return;
+    }
+
+    Entry entry;
+    entry.addr = addr;
+    entry.status = status;
+    entry.expires = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+
+    Shard& shard = shardFor(host);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    shard.entries[host] = entry;
+}
+
+long DNSCache::getHits() const {
+    return hits.load();
+}
+
+long DNSCache::getMisses() const {
+    return misses.load();
+}
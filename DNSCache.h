@@ -0,0 +1,57 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include "DNSResolver.h"
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#define DNS_CACHE_SHARDS 64
+#define DNS_CACHE_DEFAULT_TTL 300  // seconds, for getaddrinfo answers which carry no TTL
+
+// process-wide hostname -> address cache shared by every worker; split into
+// independently locked shards so lookups from many threads rarely collide.
+// failed lookups are remembered too, for negativeTtl seconds
+class DNSCache {
+    public:
+        explicit DNSCache(int negativeTtl);
+
+        // true on a hit; addr is only set when status is Ok. an NXDOMAIN cached for
+        // a parent name also answers its subdomains (RFC 8020)
+        bool lookup(const std::string& host, DNSStatus& status, in_addr& addr);
+
+        // remember an answer for ttl seconds (Ok) or the negative TTL (anything else)
+        void insert(const std::string& host, DNSStatus status, in_addr addr, uint32_t ttl);
+
+        long getHits() const;
+        long getMisses() const;
+
+    private:
+        struct Entry {
+            in_addr addr;
+            DNSStatus status;
+            std::chrono::steady_clock::time_point expires;
+        };
+
+        // padded so neighbouring shard locks do not share a cache line
+        struct alignas(64) Shard {
+            std::mutex lock;
+            std::unordered_map<std::string, Entry> entries;
+        };
+
+        Shard& shardFor(const std::string& host);
+
+        // look for an unexpired entry; false on a miss
+        bool find(const std::string& host, std::chrono::steady_clock::time_point now, Entry& entry);
+
+        Shard shards[DNS_CACHE_SHARDS];
+        int negativeTtl;
+        std::atomic<long> hits;
+        std::atomic<long> misses;
+};
+
+#endif // DNS_CACHE_H
@@ -0,0 +1,444 @@
+#include "DNSResolver.h"
+
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <fcntl.h>
+#endif
+
+#define DNS_HEADER_SIZE 12
+#define DNS_MAX_PACKET 4096
+#define DNS_MAX_NAME 255
+#define DNS_MAX_LABEL 63
+
+#define DNS_FLAG_QR 0x8000
+#define DNS_FLAG_TC 0x0200
+#define DNS_FLAG_RD 0x0100
+#define DNS_RCODE_NXDOMAIN 3
+
+static uint16_t readU16(const unsigned char* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t readU32(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void writeU16(std::string& out, uint16_t v) {
+    out.push_back((char)(v >> 8));
+    out.push_back((char)(v & 0xFF));
+}
+
+// encode host as a sequence of length-prefixed labels; false if it is not a valid name
+static bool encodeName(const std::string& host, std::string& out) {
+    size_t start = 0;
+    size_t encoded = 0;
+    while (start < host.length()) {
+        size_t dot = host.find('.', start);
+        if (dot == std::string::npos) {
+            dot = host.length();
+        }
+        size_t labelLen = dot - start;
+        if (labelLen == 0 || labelLen > DNS_MAX_LABEL) {
+            return false;
+        }
+        out.push_back((char)labelLen);
+        out.append(host, start, labelLen);
+        encoded += labelLen + 1;
+        start = dot + 1;
+    }
+    out.push_back('\0');
+    return encoded > 0 && encoded + 1 <= DNS_MAX_NAME;
+}
+
+// offset just past the (possibly compressed) name at pos, -1 if malformed
+static int skipName(const unsigned char* data, int len, int pos) {
+    while (pos < len) {
+        unsigned char b = data[pos];
+        if (b == 0) {
+            return pos + 1;
+        }
+        if ((b & 0xC0) == 0xC0) {
+            return pos + 2 <= len ? pos + 2 : -1;
+        }
+        pos += b + 1;
+    }
+    return -1;
+}
+
+// compare the uncompressed question name at pos with host, ignoring case
+static bool nameMatches(const unsigned char* data, int len, int pos, const std::string& host) {
+    size_t h = 0;
+    bool first = true;
+    while (pos < len) {
+        unsigned char b = data[pos++];
+        if (b == 0) {
+            return h == host.length() || (h + 1 == host.length() && host[h] == '.');
+        }
+        if ((b & 0xC0) != 0 || pos + b > len) {
+            return false;
+        }
+        if (!first) {
+            if (h >= host.length() || host[h] != '.') {
+                return false;
+            }
+            h++;
+        }
+        first = false;
+        for (int i = 0; i < b; i++, h++) {
+            if (h >= host.length() || tolower(data[pos + i]) != tolower((unsigned char)host[h])) {
+                return false;
+            }
+        }
+        pos += b;
+    }
+    return false;
+}
+
+DNSResolver::DNSResolver() : sock(INVALID_SOCKET), timeoutMs(2000), retries(2), nextId(0) {
+    std::random_device rd;
+    nextId = (uint16_t)rd();
+}
+
+DNSResolver::~DNSResolver() {
+    if (sock != INVALID_SOCKET) {
+        closesocket(sock);
+    }
+}
+
+bool DNSResolver::init(const sockaddr_in& server, int timeout, int retryCount) {
+    timeoutMs = timeout;
+    retries = retryCount;
+
+    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SOCKET) {
+        printf("socket() generated error %d\n", WSAGetLastError());
+        return false;
+    }
+
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(sock, FIONBIO, &nonBlocking);
+#else
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    // a connected UDP socket only accepts datagrams from the server
+    if (::connect(sock, (const sockaddr*)&server, sizeof(server)) == SOCKET_ERROR) {
+        printf("connect() to DNS server generated error %d\n", WSAGetLastError());
+        closesocket(sock);
+        sock = INVALID_SOCKET;
+        return false;
+    }
+    return true;
+}
+
+bool DNSResolver::submit(const std::string& host, uint16_t qtype, void* cookie) {
+    if (queries.size() >= 0xFFFF) {
+        return false;
+    }
+
+    // pick the next free query ID
+    while (queries.count(nextId)) {
+        nextId++;
+    }
+    uint16_t id = nextId++;
+
+    Query query;
+    query.host = host;
+    query.qtype = qtype;
+    query.cookie = cookie;
+    query.attempts = 1;
+    query.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    std::string& packet = query.packet;
+    packet.reserve(DNS_HEADER_SIZE + host.length() + 6);
+    writeU16(packet, id);
+    writeU16(packet, DNS_FLAG_RD);
+    writeU16(packet, 1);  // QDCOUNT
+    writeU16(packet, 0);  // ANCOUNT
+    writeU16(packet, 0);  // NSCOUNT
+    writeU16(packet, 0);  // ARCOUNT
+    if (!encodeName(host, packet)) {
+        return false;
+    }
+    writeU16(packet, qtype);
+    writeU16(packet, 1);  // QCLASS IN
+
+    // a send failure is retried like a lost packet
+    send(query);
+    if (queries.empty() || query.deadline < earliestDeadline) {
+        earliestDeadline = query.deadline;
+    }
+    queries.emplace(id, std::move(query));
+    return true;
+}
+
+bool DNSResolver::send(const Query& query) {
+    int ret = ::send(sock, query.packet.data(), (int)query.packet.length(), 0);
+    return ret != SOCKET_ERROR;
+}
+
+int DNSResolver::poll(std::vector<DNSResult>& results) {
+    size_t before = results.size();
+    unsigned char packet[DNS_MAX_PACKET];
+
+    while (true) {
+        int len = recv(sock, (char*)packet, sizeof(packet), 0);
+        if (len == SOCKET_ERROR || len == 0) {
+            break; // drained (or an ICMP error surfaced; queries will time out)
+        }
+
+        DNSResult result;
+        uint16_t id;
+        if (parseReply((const char*)packet, len, result, id)) {
+            results.push_back(std::move(result));
+        }
+    }
+
+    expire(results);
+    return (int)(results.size() - before);
+}
+
+bool DNSResolver::parseReply(const char* raw, int len, DNSResult& result, uint16_t& id) {
+    const unsigned char* data = (const unsigned char*)raw;
+    if (len < DNS_HEADER_SIZE) {
+        return false;
+    }
+
+    id = readU16(data);
+    auto it = queries.find(id);
+    if (it == queries.end()) {
+        return false; // late reply to a query that already finished
+    }
+    const Query& query = it->second;
+
+    uint16_t flags = readU16(data + 2);
+    uint16_t qdCount = readU16(data + 4);
+    uint16_t anCount = readU16(data + 6);
+    if (!(flags & DNS_FLAG_QR) || qdCount != 1) {
+        return false;
+    }
+
+    // the question must echo ours, otherwise this is not our reply
+    int pos = DNS_HEADER_SIZE;
+    if (!nameMatches(data, len, pos, query.host)) {
+        return false;
+    }
+    pos = skipName(data, len, pos);
+    if (pos < 0 || pos + 4 > len || readU16(data + pos) != query.qtype) {
+        return false;
+    }
+    pos += 4;
+
+    result.cookie = query.cookie;
+    result.host = query.host;
+    result.qtype = query.qtype;
+    result.ttl = 0;
+    result.status = DNSStatus::Ok;
+
+    int rcode = flags & 0xF;
+    if (rcode == DNS_RCODE_NXDOMAIN) {
+        result.status = DNSStatus::NXDomain;
+    }
+    else if (rcode != 0 || (flags & DNS_FLAG_TC)) {
+        // truncated replies would need TCP, which this resolver does not do
+        result.status = DNSStatus::Failed;
+    }
+    else {
+        bool haveTtl = false;
+        for (int i = 0; i < anCount; i++) {
+            pos = skipName(data, len, pos);
+            if (pos < 0 || pos + 10 > len) {
+                break;
+            }
+            uint16_t type = readU16(data + pos);
+            uint32_t ttl = readU32(data + pos + 4);
+            uint16_t rdLength = readU16(data + pos + 8);
+            pos += 10;
+            if (pos + rdLength > len) {
+                break;
+            }
+
+            // CNAME chains arrive in the same answer section, so every A/AAAA belongs
+            // to us; only the asked type counts, so an Ok result always has an address
+            if (type != query.qtype) {
+                pos += rdLength;
+                continue;
+            }
+            if (type == DNS_TYPE_A && rdLength == 4) {
+                in_addr addr;
+                memcpy(&addr, data + pos, 4);
+                result.addrs.push_back(addr);
+            }
+            else if (type == DNS_TYPE_AAAA && rdLength == 16) {
+                in6_addr addr;
+                memcpy(&addr, data + pos, 16);
+                result.addrs6.push_back(addr);
+            }
+            else {
+                pos += rdLength;
+                continue;
+            }
+            if (!haveTtl || ttl < result.ttl) {
+                result.ttl = ttl;
+                haveTtl = true;
+            }
+            pos += rdLength;
+        }
+
+        // NOERROR without records of the asked type is as good as nonexistent
+        if (result.addrs.empty() && result.addrs6.empty()) {
+            result.status = DNSStatus::NXDomain;
+        }
+    }
+
+    queries.erase(it);
+    return true;
+}
+
+void DNSResolver::expire(std::vector<DNSResult>& results) {
+    if (queries.empty()) {
+        return;
+    }
+
+    // earliestDeadline is a lower bound, so nothing can be due before it
+    auto now = std::chrono::steady_clock::now();
+    if (now < earliestDeadline) {
+        return;
+    }
+
+    auto earliest = std::chrono::steady_clock::time_point::max();
+    for (auto it = queries.begin(); it != queries.end(); ) {
+        Query& query = it->second;
+        if (query.deadline > now) {
+            earliest = std::min(earliest, query.deadline);
+            ++it;
+            continue;
+        }
+
+        if (query.attempts <= retries) {
+            query.attempts++;
+            query.deadline = now + std::chrono::milliseconds(timeoutMs);
+            earliest = std::min(earliest, query.deadline);
+            send(query);
+            ++it;
+            continue;
+        }
+
+        DNSResult result;
+        result.cookie = query.cookie;
+        result.host = query.host;
+        result.qtype = query.qtype;
+        result.status = DNSStatus::Timeout;
+        result.ttl = 0;
+        results.push_back(std::move(result));
+        it = queries.erase(it);
+    }
+    earliestDeadline = earliest;
+}
+
+int DNSResolver::nextTimeoutMs() const {
+    if (queries.empty()) {
+        return -1;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(earliestDeadline - now).count();
+    return ms < 0 ? 0 : (int)ms + 1;
+}
+
+size_t DNSResolver::pending() const {
+    return queries.size();
+}
+
+SOCKET DNSResolver::getHandle() const {
+    return sock;
+}
+
+DNSStatus DNSResolver::resolve(const std::string& host, in_addr& addr, uint32_t& ttl) {
+    if (!submit(host, DNS_TYPE_A, nullptr)) {
+        return DNSStatus::Failed;
+    }
+
+    std::vector<DNSResult> results;
+    while (true) {
+        for (const DNSResult& result : results) {
+            if (result.cookie == nullptr && result.host == host) {
+                if (result.status == DNSStatus::Ok) {
+                    addr = result.addrs[0];
+                    ttl = result.ttl;
+                }
+                return result.status;
+            }
+        }
+        results.clear();
+
+        int waitMs = nextTimeoutMs();
+        if (waitMs < 0) {
+            return DNSStatus::Failed;
+        }
+
+#ifdef _WIN32
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(sock, &readfds);
+        timeval timeout;
+        timeout.tv_sec = waitMs / 1000;
+        timeout.tv_usec = (waitMs % 1000) * 1000;
+        select(0, &readfds, nullptr, nullptr, &timeout);
+#else
+        pollfd pfd;
+        pfd.fd = sock;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        ::poll(&pfd, 1, waitMs);
+#endif
+        poll(results);
+    }
+}
+
+bool DNSResolver::parseServer(const std::string& spec, sockaddr_in& server) {
+    std::string host = spec;
+    int port = 53;
+
+    if (host.empty()) {
+        // fall back to the system's first IPv4 nameserver
+        std::ifstream conf("/etc/resolv.conf");
+        std::string line;
+        while (std::getline(conf, line)) {
+            std::istringstream words(line);
+            std::string keyword, value;
+            if (words >> keyword >> value && keyword == "nameserver" && value.find(':') == std::string::npos) {
+                host = value;
+                break;
+            }
+        }
+        if (host.empty()) {
+            return false;
+        }
+    }
+    else {
+        size_t colon = host.find(':');
+        if (colon != std::string::npos) {
+            port = atoi(host.c_str() + colon + 1);
+            host.erase(colon);
+            if (port <= 0 || port > 65535) {
+                return false;
+            }
+        }
+    }
+
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons((uint16_t)port);
+    return inet_pton(AF_INET, host.c_str(), &server.sin_addr) == 1;
+}
@@ -0,0 +1,82 @@
+#ifndef DNS_RESOLVER_H
+#define DNS_RESOLVER_H
+
+#include "Socket.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_AAAA 28
+
+enum class DNSStatus {
+    Ok,
+    NXDomain,  // name does not exist
+    Failed,    // SERVFAIL, REFUSED, malformed reply or unencodable name
+    Timeout    // no answer after every retry
+};
+
+struct DNSResult {
+    void* cookie;                // whatever was passed to submit()
+    std::string host;
+    uint16_t qtype;
+    DNSStatus status;
+    std::vector<in_addr> addrs;  // A answers
+    std::vector<in6_addr> addrs6; // AAAA answers
+    uint32_t ttl;                // smallest TTL among the answers
+};
+
+// non-blocking stub resolver: many UDP queries in flight over one socket to a
+// single recursive server, replies matched by query ID, with per-query retries
+class DNSResolver {
+    public:
+        DNSResolver();
+        ~DNSResolver();
+
+        // open the UDP socket towards server; timeoutMs applies per attempt
+        bool init(const sockaddr_in& server, int timeoutMs, int retries);
+
+        // send a query; false if the name cannot be encoded or the ID space is exhausted
+        bool submit(const std::string& host, uint16_t qtype, void* cookie);
+
+        // collect replies and expired queries without blocking; returns results appended
+        int poll(std::vector<DNSResult>& results);
+
+        // milliseconds until the next retry or expiry is due, -1 if nothing is pending
+        int nextTimeoutMs() const;
+
+        size_t pending() const;
+        SOCKET getHandle() const;
+
+        // blocking convenience for the threaded engine: first A record for host and its TTL
+        DNSStatus resolve(const std::string& host, in_addr& addr, uint32_t& ttl);
+
+        // "ip[:port]" or, when spec is empty, the first nameserver in /etc/resolv.conf
+        static bool parseServer(const std::string& spec, sockaddr_in& server);
+
+    private:
+        struct Query {
+            std::string host;
+            uint16_t qtype;
+            void* cookie;
+            std::string packet;
+            int attempts;
+            std::chrono::steady_clock::time_point deadline;
+        };
+
+        bool send(const Query& query);
+        bool parseReply(const char* data, int len, DNSResult& result, uint16_t& id);
+        void expire(std::vector<DNSResult>& results);
+
+        SOCKET sock;
+        int timeoutMs;
+        int retries;
+        uint16_t nextId;
+        std::unordered_map<uint16_t, Query> queries;
+        std::chrono::steady_clock::time_point earliestDeadline;  // no query is due before this
+};
+
+#endif // DNS_RESOLVER_H
@@ -0,0 +1,219 @@
+#include "DomainMatcher.h"
+
+#define DOMAIN_INITIAL_SLOTS 64
+#define LABEL_HASH_SEED 5381u
+
+static char lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c | 0x20) : c;
+}
+
+// djb2 over the label with case folded by setting bit 5, which is exact for
+// letters and digits; the few other bytes it merges only share a hash, and
+// labels are compared in full anyway. slotHash mixes the result
+static uint32_t hashStep(uint32_t hash, char c) {
+    return hash * 33 + ((unsigned char)c | 0x20);
+}
+
+// "*.tamu.edu" and ".tamu.edu" mean what "tamu.edu" does
+static std::string_view stripWildcard(std::string_view suffix) {
+    if (suffix.size() >= 2 && suffix[0] == '*' && suffix[1] == '.') {
+        suffix.remove_prefix(2);
+    }
+    else if (!suffix.empty() && suffix[0] == '.') {
+        suffix.remove_prefix(1);
+    }
+    return suffix;
+}
+
+DomainMatcher::DomainMatcher() : table(DOMAIN_INITIAL_SLOTS), edgeCount(0), terminal(1, 0) {
+}
+
+bool DomainMatcher::validSuffix(std::string_view suffix) {
+    suffix = stripWildcard(suffix);
+    if (suffix.empty() || suffix.front() == '.' || suffix.back() == '.' || suffix.find("..") != std::string_view::npos) {
+        return false;
+    }
+    for (char c : suffix) {
+        if (c == '/' || c == ':' || c == '*' || c == '@' || (unsigned char)c <= ' ') {
+            return false;
+        }
+    }
+    return true;
+}
+
+int DomainMatcher::addRuleSet(const std::string& name, const std::vector<std::string>& suffixes) {
+    if (names.size() >= DOMAIN_MAX_SETS) {
+        return -1;
+    }
+    for (const std::string& suffix : suffixes) {
+        if (!validSuffix(suffix)) {
+            return -1;
+        }
+    }
+
+    int set = (int)names.size();
+    names.push_back(name);
+    for (const std::string& suffix : suffixes) {
+        std::string_view rest = stripWildcard(suffix);
+        uint32_t node = 0;
+        while (!rest.empty()) {
+            size_t dot = rest.rfind('.');
+            size_t start = dot == std::string_view::npos ? 0 : dot + 1;
+            node = addChild(node, rest.substr(start));
+            rest = rest.substr(0, dot == std::string_view::npos ? 0 : dot);
+        }
+        terminal[node] |= 1ull << set;
+    }
+    return set;
+}
+
+uint32_t DomainMatcher::slotHash(uint32_t parent, uint32_t hash) {
+    return (uint32_t)(((uint64_t)(hash ^ (parent * 0x9E3779B1u)) * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+uint32_t DomainMatcher::findChild(uint32_t parent, uint32_t hash, const char* label, size_t length) const {
+    size_t mask = table.size() - 1;
+    for (size_t slot = slotHash(parent, hash) & mask; ; slot = (slot + 1) & mask) {
+        const Edge& edge = table[slot];
+        if (edge.child == 0) {
+            return 0;
+        }
+        if (edge.parent == parent && edge.hash == hash && edge.labelLength == length) {
+            const char* stored = labels.data() + edge.labelOffset;
+            size_t i = 0;
+            while (i < length && lower(label[i]) == stored[i]) {
+                i++;
+            }
+            if (i == length) {
+                return edge.child;
+            }
+        }
+    }
+}
+
+uint32_t DomainMatcher::addChild(uint32_t parent, std::string_view label) {
+    uint32_t hash = LABEL_HASH_SEED;
+    for (size_t i = label.size(); i > 0; i--) {
+        hash = hashStep(hash, label[i - 1]);
+    }
+    uint32_t child = findChild(parent, hash, label.data(), label.size());
+    if (child != 0) {
+        return child;
+    }
+
+    // kept at most half full so probes stay short
+    if ((edgeCount + 1) * 2 > table.size()) {
+        grow();
+    }
+    Edge edge;
+    edge.parent = parent;
+    edge.child = (uint32_t)terminal.size();
+    edge.hash = hash;
+    edge.labelOffset = (uint32_t)labels.size();
+    edge.labelLength = (uint32_t)label.size();
+    for (char c : label) {
+        labels += lower(c);
+    }
+    terminal.push_back(0);
+
+    size_t mask = table.size() - 1;
+    size_t slot = slotHash(parent, hash) & mask;
+    while (table[slot].child != 0) {
+        slot = (slot + 1) & mask;
+    }
+    table[slot] = edge;
+    edgeCount++;
+    return edge.child;
+}
+
+void DomainMatcher::grow() {
+    std::vector<Edge> old(table.size() * 2);
+    old.swap(table);
+    size_t mask = table.size() - 1;
+    for (const Edge& edge : old) {
+        if (edge.child == 0) {
+            continue;
+        }
+        size_t slot = slotHash(edge.parent, edge.hash) & mask;
+        while (table[slot].child != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = edge;
+    }
+}
+
+uint64_t DomainMatcher::match(std::string_view host) const {
+    size_t end = host.size();
+    if (end > 0 && host[end - 1] == '.') {
+        end--; // fully qualified
+    }
+
+    // each label is hashed while looking for the dot before it, then looked up under the node so far
+    uint64_t matched = 0;
+    uint32_t node = 0;
+    while (end > 0) {
+        size_t start = end;
+        uint32_t hash = LABEL_HASH_SEED;
+        while (start > 0 && host[start - 1] != '.') {
+            start--;
+            hash = hashStep(hash, host[start]);
+        }
+        if (start == end) {
+            break;
+        }
+        node = findChild(node, hash, host.data() + start, end - start);
+        if (node == 0) {
+            break;
+        }
+        matched |= terminal[node];
+        if (start == 0) {
+            break;
+        }
+        end = start - 1;
+    }
+    return matched;
+}
+
+std::string_view DomainMatcher::hostOf(std::string_view url) {
+    static const char scheme[] = "http://";
+    if (url.size() < 7) {
+        return std::string_view();
+    }
+    for (int i = 0; i < 7; i++) {
+        if (lower(url[i]) != scheme[i]) {
+            return std::string_view();
+        }
+    }
+
+    // one pass over the authority: the host starts after any userinfo and ends at a port
+    size_t start = 7, colon = 0, i = 7;
+    for (; i < url.size(); i++) {
+        char c = url[i];
+        if (c == '/' || c == '?' || c == '#') {
+            break;
+        }
+        if (c == '@') {
+            start = i + 1;
+            colon = 0;
+        }
+        else if (c == ':' && colon == 0) {
+            colon = i;
+        }
+    }
+    if (start < i && url[start] == '[') {
+        return std::string_view(); // IPv6 literal, never a domain
+    }
+    return url.substr(start, (colon != 0 ? colon : i) - start);
+}
+
+int DomainMatcher::getSetCount() const {
+    return (int)names.size();
+}
+
+const std::string& DomainMatcher::getSetName(int set) const {
+    return names[set];
+}
+
+size_t DomainMatcher::getNodeCount() const {
+    return terminal.size();
+}
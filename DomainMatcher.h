@@ -0,0 +1,63 @@
+#ifndef DOMAIN_MATCHER_H
+#define DOMAIN_MATCHER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#define DOMAIN_MAX_SETS 64  // one bit each in a match result
+
+// named lists of domain suffixes compiled into one trie over reversed labels:
+// "tamu.edu" is the path edu -> tamu, and matches tamu.edu and every name
+// under it. a host is matched by walking its labels right to left, hashing each
+// as it is read, so it costs one pass over the host and no allocation whatever
+// the number of suffixes. the trie's edges live in a single open-addressing
+// table keyed by parent node and label
+class DomainMatcher {
+    public:
+        DomainMatcher();
+
+        // add a rule set; returns its index, or -1 if DOMAIN_MAX_SETS are already
+        // there or a suffix is not validSuffix()
+        int addRuleSet(const std::string& name, const std::vector<std::string>& suffixes);
+
+        // dot-separated non-empty labels, optionally with a leading "*." or "."
+        static bool validSuffix(std::string_view suffix);
+
+        // bit i is set if host falls under a suffix of rule set i
+        uint64_t match(std::string_view host) const;
+
+        // host of "http://host[:port]/..." without userinfo or port; empty if not http
+        // or an IPv6 literal
+        static std::string_view hostOf(std::string_view url);
+
+        int getSetCount() const;
+        const std::string& getSetName(int set) const;
+        size_t getNodeCount() const;
+
+    private:
+        struct Edge {
+            uint32_t parent;
+            uint32_t child;        // 0 marks an empty slot; the root is never a child
+            uint32_t hash;         // of the label, bytes taken last to first
+            uint32_t labelOffset;  // into labels
+            uint32_t labelLength;
+        };
+
+        static uint32_t slotHash(uint32_t parent, uint32_t hash);
+
+        // child of parent along label, 0 if there is none
+        uint32_t findChild(uint32_t parent, uint32_t hash, const char* label, size_t length) const;
+        uint32_t addChild(uint32_t parent, std::string_view label);
+        void grow();
+
+        std::vector<Edge> table;
+        size_t edgeCount;
+        std::string labels;               // lowercased bytes of every edge's label
+        std::vector<uint64_t> terminal;   // per node: the rule sets with a suffix ending there
+        std::vector<std::string> names;
+};
+
+#endif // DOMAIN_MATCHER_H
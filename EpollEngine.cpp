@@ -0,0 +1,379 @@
+#include "EpollEngine.h"
+#include "Crawler.h"
+#include "PolitenessScheduler.h"
+
+#include <sys/epoll.h>
+#include <cstdio>
+
+#define MAX_EVENTS 256
+#define WAIT_MS 100
+#define CONNECTION_TIMEOUT std::chrono::seconds(10)
+
+EpollEngine::EpollEngine(Crawler& crawler, int worker, int maxConnections)
+    : crawler(crawler), worker(worker), politeness(crawler.getPoliteness()), epfd(-1), maxConnections(maxConnections), queueDrained(false), asyncDNS(false) {
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        printf("epoll_create1 failed with error %d\n", errno);
+        return;
+    }
+
+    // the resolver socket is registered with a null pointer to tell it apart from connections
+    if (crawler.initResolver(resolver)) {
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        asyncDNS = epoll_ctl(epfd, EPOLL_CTL_ADD, resolver.getHandle(), &ev) == 0;
+    }
+}
+
+EpollEngine::~EpollEngine() {
+    while (!connections.empty()) {
+        finish(connections.back());
+    }
+    for (Connection* conn : freeList) {
+        delete conn;
+    }
+    if (epfd >= 0) {
+        ::close(epfd);
+    }
+}
+
+void EpollEngine::Run() {
+    if (epfd < 0) {
+        return;
+    }
+
+    epoll_event events[MAX_EVENTS];
+    auto lastSweep = std::chrono::steady_clock::now();
+
+    while (true) {
+        fill();
+        if (connections.empty() && queueDrained && (!politeness || politeness->pending() == 0)) {
+            break; // fill() only leaves nothing in flight once the queues are drained
+        }
+
+        // wake up in time for the next DNS retry or politeness cooldown
+        int waitMs = WAIT_MS;
+        int dnsMs = asyncDNS ? resolver.nextTimeoutMs() : -1;
+        if (dnsMs >= 0 && dnsMs < waitMs) {
+            waitMs = dnsMs;
+        }
+        int dueMs = politeness ? politeness->nextDueMs() : -1;
+        if (dueMs >= 0 && dueMs < waitMs) {
+            waitMs = dueMs;
+        }
+
+        int n = epoll_wait(epfd, events, MAX_EVENTS, waitMs);
+        if (n < 0 && errno != EINTR) {
+            printf("epoll_wait failed with error %d\n", errno);
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr != nullptr) {
+                advance(static_cast<Connection*>(events[i].data.ptr), events[i].events);
+            }
+        }
+
+        // replies and retries are both handled by poll(), so run it whenever queries are out
+        if (asyncDNS && resolver.pending() > 0) {
+            onResolved();
+        }
+
+        // sweep for stalled connections about once a second
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSweep >= std::chrono::seconds(1)) {
+            expire();
+            lastSweep = now;
+        }
+    }
+}
+
+void EpollEngine::fill() {
+    std::string url;
+    int depth;
+    CrawlJob job;
+
+    while (connections.size() < maxConnections) {
+        // hosts the politeness scheduler released come first, already resolved
+        if (politeness && politeness->tryNext(job)) {
+            Connection* conn = acquire();
+            conn->host = std::move(job.host);
+            conn->request = std::move(job.request);
+            conn->port = job.port;
+            conn->depth = job.depth;
+            conn->socket.setResolvedAddress(job.addr);
+            conn->scheduled = true;
+            conn->phase = Phase::Robots;
+            if (!startPhase(conn)) {
+                finish(conn);
+            }
+            continue;
+        }
+        if (queueDrained || (politeness && !politeness->hasRoom())) {
+            break;
+        }
+
+        // with nothing in flight or held there is nothing to starve, so wait for the seed
+        // producer; otherwise take only what is already queued and get back to the event loop
+        if (connections.empty() && (!politeness || politeness->pending() == 0)) {
+            if (!crawler.popURL(worker, url, depth)) {
+                queueDrained = true;
+                break;
+            }
+        }
+        else if (!crawler.tryPopURL(worker, url, depth)) {
+            break;
+        }
+
+        Connection* conn = acquire();
+        conn->depth = depth;
+        if (!crawler.admitHost(worker, url, conn->host, conn->port, conn->request)) {
+            finish(conn);
+            continue;
+        }
+        conn->phase = Phase::Robots;
+
+        in_addr addr;
+        DNSStatus status = DNSStatus::Ok;
+        bool known = inet_pton(AF_INET, conn->host.c_str(), &addr) == 1 ||
+            (asyncDNS && crawler.getDNSCache().lookup(conn->host, status, addr));
+
+        // everything else goes to the resolver; the connection waits for onResolved()
+        // with no deadline, since the resolver's own retries bound how long that takes
+        if (asyncDNS && !known) {
+            if (!resolver.submit(conn->host, DNS_TYPE_A, conn)) {
+                finish(conn);
+                continue;
+            }
+            conn->state = State::Resolving;
+            conn->started = std::chrono::steady_clock::now();
+            conn->deadline = std::chrono::steady_clock::time_point::max();
+            continue;
+        }
+
+        // IP literals and cache hits, or getaddrinfo when no resolver is configured
+        if (known) {
+            conn->socket.setResolvedAddress(addr);
+        }
+        bool resolved = status == DNSStatus::Ok;
+        if (!known) {
+            auto start = std::chrono::steady_clock::now();
+            resolved = conn->socket.resolveDNS(conn->host);
+            crawler.recordLatency(worker, Stage::Resolve, start);
+        }
+        if (!resolved) {
+            finish(conn);
+            continue;
+        }
+        admitted(conn);
+    }
+}
+
+EpollEngine::Connection* EpollEngine::acquire() {
+    Connection* conn;
+    if (!freeList.empty()) {
+        conn = freeList.back();
+        freeList.pop_back();
+    }
+    else {
+        conn = new Connection;
+        conn->socket.setCache(&crawler.getDNSCache());
+        conn->socket.setKeepAlive(crawler.getHTTPMode() != HTTPMode::Close);
+    }
+    conn->scheduled = false;
+    conn->crawlDelayMs = 0;
+    conn->slot = connections.size();
+    connections.push_back(conn);
+    return conn;
+}
+
+void EpollEngine::admitted(Connection* conn) {
+    in_addr addr = conn->socket.getResolvedAddress();
+    if (!crawler.admitAddress(worker, addr)) {
+        finish(conn);
+        return;
+    }
+
+    // the scheduler hands the host back through fill() once its IP is free
+    if (politeness) {
+        CrawlJob job;
+        job.host = std::move(conn->host);
+        job.request = std::move(conn->request);
+        job.port = conn->port;
+        job.depth = conn->depth;
+        job.addr = addr;
+        politeness->submit(std::move(job));
+        finish(conn);
+        return;
+    }
+
+    if (!startPhase(conn)) {
+        finish(conn);
+    }
+}
+
+void EpollEngine::onResolved() {
+    dnsResults.clear();
+    resolver.poll(dnsResults);
+
+    for (const DNSResult& result : dnsResults) {
+        Connection* conn = static_cast<Connection*>(result.cookie);
+        crawler.recordLatency(worker, Stage::Resolve, conn->started);
+        in_addr addr = {};
+        if (result.status == DNSStatus::Ok) {
+            addr = result.addrs[0];
+        }
+        crawler.getDNSCache().insert(result.host, result.status, addr, result.ttl);
+
+        if (result.status != DNSStatus::Ok) {
+            finish(conn);
+            continue;
+        }
+
+        conn->socket.setResolvedAddress(addr);
+        admitted(conn);
+    }
+}
+
+bool EpollEngine::startPhase(Connection* conn) {
+    conn->deadline = std::chrono::steady_clock::now() + CONNECTION_TIMEOUT;
+
+    // a host whose robots.txt is cached goes straight to the page
+    if (conn->phase == Phase::Robots) {
+        std::shared_ptr<const RobotsRules> rules = crawler.findRobots(conn->host, conn->port);
+        if (rules) {
+            if (!checkRobots(conn, *rules)) {
+                return false;
+            }
+            conn->phase = Phase::Page;
+        }
+    }
+
+    // the page goes over the robots connection when the server kept it open
+    if (conn->phase == Phase::Page && conn->socket.canReuse()) {
+        conn->socket.resetResponse();
+        conn->started = std::chrono::steady_clock::now();
+        conn->socket.queueHTTPRequest(conn->host, conn->request, "GET");
+        conn->state = State::Sending;
+        return watch(conn, EPOLLOUT, false);
+    }
+
+    // a closed descriptor left the epoll set, so a new connection is a fresh registration
+    if (!conn->socket.startConnect(conn->port)) {
+        return false;
+    }
+    conn->socket.queueHTTPRequest(conn->host, conn->phase == Phase::Robots ? "/robots.txt" : conn->request, "GET");
+    conn->socket.resetResponse();
+    conn->state = State::Connecting;
+    conn->started = std::chrono::steady_clock::now();
+    return watch(conn, EPOLLOUT, true);
+}
+
+void EpollEngine::advance(Connection* conn, unsigned int events) {
+    if (conn->state == State::Connecting) {
+        if (!conn->socket.finishConnect()) {
+            finish(conn);
+            return;
+        }
+        crawler.recordLatency(worker, Stage::Connect, conn->started);
+        conn->started = std::chrono::steady_clock::now();
+        conn->state = State::Sending;
+    }
+
+    if (conn->state == State::Sending) {
+        int ret = conn->socket.flushRequest();
+        if (ret < 0) {
+            finish(conn);
+            return;
+        }
+        if (ret == 0) {
+            return; // wait for the next EPOLLOUT
+        }
+
+        conn->state = State::Reading;
+        conn->deadline = std::chrono::steady_clock::now() + CONNECTION_TIMEOUT;
+        if (!watch(conn, EPOLLIN, false)) {
+            finish(conn);
+        }
+        return;
+    }
+
+    if (!(events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+        return;
+    }
+
+    size_t limit = conn->phase == Phase::Robots ? ROBOTS_LIMIT : PAGE_LIMIT;
+    int ret = conn->socket.readSome(limit);
+    if (ret < 0) {
+        finish(conn);
+    }
+    else if (ret > 0) {
+        onResponse(conn);
+    }
+}
+
+void EpollEngine::onResponse(Connection* conn) {
+    conn->socket.parseResponse(response);
+    crawler.recordLatency(worker, conn->phase == Phase::Robots ? Stage::Robots : Stage::Page, conn->started);
+
+    if (conn->phase == Phase::Robots) {
+        std::shared_ptr<const RobotsRules> rules = crawler.addRobots(worker, conn->host, conn->port, conn->socket.getResolvedAddress(), conn->started, response);
+        if (!checkRobots(conn, *rules)) {
+            finish(conn);
+            return;
+        }
+
+        // download the page if robots passed
+        conn->phase = Phase::Page;
+        if (!startPhase(conn)) {
+            finish(conn);
+        }
+        return;
+    }
+
+    crawler.processPage(worker, links, conn->host, conn->port, conn->request, conn->depth, conn->socket.getResolvedAddress(), conn->started, response);
+    finish(conn);
+}
+
+bool EpollEngine::checkRobots(Connection* conn, const RobotsRules& rules) {
+    conn->crawlDelayMs = rules.getCrawlDelayMs();
+    if (!rules.allowed(conn->request)) {
+        return false;
+    }
+    crawler.count(worker, Counter::RobotsPassed);
+    return true;
+}
+
+bool EpollEngine::watch(Connection* conn, unsigned int events, bool add) {
+    epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = conn;
+    return epoll_ctl(epfd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, conn->socket.getHandle(), &ev) == 0;
+}
+
+void EpollEngine::finish(Connection* conn) {
+    // closing the descriptor also drops it from the epoll set
+    conn->socket.close();
+
+    // start the IP's cooldown however the crawl of its host ended
+    if (conn->scheduled) {
+        politeness->done(conn->socket.getResolvedAddress(), conn->crawlDelayMs);
+        conn->scheduled = false;
+    }
+
+    // swap-remove from the active list and keep the buffers for reuse
+    Connection* last = connections.back();
+    last->slot = conn->slot;
+    connections[conn->slot] = last;
+    connections.pop_back();
+    freeList.push_back(conn);
+}
+
+void EpollEngine::expire() {
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = connections.size(); i-- > 0; ) {
+        if (connections[i]->deadline < now) {
+            finish(connections[i]);
+        }
+    }
+}
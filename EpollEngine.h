@@ -0,0 +1,88 @@
+#ifndef EPOLL_ENGINE_H
+#define EPOLL_ENGINE_H
+
+#include "Socket.h"
+#include "DNSResolver.h"
+#include "LinkExtractor.h"
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+class Crawler;
+class PolitenessScheduler;
+class RobotsRules;
+
+// event-driven crawl worker: one epoll loop moves many non-blocking
+// connections through robots -> page instead of one blocking socket per thread
+class EpollEngine {
+    public:
+        EpollEngine(Crawler& crawler, int worker, int maxConnections);
+        ~EpollEngine();
+
+        // crawl until the shared queue is drained, every connection finished and no host waits on politeness
+        void Run();
+
+    private:
+        enum class Phase { Robots, Page };
+        enum class State { Resolving, Connecting, Sending, Reading };
+
+        struct Connection {
+            Socket socket;
+            std::string host;
+            std::string request;
+            int port;
+            int depth;
+            Phase phase;
+            State state;
+            size_t slot;  // index into connections
+            bool scheduled;  // handed out by the politeness scheduler, which hears when it ends
+            int crawlDelayMs;  // from the host's robots.txt, for the scheduler
+            std::chrono::steady_clock::time_point started;  // of the lookup, connect or request under way
+            std::chrono::steady_clock::time_point deadline;
+        };
+
+        // take URLs off the queue until the connection budget is used up
+        void fill();
+
+        // a connection slot from the free list, added to connections
+        Connection* acquire();
+
+        // a resolved host goes to the politeness scheduler, or straight to its robots phase
+        void admitted(Connection* conn);
+
+        // hand resolver answers to the connections waiting on them
+        void onResolved();
+
+        // connect for the current phase and register with epoll
+        bool startPhase(Connection* conn);
+
+        // drive a connection as far as it can go after a readiness event
+        void advance(Connection* conn, unsigned int events);
+
+        // a complete response has arrived for the current phase
+        void onResponse(Connection* conn);
+
+        // whether the host's robots rules let its page be fetched
+        bool checkRobots(Connection* conn, const RobotsRules& rules);
+
+        bool watch(Connection* conn, unsigned int events, bool add);
+        void finish(Connection* conn);
+        void expire();
+
+        Crawler& crawler;
+        int worker;  // whose URL queue fill() pops from
+        PolitenessScheduler* politeness;
+        LinkArena links;  // reused for every page this worker parses
+        int epfd;
+        size_t maxConnections;
+        bool queueDrained;
+        DNSResolver resolver;
+        bool asyncDNS;  // false: resolve inline through getaddrinfo
+        std::vector<DNSResult> dnsResults;
+        std::vector<Connection*> connections;
+        std::vector<Connection*> freeList;
+        HTTPResponse response;
+};
+
+#endif // EPOLL_ENGINE_H
@@ -0,0 +1,94 @@
+#include "FingerprintSet.h"
+#include "OpenAddressing.h"
+
+#include <cstring>
+
+#define FINGERPRINT_SET_INITIAL_SLOTS 64
+
+// fingerprints are already uniform, so a fingerprint is its own table hash
+static uint64_t slotHash(uint64_t key) {
+    return key;
+}
+
+FingerprintSet::FingerprintSet() : slotBytes(0) {
+}
+
+uint64_t FingerprintSet::fingerprint(FingerprintKind kind, std::string_view text) {
+    // eight bytes per multiply, then the tail; the length and kind keep "a" and
+    // "a\0" or a host and the same text as a URL apart
+    uint64_t h = mixHash((uint64_t)kind * 0x9E3779B97F4A7C15ull ^ text.size());
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, text.data() + i, 8);
+        h = (h ^ mixHash(word)) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    if (i < text.size()) {
+        memcpy(&tail, text.data() + i, text.size() - i);
+    }
+    return mixHash(h ^ mixHash(tail + 1));
+}
+
+// the high bits pick the shard, the low ones the slot
+size_t FingerprintSet::shardIndex(uint64_t key) {
+    return (size_t)(key >> (64 - FINGERPRINT_SET_SHARD_BITS));
+}
+
+bool FingerprintSet::insert(uint64_t key) {
+    Shard& shard = shards[shardIndex(key)];
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    if (key == 0) {
+        bool inserted = !shard.hasZero;
+        shard.hasZero = true;
+        shard.keys.store(shard.keys.load(std::memory_order_relaxed) + inserted, std::memory_order_relaxed);
+        return inserted;
+    }
+
+    // fingerprints are uniformly spread, so probes stay short up to three quarters full
+    if ((shard.count + 1) * 4 > shard.slots.size() * 3) {
+        long before = (long)(shard.slots.size() * sizeof(uint64_t));
+        growTable(shard.slots, FINGERPRINT_SET_INITIAL_SLOTS, slotHash);
+        slotBytes += (long)(shard.slots.size() * sizeof(uint64_t)) - before;
+    }
+
+    if (!probeInsert(shard.slots, key, slotHash)) {
+        return false;
+    }
+    shard.count++;
+    shard.keys.store(shard.keys.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+bool FingerprintSet::erase(uint64_t key) {
+    Shard& shard = shards[shardIndex(key)];
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    if (key == 0) {
+        bool erased = shard.hasZero;
+        shard.hasZero = false;
+        shard.keys.store(shard.keys.load(std::memory_order_relaxed) - erased, std::memory_order_relaxed);
+        return erased;
+    }
+    if (!probeErase(shard.slots, key, slotHash)) {
+        return false;
+    }
+    shard.count--;
+    shard.keys.store(shard.keys.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    return true;
+}
+
+long FingerprintSet::size() const {
+    // no shared counter: one would put every insert from every worker on a single cache line
+    long total = 0;
+    for (const Shard& shard : shards) {
+        total += shard.keys.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+long FingerprintSet::memoryBytes() const {
+    return (long)sizeof(*this) + slotBytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,58 @@
+#ifndef FINGERPRINT_SET_H
+#define FINGERPRINT_SET_H
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+#define FINGERPRINT_SET_SHARD_BITS 8  // 256 shards
+
+// what a fingerprint was taken of, so one set can hold several kinds of key
+enum class FingerprintKind : uint64_t {
+    AdmittedHost = 1,  // a host the crawler has taken on
+    QueuedHost,        // a host the frontier holds a link for
+    QueuedURL          // a link or seed the frontier has queued
+};
+
+// concurrent set of 64-bit fingerprints in sharded open-addressing tables, for
+// dedupe at crawl scale: about 11-21 bytes per key and no allocation per insert,
+// where a set of strings costs a heap node and a copy of the text. two different
+// keys collide with probability about n / 2^64, which a crawl can afford
+class FingerprintSet {
+    public:
+        FingerprintSet();
+
+        static uint64_t fingerprint(FingerprintKind kind, std::string_view text);
+
+        // true if the fingerprint was not present before
+        bool insert(uint64_t key);
+
+        // undo an insert; true if the fingerprint was present
+        bool erase(uint64_t key);
+
+        // approximate: sums the shards without locking them
+        long size() const;
+        long memoryBytes() const;
+
+    private:
+        // linear-probing table whose zero key marks an empty slot, so the zero
+        // fingerprint itself is tracked by a flag. keys is only written under the
+        // lock, and atomic so size() can read it without one
+        struct alignas(64) Shard {
+            std::mutex lock;
+            std::vector<uint64_t> slots;
+            size_t count = 0;  // occupied slots
+            bool hasZero = false;
+            std::atomic<long> keys{ 0 };
+        };
+
+        static size_t shardIndex(uint64_t key);
+
+        Shard shards[1 << FINGERPRINT_SET_SHARD_BITS];
+        std::atomic<long> slotBytes;  // only changes when a shard grows
+};
+
+#endif // FINGERPRINT_SET_H
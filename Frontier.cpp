@@ -0,0 +1,351 @@
+#include "Frontier.h"
+
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+#define FRONTIER_RECORD_MAX (6 + 4096)
+
+// a queued link in memory, for the RAM budget
+static long linkBytes(const FrontierLink& link) {
+    return (long)(sizeof(FrontierLink) + link.url.size());
+}
+
+// spilled links are stored as u16 url length, u16 host length, u16 depth, then the url
+static void serializeLink(const FrontierLink& link, std::string& out) {
+    uint16_t fields[3] = { (uint16_t)link.url.size(), (uint16_t)link.hostLength, (uint16_t)link.depth };
+    out.append((const char*)fields, sizeof(fields));
+    out.append(link.url);
+}
+
+static void deserializeLinks(const std::string& records, std::deque<FrontierLink>& out, long& bytes) {
+    size_t pos = 0;
+    while (pos + 6 <= records.size()) {
+        uint16_t fields[3];
+        memcpy(fields, records.data() + pos, sizeof(fields));
+        pos += sizeof(fields);
+        if (pos + fields[0] > records.size()) {
+            break;
+        }
+        FrontierLink link;
+        link.url.assign(records, pos, fields[0]);
+        link.hostLength = fields[1];
+        link.depth = fields[2];
+        pos += fields[0];
+        bytes += linkBytes(link);
+        out.push_back(std::move(link));
+    }
+}
+
+// breadth first: everything one link closer to the seeds goes first
+class DepthPriority : public FrontierPriority {
+    public:
+        int rank(const FrontierLink& link) override {
+            return std::min(link.depth, FRONTIER_LEVELS - 1);
+        }
+};
+
+// host diversity: the n-th link into a site (its last two labels) waits behind
+// sites seen fewer times, one bucket per doubling of n
+class HostPriority : public FrontierPriority {
+    public:
+        HostPriority() : counts(new std::atomic<uint32_t>[1 << 16]()) {}
+
+        int rank(const FrontierLink& link) override {
+            std::string_view host = link.host();
+            size_t dot = host.rfind('.');
+            if (dot != std::string_view::npos && dot > 0) {
+                size_t second = host.rfind('.', dot - 1);
+                if (second != std::string_view::npos) {
+                    host.remove_prefix(second + 1);
+                }
+            }
+
+            // a shared counter per hash bucket; collisions only blur the order
+            uint32_t seen = counts[std::hash<std::string_view>()(host) & 0xFFFF].fetch_add(1, std::memory_order_relaxed);
+            int bits = 0;
+            while (seen > 0) {
+                bits++;
+                seen >>= 1;
+            }
+            return std::min(bits, FRONTIER_LEVELS - 1);
+        }
+
+    private:
+        std::unique_ptr<std::atomic<uint32_t>[]> counts;
+};
+
+// a cheap page score: shallow, short URLs with few path segments and no query
+// string look like site entry points and go first
+class ScorePriority : public FrontierPriority {
+    public:
+        int rank(const FrontierLink& link) override {
+            std::string_view path = std::string_view(link.url).substr(7 + link.hostLength);
+            int score = link.depth * 8 + (int)(link.url.size() / 64);
+            for (char c : path) {
+                if (c == '/') {
+                    score++;
+                }
+                else if (c == '?') {
+                    score += 4;
+                    break;
+                }
+            }
+            return std::min(score, FRONTIER_LEVELS - 1);
+        }
+};
+
+std::unique_ptr<FrontierPriority> FrontierPriority::create(FrontierOrder order) {
+    switch (order) {
+    case FrontierOrder::Hosts: return std::unique_ptr<FrontierPriority>(new HostPriority);
+    case FrontierOrder::Score: return std::unique_ptr<FrontierPriority>(new ScorePriority);
+    default: return std::unique_ptr<FrontierPriority>(new DepthPriority);
+    }
+}
+
+Frontier::Frontier(std::unique_ptr<FrontierPriority> priority, FingerprintSet& seen, FrontierDedupe dedupe, int numWorkers, long readAhead, long maxSize)
+    : priority(std::move(priority)), seen(seen), dedupe(dedupe), lowest(FRONTIER_LEVELS), numWorkers(numWorkers), idleWorkers(0), closed(false), finished(false),
+      ramBudget(0), segmentBytes(0), headBytes(0), tailBytes(0),
+      readAhead(readAhead), maxSize(maxSize), total(0), inserted(0), dropped(0) {
+}
+
+bool Frontier::enableSpill(const std::string& dir, long ramBytes) {
+    store.reset(new SegmentStore(dir));
+    if (!store->open()) {
+        store.reset();
+        return false;
+    }
+    ramBudget = ramBytes;
+    segmentBytes = std::min(std::max((size_t)(ramBytes / 64), (size_t)FRONTIER_SEGMENT_MIN), (size_t)FRONTIER_SEGMENT_MAX);
+    return true;
+}
+
+long Frontier::memoryBytes() const {
+    return headBytes + tailBytes + (store ? store->memoryBytes() : 0);
+}
+
+void Frontier::append(int index, FrontierLink& link) {
+    Level& level = levels[index];
+    long bytes = linkBytes(link);
+
+    // once a bucket has spilled, later links go behind the spilled ones to keep it FIFO
+    if (!store || (level.segments.empty() && level.tailCount == 0 && memoryBytes() + bytes <= ramBudget)) {
+        headBytes += bytes;
+        level.head.push_back(std::move(link));
+    }
+    else {
+        size_t before = level.tail.size();
+        serializeLink(link, level.tail);
+        tailBytes += (long)(level.tail.size() - before);
+        level.tailCount++;
+
+        if (level.tail.size() >= segmentBytes) {
+            tailBytes -= (long)level.tail.size();
+            level.segments.push_back(store->write(std::move(level.tail), level.tailCount));
+            level.tail = std::string();
+            level.tail.reserve(segmentBytes + FRONTIER_RECORD_MAX);
+            level.tailCount = 0;
+        }
+    }
+    level.count++;
+    lowest = std::min(lowest, index);
+    total++;
+}
+
+void Frontier::refill(Level& level) {
+    std::string records;
+    long expected;
+    if (!level.segments.empty()) {
+        // normally read ahead already; otherwise this waits for the disk
+        expected = level.segments.front()->count;
+        store->take(level.segments.front(), records);
+        level.segments.pop_front();
+        level.prefetched = false;
+    }
+    else {
+        expected = level.tailCount;
+        tailBytes -= (long)level.tail.size();
+        records.swap(level.tail);
+        level.tailCount = 0;
+    }
+
+    // a segment that could not be read back is counted as dropped
+    size_t before = level.head.size();
+    deserializeLinks(records, level.head, headBytes);
+    long lost = expected - (long)(level.head.size() - before);
+    if (lost > 0) {
+        level.count -= lost;
+        total -= lost;
+        dropped += lost;
+    }
+}
+
+void Frontier::pushSeed(std::string url) {
+    if (dedupe == FrontierDedupe::URL && !seen.insert(FingerprintSet::fingerprint(FingerprintKind::QueuedURL, url))) {
+        return;
+    }
+
+    // seeds are depth 0 and go in the first bucket whatever the order
+    std::lock_guard<std::mutex> guard(lock);
+    FrontierLink seed;
+    seed.url = std::move(url);
+    append(0, seed);
+    if (idleWorkers > 0) {
+        notEmpty.notify_one();
+    }
+}
+
+void Frontier::waitForRoom() {
+    if (total.load() < readAhead) {
+        return;
+    }
+    std::unique_lock<std::mutex> guard(lock);
+    notFull.wait(guard, [this] { return total.load() < readAhead || finished; });
+}
+
+void Frontier::close() {
+    std::lock_guard<std::mutex> guard(lock);
+    closed = true;
+    if (total.load() == 0 && idleWorkers == numWorkers) {
+        finished = true;
+    }
+    notEmpty.notify_all();
+}
+
+long Frontier::push(std::vector<FrontierLink>& batch) {
+    long offered = (long)batch.size();
+    long queued = 0;
+    int ranks[FRONTIER_BATCH];
+    uint64_t keys[FRONTIER_BATCH];
+
+    // dedupe and rank a chunk before taking the lock, so it is held only to append
+    for (size_t start = 0; start < batch.size() && total.load() < maxSize; start += FRONTIER_BATCH) {
+        size_t end = std::min(batch.size(), start + FRONTIER_BATCH);
+        size_t keep = 0;
+        for (size_t i = start; i < end; i++) {
+            uint64_t key = dedupe == FrontierDedupe::URL ? FingerprintSet::fingerprint(FingerprintKind::QueuedURL, batch[i].url)
+                                                         : FingerprintSet::fingerprint(FingerprintKind::QueuedHost, batch[i].host());
+            if (!seen.insert(key)) {
+                continue;
+            }
+            keys[keep] = key;
+            ranks[keep] = priority->rank(batch[i]);
+            if (start + keep != i) {
+                batch[start + keep] = std::move(batch[i]);
+            }
+            keep++;
+        }
+
+        size_t appended = 0;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for (; appended < keep && total.load() < maxSize; appended++) {
+                append(ranks[appended], batch[start + appended]);
+            }
+            if (appended > 0 && idleWorkers > 0) {
+                notEmpty.notify_all();
+            }
+        }
+        queued += (long)appended;
+
+        // a host or link claimed by one the full frontier then dropped can be queued again later
+        for (size_t i = appended; i < keep; i++) {
+            seen.erase(keys[i]);
+        }
+    }
+    batch.clear();
+
+    inserted += queued;
+    dropped += offered - queued;
+    return queued;
+}
+
+bool Frontier::take(std::string& url, int& depth) {
+    while (true) {
+        while (lowest < FRONTIER_LEVELS && levels[lowest].count == 0) {
+            lowest++;
+        }
+        if (lowest == FRONTIER_LEVELS) {
+            return false;
+        }
+        if (!levels[lowest].head.empty()) {
+            break;
+        }
+        refill(levels[lowest]);
+    }
+
+    Level& level = levels[lowest];
+    FrontierLink& link = level.head.front();
+    headBytes -= linkBytes(link);
+    url = std::move(link.url);
+    depth = link.depth;
+    level.head.pop_front();
+    level.count--;
+    total--;
+
+    // read ahead: start loading the next segment while half a segment is still in memory
+    if (!level.prefetched && !level.segments.empty() && (long)level.head.size() <= level.segments.front()->count / 2) {
+        store->prefetch(level.segments.front());
+        level.prefetched = true;
+    }
+
+    // the seed producer is the only one that waits for room
+    if (total.load() < readAhead) {
+        notFull.notify_one();
+    }
+    return true;
+}
+
+bool Frontier::pop(std::string& url, int& depth) {
+    std::unique_lock<std::mutex> guard(lock);
+    while (!take(url, depth)) {
+        if (finished) {
+            return false;
+        }
+
+        // the last worker to go idle with nothing queued and no seeds left ends the crawl
+        idleWorkers++;
+        if (closed && idleWorkers == numWorkers) {
+            finished = true;
+            notEmpty.notify_all();
+            notFull.notify_all();
+            return false;
+        }
+        notEmpty.wait(guard, [this] { return total.load() > 0 || finished; });
+        idleWorkers--;
+    }
+    return true;
+}
+
+bool Frontier::tryPop(std::string& url, int& depth) {
+    if (total.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    return take(url, depth);
+}
+
+void Frontier::leave() {
+    std::lock_guard<std::mutex> guard(lock);
+    numWorkers--;
+    if (closed && total.load() == 0 && idleWorkers == numWorkers) {
+        finished = true;
+        notEmpty.notify_all();
+    }
+}
+
+long Frontier::size() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+long Frontier::getInserted() const {
+    return inserted.load();
+}
+
+long Frontier::getDropped() const {
+    return dropped.load();
+}
+
+long Frontier::getSpilledBytes() const {
+    return store ? store->getBytesWritten() : 0;
+}
@@ -0,0 +1,144 @@
+#ifndef FRONTIER_H
+#define FRONTIER_H
+
+#include "Options.h"
+#include "FingerprintSet.h"
+#include "SegmentStore.h"
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#define FRONTIER_LEVELS 64  // priority buckets, 0 is crawled first
+#define FRONTIER_BATCH 256  // links deduped and ranked per lock
+#define FRONTIER_SEGMENT_MIN (64 * 1024)        // bytes of serialized links per spilled segment,
+#define FRONTIER_SEGMENT_MAX (4 * 1024 * 1024)  // a 64th of the RAM budget within these bounds
+
+// a normalized "http://host[:port]/request" and how many links away from a seed it is
+struct FrontierLink {
+    std::string url;
+    size_t hostLength = 0;  // the host is url[7, 7 + hostLength)
+    int depth = 0;
+
+    std::string_view host() const {
+        return std::string_view(url).substr(7, hostLength);
+    }
+};
+
+// what a link is deduped on before it is queued
+enum class FrontierDedupe {
+    Host,  // one link per host, for crawls that fetch one page per host
+    URL    // every distinct link, so later pages on an admitted host are crawled too
+};
+
+// decides which bucket a link is queued in; rank() runs outside the frontier
+// lock, once per link, so an implementation must be thread safe
+class FrontierPriority {
+    public:
+        virtual ~FrontierPriority() {}
+
+        // 0 .. FRONTIER_LEVELS - 1
+        virtual int rank(const FrontierLink& link) = 0;
+
+        // one of the built-in orders
+        static std::unique_ptr<FrontierPriority> create(FrontierOrder order);
+};
+
+// priority frontier for recursive crawls: seed URLs and extracted links share
+// FRONTIER_LEVELS FIFO buckets and pop() always takes from the lowest non-empty
+// one. links arrive a page at a time under one lock, are deduped on their host
+// or, with FrontierDedupe::URL, on the whole link, and dropped once maxSize are
+// queued. a host (or link) is claimed by its first queued link; one the full
+// frontier drops leaves it free for a later link.
+// unlike WorkQueues it cannot end when the seeds run out, since a worker still
+// crawling may add more links: pop() only reports the end once the seeds are
+// closed, nothing is queued and every worker is waiting in pop().
+// with enableSpill() each bucket keeps a hot head in memory while the whole
+// frontier fits the RAM budget; past it, new links are appended to the bucket's
+// tail, which is sealed into compressed segment files. a bucket is read back in
+// order (head, segments, tail), and its next segment is loaded ahead of time
+// once the head runs low, so memory stays flat however large the frontier gets
+class Frontier {
+    public:
+        // links are claimed in seen, which the crawler shares for its own dedupe
+        Frontier(std::unique_ptr<FrontierPriority> priority, FingerprintSet& seen, FrontierDedupe dedupe, int numWorkers, long readAhead, long maxSize);
+
+        // spill links past ramBytes to segment files in dir; false if dir is not writable
+        bool enableSpill(const std::string& dir, long ramBytes);
+
+        // seeds are never dropped; the producer waits in waitForRoom() instead.
+        // with FrontierDedupe::URL a repeated seed is skipped, matched as written
+        void pushSeed(std::string url);
+        void waitForRoom();
+        void close();
+
+        // queue one page's links, emptying batch; returns how many were queued
+        long push(std::vector<FrontierLink>& batch);
+
+        // highest-priority URL, waiting while other workers may still add some
+        bool pop(std::string& url, int& depth);
+        bool tryPop(std::string& url, int& depth);
+
+        // a worker stopped for good and will never call pop() again
+        void leave();
+
+        // approximate number of queued URLs, read without locking
+        long size() const;
+        long getInserted() const;
+        long getDropped() const;
+        long getSpilledBytes() const;  // compressed bytes written to segment files so far
+
+    private:
+        // links in one bucket, in the order they were queued
+        struct Level {
+            std::deque<FrontierLink> head;
+            std::deque<std::shared_ptr<Segment>> segments;
+            std::string tail;  // serialized links queued after the last segment
+            long tailCount = 0;
+            long count = 0;
+            bool prefetched = false;  // the first segment was already asked for
+        };
+
+        bool take(std::string& url, int& depth);
+        void append(int level, FrontierLink& link);
+
+        // move the next segment, or else the tail, into the empty head
+        void refill(Level& level);
+
+        // bytes of queued links held in memory
+        long memoryBytes() const;
+
+        std::unique_ptr<FrontierPriority> priority;
+        FingerprintSet& seen;  // QueuedHost or QueuedURL fingerprints of what was queued
+        FrontierDedupe dedupe;
+
+        std::mutex lock;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        Level levels[FRONTIER_LEVELS];
+        int lowest;  // no bucket below this one holds anything
+        int numWorkers;
+        int idleWorkers;
+        bool closed;
+        bool finished;
+
+        std::unique_ptr<SegmentStore> store;
+        long ramBudget;
+        size_t segmentBytes;
+        long headBytes;
+        long tailBytes;
+
+        long readAhead;
+        long maxSize;
+        std::atomic<long> total;
+        std::atomic<long> inserted;
+        std::atomic<long> dropped;
+};
+
+#endif // FRONTIER_H
@@ -1,5 +1,8 @@
 #pragma once
 
+// the old parser, now only linked by benchmarks comparing against LinkExtractor.
+// prebuilt parser libraries only exist for MSVC; other platforms compile HTMLParserPosix.cpp
+#ifdef _MSC_VER
 #ifdef _WIN64
 #ifdef _DEBUG
 #pragma comment (lib, "HTMLParser_debug_x64.lib")
@@ -13,6 +16,7 @@
 #pragma comment (lib, "HTMLParser_release_win32.lib")
 #endif
 #endif
+#endif
 
 #define MAX_HOST_LEN		256
 #define MAX_URL_LEN			2048
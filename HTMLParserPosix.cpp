@@ -0,0 +1,174 @@
+// in-tree stand-in for the prebuilt HTMLParser_*.lib on platforms without MSVC
+// extracts <a href> targets and resolves them against the base URL, matching the
+// output format of the original library: nLinks null-terminated URLs back to back.
+// the crawler uses LinkExtractor now; this is kept as the benchmarks' baseline
+
+#ifndef _MSC_VER
+
+#include "HTMLParserBase.h"
+
+#include <cstring>
+#include <cctype>
+#include <vector>
+
+static bool startsWithNoCase(const char* p, const char* end, const char* prefix) {
+	size_t len = strlen(prefix);
+	if ((size_t)(end - p) < len) {
+		return false;
+	}
+	for (size_t i = 0; i < len; i++) {
+		if (tolower((unsigned char)p[i]) != prefix[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// append an absolute http URL for link (relative to baseURL) to out; false if not crawlable
+static bool resolveLink(const char* link, size_t linkLen, const char* baseURL, size_t baseLen, std::vector<char>& out) {
+	const char* linkEnd = link + linkLen;
+
+	// trim surrounding whitespace
+	while (link < linkEnd && isspace((unsigned char)*link)) link++;
+	while (linkEnd > link && isspace((unsigned char)linkEnd[-1])) linkEnd--;
+	linkLen = linkEnd - link;
+
+	if (linkLen == 0 || link[0] == '#') {
+		return false;
+	}
+
+	// drop the fragment
+	const char* hash = (const char*)memchr(link, '#', linkLen);
+	if (hash) {
+		linkLen = hash - link;
+	}
+
+	size_t start = out.size();
+	if (startsWithNoCase(link, link + linkLen, "http://")) {
+		out.insert(out.end(), link, link + linkLen);
+	}
+	else if (linkLen >= 2 && link[0] == '/' && link[1] == '/') {
+		static const char scheme[] = "http:";
+		out.insert(out.end(), scheme, scheme + 5);
+		out.insert(out.end(), link, link + linkLen);
+	}
+	else {
+		// any other scheme (https, mailto, javascript, ...) is not crawlable
+		for (size_t i = 0; i < linkLen && link[i] != '/' && link[i] != '?'; i++) {
+			if (link[i] == ':') {
+				return false;
+			}
+		}
+
+		// split base into "http://host" and the directory of its path
+		const char* hostStart = baseURL + 7;
+		const char* baseEnd = baseURL + baseLen;
+		const char* pathStart = (const char*)memchr(hostStart, '/', baseEnd - hostStart);
+		if (!pathStart) {
+			pathStart = baseEnd;
+		}
+
+		if (link[0] == '/') {
+			out.insert(out.end(), baseURL, pathStart);
+		}
+		else {
+			const char* dirEnd = pathStart;
+			for (const char* p = baseEnd; p > pathStart; p--) {
+				if (p[-1] == '/') {
+					dirEnd = p;
+					break;
+				}
+			}
+			out.insert(out.end(), baseURL, dirEnd);
+			if (dirEnd == pathStart) {
+				out.push_back('/');
+			}
+		}
+		out.insert(out.end(), link, link + linkLen);
+	}
+
+	if (out.size() - start >= MAX_URL_LEN) {
+		out.resize(start);
+		return false;
+	}
+	out.push_back('\0');
+	return true;
+}
+
+HTMLParserBase::HTMLParserBase() : parser(nullptr), buffer(new std::vector<char>) {
+}
+
+HTMLParserBase::~HTMLParserBase() {
+	delete (std::vector<char>*)buffer;
+}
+
+char* HTMLParserBase::Parse(char* htmlCode, int codeSize, char* baseURL, int urlLen, int* nLinks) {
+	std::vector<char>& out = *(std::vector<char>*)buffer;
+	out.clear();
+	*nLinks = 0;
+
+	if (!htmlCode || codeSize < 0 || !baseURL || urlLen <= 0) {
+		*nLinks = -1;
+		return out.data();
+	}
+
+	// callers may include the null terminator in urlLen
+	size_t baseLen = strnlen(baseURL, urlLen);
+	if (!startsWithNoCase(baseURL, baseURL + baseLen, "http://")) {
+		*nLinks = -1;
+		return out.data();
+	}
+
+	const char* p = htmlCode;
+	const char* end = htmlCode + codeSize;
+
+	while ((p = (const char*)memchr(p, '<', end - p)) != nullptr) {
+		p++;
+		if (p + 1 >= end || tolower((unsigned char)p[0]) != 'a' || !isspace((unsigned char)p[1])) {
+			continue;
+		}
+		p += 2;
+
+		// walk the attributes of this <a> tag
+		while (p < end && *p != '>') {
+			while (p < end && isspace((unsigned char)*p)) p++;
+			const char* name = p;
+			while (p < end && !isspace((unsigned char)*p) && *p != '=' && *p != '>') p++;
+			size_t nameLen = p - name;
+			while (p < end && isspace((unsigned char)*p)) p++;
+
+			if (p >= end || *p != '=') {
+				if (nameLen == 0 && p < end && *p != '>') {
+					p++;
+				}
+				continue;
+			}
+			p++;
+			while (p < end && isspace((unsigned char)*p)) p++;
+
+			const char* value = p;
+			if (p < end && (*p == '"' || *p == '\'')) {
+				char quote = *p++;
+				value = p;
+				while (p < end && *p != quote) p++;
+			}
+			else {
+				while (p < end && !isspace((unsigned char)*p) && *p != '>') p++;
+			}
+			size_t valueLen = p - value;
+			if (p < end && (*p == '"' || *p == '\'')) {
+				p++;
+			}
+
+			if (nameLen == 4 && startsWithNoCase(name, name + 4, "href")) {
+				if (resolveLink(value, valueLen, baseURL, baseLen, out)) {
+					(*nLinks)++;
+				}
+			}
+		}
+	}
+
+	return out.data();
+}
+
+#endif // _MSC_VER
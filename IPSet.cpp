@@ -0,0 +1,92 @@
+#include "IPSet.h"
+#include "OpenAddressing.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define IP_SET_INITIAL_SLOTS 64
+#define IP_SET_BITMAP_WORDS ((size_t)1 << 26)  // 2^32 bits
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "bitmap words must be plain 64-bit integers");
+
+// nearby addresses differ in a few low bits, which mixHash spreads over every bit
+static uint64_t hashKey(uint32_t key) {
+    return mixHash(key);
+}
+
+static uint64_t hashKey(const IPv6Key& key) {
+    return mixHash(key.hi ^ mixHash(key.lo));
+}
+
+static size_t shardIndex(uint64_t hash) {
+    return (size_t)(hash >> (64 - IP_SET_SHARD_BITS));
+}
+
+IPSet::IPSet(IPSetMode mode) : mode(mode), bitmap(nullptr) {
+    if (mode == IPSetMode::Bitmap) {
+        // calloc of this size maps fresh zero pages, so only touched pages cost memory
+        bitmap = static_cast<std::atomic<uint64_t>*>(calloc(IP_SET_BITMAP_WORDS, sizeof(uint64_t)));
+        if (bitmap == nullptr) {
+            printf("Failed to allocate the 512 MB IP bitmap, falling back to the compact set\n");
+            this->mode = IPSetMode::Compact;
+        }
+    }
+}
+
+IPSet::~IPSet() {
+    free(bitmap);
+}
+
+IPSetMode IPSet::getMode() const {
+    return mode;
+}
+
+template <typename Key>
+bool IPSet::insertKey(Shard<Key>& shard, const Key& key) {
+    static const Key empty = {};
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    if (key == empty) {
+        bool inserted = !shard.hasZero;
+        shard.hasZero = true;
+        return inserted;
+    }
+
+    // grow at half full to keep probe sequences short; the low hash bits pick
+    // the slot, the high ones already picked the shard
+    auto hash = [](const Key& k) { return hashKey(k); };
+    if ((shard.count + 1) * 2 > shard.slots.size()) {
+        growTable(shard.slots, IP_SET_INITIAL_SLOTS, hash);
+    }
+    if (!probeInsert(shard.slots, key, hash)) {
+        return false;
+    }
+    shard.count++;
+    return true;
+}
+
+bool IPSet::insert(in_addr addr) {
+    uint32_t key = ntohl(addr.s_addr);
+
+    if (bitmap) {
+        uint64_t bit = 1ull << (key & 63);
+        return (bitmap[key >> 6].fetch_or(bit, std::memory_order_relaxed) & bit) == 0;
+    }
+
+    return insertKey(shards4[shardIndex(hashKey(key))], key);
+}
+
+bool IPSet::insert(const in6_addr& addr) {
+    static const unsigned char v4Mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+    if (memcmp(addr.s6_addr, v4Mapped, sizeof(v4Mapped)) == 0) {
+        in_addr v4;
+        memcpy(&v4, addr.s6_addr + 12, sizeof(v4));
+        return insert(v4);
+    }
+
+    IPv6Key key;
+    memcpy(&key.hi, addr.s6_addr, 8);
+    memcpy(&key.lo, addr.s6_addr + 8, 8);
+    return insertKey(shards6[shardIndex(hashKey(key))], key);
+}
@@ -0,0 +1,59 @@
+#ifndef IP_SET_H
+#define IP_SET_H
+
+#include "Socket.h"
+#include "Options.h"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#define IP_SET_SHARD_BITS 6  // 64 shards
+
+struct IPv6Key {
+    uint64_t hi;
+    uint64_t lo;
+
+    bool operator==(const IPv6Key& other) const {
+        return hi == other.hi && lo == other.lo;
+    }
+};
+
+// concurrent insert-only set of IP addresses keyed on the raw address instead of
+// its text form. IPv4 goes into either compact open-addressing shards (about
+// 8-16 bytes per address) or one 2^32-bit bitmap (512 MB of lazily committed
+// zero pages, one atomic OR per lookup); IPv6 always uses compact 128-bit shards
+class IPSet {
+    public:
+        explicit IPSet(IPSetMode mode);
+        ~IPSet();
+
+        // true if the address was not present before
+        bool insert(in_addr addr);
+        bool insert(const in6_addr& addr);  // v4-mapped addresses share the IPv4 set
+
+        IPSetMode getMode() const;
+
+    private:
+        // linear-probing table whose all-zero key marks an empty slot, so the
+        // zero address itself is tracked by a flag
+        template <typename Key>
+        struct alignas(64) Shard {
+            std::mutex lock;
+            std::vector<Key> slots;
+            size_t count = 0;
+            bool hasZero = false;
+        };
+
+        template <typename Key>
+        static bool insertKey(Shard<Key>& shard, const Key& key);
+
+        IPSetMode mode;
+        std::atomic<uint64_t>* bitmap;
+        Shard<uint32_t> shards4[1 << IP_SET_SHARD_BITS];
+        Shard<IPv6Key> shards6[1 << IP_SET_SHARD_BITS];
+};
+
+#endif // IP_SET_H
@@ -0,0 +1,229 @@
+#ifdef __linux__
+
+#include "IoUring.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#define BUFFER_GROUP 0
+
+static int sysSetup(unsigned entries, io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize) {
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize);
+}
+
+static int sysRegister(int fd, unsigned opcode, void* arg, unsigned nrArgs) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+IoUring::IoUring()
+    : ringFd(-1), sqRing(MAP_FAILED), sqRingSize(0), sqHead(nullptr), sqTail(nullptr), sqMask(nullptr), sqArray(nullptr),
+      sqEntries(0), sqes((io_uring_sqe*)MAP_FAILED), sqesSize(0), sqeHead(0), sqeTail(0),
+      cqRing(MAP_FAILED), cqRingSize(0), cqHead(nullptr), cqTail(nullptr), cqMask(nullptr), cqes(nullptr),
+      bufRing((io_uring_buf*)MAP_FAILED), bufRingSize(0), bufMemory(nullptr), numBuffers(0), bufSize(0), bufTail(0) {
+}
+
+IoUring::~IoUring() {
+    release();
+}
+
+void IoUring::release() {
+    if (bufRing != MAP_FAILED) {
+        munmap(bufRing, bufRingSize);
+        bufRing = (io_uring_buf*)MAP_FAILED;
+    }
+    delete[] bufMemory;
+    bufMemory = nullptr;
+
+    if (sqes != MAP_FAILED) {
+        munmap(sqes, sqesSize);
+        sqes = (io_uring_sqe*)MAP_FAILED;
+    }
+    if (cqRing != MAP_FAILED && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    cqRing = MAP_FAILED;
+    if (sqRing != MAP_FAILED) {
+        munmap(sqRing, sqRingSize);
+        sqRing = MAP_FAILED;
+    }
+    if (ringFd >= 0) {
+        ::close(ringFd);
+        ringFd = -1;
+    }
+}
+
+bool IoUring::init(unsigned entries, unsigned buffers, unsigned size) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ringFd = sysSetup(entries, &params);
+    if (ringFd < 0) {
+        return false;
+    }
+
+    // map the rings
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap && cqRingSize > sqRingSize) {
+        sqRingSize = cqRingSize;
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        release();
+        return false;
+    }
+    if (singleMmap) {
+        cqRing = sqRing;
+    }
+    else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            release();
+            return false;
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        release();
+        return false;
+    }
+
+    char* sq = (char*)sqRing;
+    sqHead = (unsigned*)(sq + params.sq_off.head);
+    sqTail = (unsigned*)(sq + params.sq_off.tail);
+    sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    sqArray = (unsigned*)(sq + params.sq_off.array);
+    sqEntries = params.sq_entries;
+    sqeHead = sqeTail = *sqTail;
+
+    char* cq = (char*)cqRing;
+    cqHead = (unsigned*)(cq + params.cq_off.head);
+    cqTail = (unsigned*)(cq + params.cq_off.tail);
+    cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // register the provided buffer ring used by multishot recv
+    numBuffers = buffers;
+    bufSize = size;
+    bufRingSize = numBuffers * sizeof(io_uring_buf);
+    bufRing = (io_uring_buf*)mmap(nullptr, bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufRing == MAP_FAILED) {
+        release();
+        return false;
+    }
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)bufRing;
+    reg.ring_entries = numBuffers;
+    reg.bgid = BUFFER_GROUP;
+    if (sysRegister(ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        release();
+        return false;
+    }
+
+    bufMemory = new char[(size_t)numBuffers * bufSize];
+    bufTail = 0;
+    for (unsigned i = 0; i < numBuffers; i++) {
+        recycleBuffer((uint16_t)i);
+    }
+    return true;
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (sqeTail - head >= sqEntries) {
+        return nullptr;
+    }
+    io_uring_sqe* sqe = &sqes[sqeTail & *sqMask];
+    sqeTail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUring::submitAndWait(unsigned minComplete, int timeoutMs) {
+    // publish queued entries to the kernel
+    unsigned toSubmit = sqeTail - sqeHead;
+    unsigned tail = *sqTail;
+    for (unsigned i = 0; i < toSubmit; i++) {
+        sqArray[tail & *sqMask] = sqeHead & *sqMask;
+        tail++;
+        sqeHead++;
+    }
+    __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+    unsigned flags = 0;
+    io_uring_getevents_arg arg;
+    __kernel_timespec ts;
+    memset(&arg, 0, sizeof(arg));
+    if (minComplete > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeoutMs >= 0) {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = (long long)(timeoutMs % 1000) * 1000000;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+    }
+
+    int ret;
+    do {
+        if (flags & IORING_ENTER_EXT_ARG) {
+            ret = sysEnter(ringFd, toSubmit, minComplete, flags, &arg, sizeof(arg));
+        }
+        else {
+            ret = sysEnter(ringFd, toSubmit, minComplete, flags, nullptr, 0);
+        }
+    } while (ret < 0 && errno == EINTR);
+
+    return ret < 0 ? -errno : ret;
+}
+
+io_uring_cqe* IoUring::peekCqe() {
+    unsigned head = *cqHead;
+    if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+        return nullptr;
+    }
+    return &cqes[head & *cqMask];
+}
+
+void IoUring::seenCqe() {
+    __atomic_store_n(cqHead, *cqHead + 1, __ATOMIC_RELEASE);
+}
+
+uint16_t IoUring::bufferGroup() const {
+    return BUFFER_GROUP;
+}
+
+unsigned IoUring::bufferSize() const {
+    return bufSize;
+}
+
+char* IoUring::buffer(uint16_t bid) {
+    return bufMemory + (size_t)bid * bufSize;
+}
+
+void IoUring::recycleBuffer(uint16_t bid) {
+    io_uring_buf* entry = &bufRing[bufTail & (numBuffers - 1)];
+    entry->addr = (uint64_t)(uintptr_t)buffer(bid);
+    entry->len = bufSize;
+    entry->bid = bid;
+    bufTail++;
+
+    // the ring tail overlays the reserved field of the first entry
+    __atomic_store_n(&bufRing[0].resv, bufTail, __ATOMIC_RELEASE);
+}
+
+#endif // __linux__
@@ -0,0 +1,75 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#ifdef __linux__
+
+#include <linux/io_uring.h>
+#include <cstdint>
+#include <cstddef>
+
+// thin wrapper over the raw io_uring syscalls (no liburing dependency): the
+// submission/completion rings plus one provided buffer ring for multishot recv
+class IoUring {
+    public:
+        IoUring();
+        ~IoUring();
+
+        // set up the rings and register numBuffers (power of two) provided buffers
+        bool init(unsigned entries, unsigned numBuffers, unsigned bufferSize);
+
+        // next free submission entry, zeroed; nullptr if the queue is full
+        io_uring_sqe* getSqe();
+
+        // submit everything queued and wait for minComplete completions or timeoutMs;
+        // returns the number submitted or -errno (-ETIME on timeout)
+        int submitAndWait(unsigned minComplete, int timeoutMs);
+
+        // oldest unconsumed completion, nullptr if none; seenCqe() releases it
+        io_uring_cqe* peekCqe();
+        void seenCqe();
+
+        // provided buffers picked by IOSQE_BUFFER_SELECT requests
+        uint16_t bufferGroup() const;
+        unsigned bufferSize() const;
+        char* buffer(uint16_t bid);
+        void recycleBuffer(uint16_t bid);
+
+    private:
+        void release();
+
+        int ringFd;
+
+        // submission ring
+        void* sqRing;
+        size_t sqRingSize;
+        unsigned* sqHead;
+        unsigned* sqTail;
+        unsigned* sqMask;
+        unsigned* sqArray;
+        unsigned sqEntries;
+        io_uring_sqe* sqes;
+        size_t sqesSize;
+        unsigned sqeHead;  // first entry not yet handed to the kernel
+        unsigned sqeTail;  // next entry to give out
+
+        // completion ring (shares sqRing with IORING_FEAT_SINGLE_MMAP)
+        void* cqRing;
+        size_t cqRingSize;
+        unsigned* cqHead;
+        unsigned* cqTail;
+        unsigned* cqMask;
+        io_uring_cqe* cqes;
+
+        // provided buffer ring; addressed as plain entries because the header's
+        // io_uring_buf_ring flex-array union has a different layout under C++
+        io_uring_buf* bufRing;
+        size_t bufRingSize;
+        char* bufMemory;
+        unsigned numBuffers;
+        unsigned bufSize;
+        uint16_t bufTail;
+};
+
+#endif // __linux__
+
+#endif // IO_URING_H
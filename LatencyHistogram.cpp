@@ -0,0 +1,143 @@
+#include "LatencyHistogram.h"
+
+#include <cstdio>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+
+static int highestBit(uint64_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, bits);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(bits);
+#endif
+}
+
+LatencyHistogram::LatencyHistogram() : sum(0), max(0) {
+    for (std::atomic<uint32_t>& count : counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::bucketOf(uint64_t micros) {
+    if (micros >= (1ull << (LATENCY_MAX_EXPONENT + 1))) {
+        return LATENCY_BUCKETS - 1;
+    }
+    if (micros < SUB_BUCKETS) {
+        return (int)micros;
+    }
+
+    // the top LATENCY_SUB_BITS bits below the leading one pick the sub-bucket
+    int exponent = highestBit(micros);
+    int shift = exponent - LATENCY_SUB_BITS;
+    return ((shift + 1) << LATENCY_SUB_BITS) + (int)((micros >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::highestIn(int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return (uint64_t)bucket;
+    }
+    int shift = (bucket >> LATENCY_SUB_BITS) - 1;
+    uint64_t low = ((uint64_t)(SUB_BUCKETS + (bucket & (SUB_BUCKETS - 1)))) << shift;
+    return low + (1ull << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    // single writer, so a load and store is enough and skips the locked add
+    std::atomic<uint32_t>& count = counts[bucketOf(micros)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum.store(sum.load(std::memory_order_relaxed) + micros, std::memory_order_relaxed);
+    if (micros > max.load(std::memory_order_relaxed)) {
+        max.store(micros, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::addTo(LatencySnapshot& into) const {
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        uint32_t count = counts[i].load(std::memory_order_relaxed);
+        into.counts[i] += count;
+        into.count += count;
+    }
+    into.sum += sum.load(std::memory_order_relaxed);
+    uint64_t highest = max.load(std::memory_order_relaxed);
+    if (highest > into.max) {
+        into.max = highest;
+    }
+}
+
+LatencySnapshot::LatencySnapshot() : counts(LATENCY_BUCKETS, 0), count(0), sum(0), max(0) {
+}
+
+LatencySnapshot LatencySnapshot::since(const LatencySnapshot& earlier) const {
+    LatencySnapshot interval;
+    int top = -1;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        interval.counts[i] = counts[i] - earlier.counts[i];
+        if (interval.counts[i] != 0) {
+            top = i;
+        }
+    }
+    interval.count = count - earlier.count;
+    interval.sum = sum - earlier.sum;
+
+    // the exact max is only kept overall; within the interval, the top bucket bounds it
+    if (top >= 0) {
+        uint64_t bound = LatencyHistogram::highestIn(top);
+        interval.max = bound < max ? bound : max;
+    }
+    return interval;
+}
+
+uint64_t LatencySnapshot::getCount() const {
+    return count;
+}
+
+uint64_t LatencySnapshot::getSum() const {
+    return sum;
+}
+
+double LatencySnapshot::getMean() const {
+    return count ? (double)sum / count : 0;
+}
+
+uint64_t LatencySnapshot::getMax() const {
+    return max;
+}
+
+uint64_t LatencySnapshot::percentile(double percent) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t wanted = (uint64_t)(percent / 100.0 * count + 0.5);
+    if (wanted < 1) {
+        wanted = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= wanted) {
+            uint64_t bound = LatencyHistogram::highestIn(i);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+std::string formatLatency(uint64_t micros) {
+    char text[32];
+    if (micros < 1000) {
+        snprintf(text, sizeof(text), "%lluus", (unsigned long long)micros);
+    }
+    else if (micros < 1000000) {
+        snprintf(text, sizeof(text), "%.1fms", micros / 1e3);
+    }
+    else {
+        snprintf(text, sizeof(text), "%.2fs", micros / 1e6);
+    }
+    return text;
+}
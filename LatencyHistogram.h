@@ -0,0 +1,69 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// HDR-style buckets over microseconds: values below 2^LATENCY_SUB_BITS get a
+// bucket each, and every power of two above that is split into as many linear
+// sub-buckets, so any value is kept to within about 3%
+#define LATENCY_SUB_BITS 5
+#define LATENCY_MAX_EXPONENT 27  // values from 2^28 us (about 4.5 minutes) up share the top bucket
+#define LATENCY_BUCKETS ((LATENCY_MAX_EXPONENT - LATENCY_SUB_BITS + 2) << LATENCY_SUB_BITS)
+
+class LatencySnapshot;
+
+// latency distribution recorded by one thread and read by any other without a
+// lock: the owner bumps its counters with relaxed stores, readers sum relaxed
+// loads. a reader may see a recording half done (counted but not yet in the
+// sum), which is fine for stats
+class LatencyHistogram {
+    public:
+        LatencyHistogram();
+
+        // only ever from the owning thread
+        void record(uint64_t micros);
+
+        // add the counts so far to into; safe from any thread
+        void addTo(LatencySnapshot& into) const;
+
+        static int bucketOf(uint64_t micros);
+        static uint64_t highestIn(int bucket);  // largest value the bucket holds
+
+    private:
+        std::atomic<uint32_t> counts[LATENCY_BUCKETS];
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> max;
+};
+
+// plain merged counts of one or more histograms, for percentiles
+class LatencySnapshot {
+    public:
+        LatencySnapshot();
+
+        // what was recorded between earlier and this snapshot of the same histograms
+        LatencySnapshot since(const LatencySnapshot& earlier) const;
+
+        uint64_t getCount() const;
+        uint64_t getSum() const;
+        double getMean() const;
+        uint64_t getMax() const;
+
+        // smallest bucket bound that at least percent of the values are at or below
+        uint64_t percentile(double percent) const;
+
+    private:
+        friend class LatencyHistogram;
+
+        std::vector<uint64_t> counts;
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+};
+
+// "850us", "12.3ms" or "1.20s"
+std::string formatLatency(uint64_t micros);
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,415 @@
+#include "LinkExtractor.h"
+
+#include <string>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LINK_EXTRACTOR_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 code is compiled for its own function only, so the build needs no -mavx2
+#if defined(LINK_EXTRACTOR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+// what a page's links are resolved against
+struct LinkBase {
+    std::string_view origin;  // "http://host[:port]"
+    std::string_view path;    // without query or fragment, at least "/"
+    std::string_view dir;     // path up to its last '/'
+    std::string storage;      // holds a <base href> once one was seen
+};
+
+enum class TagKind { None, Anchor, Base, Frame };
+
+static int lowestBit(unsigned int bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static bool isAlpha(char c) {
+    return (unsigned char)((c | 0x20) - 'a') < 26;
+}
+
+static bool equalsNoCase(const char* p, size_t len, const char* lower) {
+    for (size_t i = 0; i < len; i++) {
+        if (lower[i] == '\0' || (p[i] | 0x20) != lower[i]) {
+            return false;
+        }
+    }
+    return lower[len] == '\0';
+}
+
+// tags of interest are a, area, base, frame and iframe: a '<', then a, b, f or i,
+// then whitespace or a, r or f. this lets <b>, <br>, <img>, <i> and most other
+// tags through unparsed. bytes of 0x80 and up count as whitespace, as the signed
+// compare in the vector scans makes them
+static bool isTagStart(const char* p) {
+    char first = p[1] | 0x20;
+    char second = p[2] | 0x20;
+    return (first == 'a' || first == 'b' || first == 'f' || first == 'i') &&
+        ((signed char)p[2] <= ' ' || second == 'a' || second == 'r' || second == 'f');
+}
+
+static const char* findTagScalar(const char* p, const char* end) {
+    while (end - p >= 3) {
+        p = (const char*)memchr(p, '<', end - p - 2);
+        if (!p) {
+            return end;
+        }
+        if (isTagStart(p)) {
+            return p;
+        }
+        p++;
+    }
+    return end;
+}
+
+#ifdef LINK_EXTRACTOR_X86
+// each '<' is checked against the two bytes after it, loaded one and two positions over
+static const char* findTagSSE2(const char* p, const char* end) {
+    const __m128i open = _mm_set1_epi8('<');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i space = _mm_set1_epi8(' ' + 1);
+    const __m128i a = _mm_set1_epi8('a'), b = _mm_set1_epi8('b'), f = _mm_set1_epi8('f'), i = _mm_set1_epi8('i'), r = _mm_set1_epi8('r');
+
+    while (end - p >= 18) {
+        __m128i here = _mm_loadu_si128((const __m128i*)p);
+        __m128i first = _mm_or_si128(_mm_loadu_si128((const __m128i*)(p + 1)), lower);
+        __m128i raw = _mm_loadu_si128((const __m128i*)(p + 2));
+        __m128i second = _mm_or_si128(raw, lower);
+        __m128i firstOk = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(first, a), _mm_cmpeq_epi8(first, b)),
+            _mm_or_si128(_mm_cmpeq_epi8(first, f), _mm_cmpeq_epi8(first, i)));
+        __m128i secondOk = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi8(space, raw), _mm_cmpeq_epi8(second, a)),
+            _mm_or_si128(_mm_cmpeq_epi8(second, r), _mm_cmpeq_epi8(second, f)));
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(here, open), _mm_and_si128(firstOk, secondOk)));
+        if (mask != 0) {
+            return p + lowestBit((unsigned int)mask);
+        }
+        p += 16;
+    }
+    return findTagScalar(p, end);
+}
+
+TARGET_AVX2 static const char* findTagAVX2(const char* p, const char* end) {
+    const __m256i open = _mm256_set1_epi8('<');
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    const __m256i space = _mm256_set1_epi8(' ' + 1);
+    const __m256i a = _mm256_set1_epi8('a'), b = _mm256_set1_epi8('b'), f = _mm256_set1_epi8('f'), i = _mm256_set1_epi8('i'), r = _mm256_set1_epi8('r');
+
+    while (end - p >= 34) {
+        __m256i here = _mm256_loadu_si256((const __m256i*)p);
+        __m256i first = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(p + 1)), lower);
+        __m256i raw = _mm256_loadu_si256((const __m256i*)(p + 2));
+        __m256i second = _mm256_or_si256(raw, lower);
+        __m256i firstOk = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(first, a), _mm256_cmpeq_epi8(first, b)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(first, f), _mm256_cmpeq_epi8(first, i)));
+        __m256i secondOk = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi8(space, raw), _mm256_cmpeq_epi8(second, a)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(second, r), _mm256_cmpeq_epi8(second, f)));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(here, open), _mm256_and_si256(firstOk, secondOk)));
+        if (mask != 0) {
+            return p + lowestBit(mask);
+        }
+        p += 32;
+    }
+    return findTagSSE2(p, end);
+}
+#endif
+
+SimdLevel LinkExtractor::detect() {
+#ifdef LINK_EXTRACTOR_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    if (osAvx && (info[1] & (1 << 5))) {
+        return SimdLevel::AVX2;
+    }
+    return sse2 ? SimdLevel::SSE2 : SimdLevel::Scalar;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    return __builtin_cpu_supports("sse2") ? SimdLevel::SSE2 : SimdLevel::Scalar;
+#endif
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* LinkExtractor::levelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::SSE2: return "sse2";
+    default: return "scalar";
+    }
+}
+
+LinkExtractor::LinkExtractor(SimdLevel level) : level(level) {
+#ifndef LINK_EXTRACTOR_X86
+    this->level = SimdLevel::Scalar;
+#endif
+}
+
+const char* LinkExtractor::findTag(const char* p, const char* end) const {
+#ifdef LINK_EXTRACTOR_X86
+    switch (level) {
+    case SimdLevel::AVX2: return findTagAVX2(p, end);
+    case SimdLevel::SSE2: return findTagSSE2(p, end);
+    default: break;
+    }
+#endif
+    return findTagScalar(p, end);
+}
+
+// split an absolute http URL into what links resolve against; false if it is not one
+static bool setBase(LinkBase& base, std::string_view url) {
+    if (url.size() < 8 || !equalsNoCase(url.data(), 7, "http://")) {
+        return false;
+    }
+    size_t pathStart = url.find('/', 7);
+    if (pathStart == std::string_view::npos) {
+        pathStart = url.size();
+    }
+    base.origin = url.substr(0, pathStart);
+    base.path = url.substr(pathStart, url.find_first_of("?#", pathStart) - pathStart);
+    if (base.path.empty()) {
+        base.path = "/";
+    }
+    base.dir = base.path.substr(0, base.path.rfind('/') + 1);
+    return true;
+}
+
+static void appendDecoded(std::vector<char>& out, std::string_view s) {
+    // &amp; is the one entity that shows up in hrefs all the time
+    size_t amp;
+    while ((amp = s.find("&amp;")) != std::string_view::npos) {
+        out.insert(out.end(), s.data(), s.data() + amp + 1);
+        s.remove_prefix(amp + 5);
+    }
+    out.insert(out.end(), s.data(), s.data() + s.size());
+}
+
+// drop "." and ".." segments from path in place, as RFC 3986 does; returns the new length
+static size_t removeDotSegments(char* path, size_t len) {
+    size_t read = 0, write = 0;
+    while (read < len) {
+        size_t segEnd = read + 1;
+        while (segEnd < len && path[segEnd] != '/') {
+            segEnd++;
+        }
+        size_t segLen = segEnd - read - 1;
+        bool last = segEnd == len;
+
+        if (segLen == 1 && path[read + 1] == '.') {
+            if (last) {
+                path[write++] = '/';
+            }
+        }
+        else if (segLen == 2 && path[read + 1] == '.' && path[read + 2] == '.') {
+            // back to before the last segment written
+            while (write > 0 && path[--write] != '/') {
+            }
+            if (last) {
+                path[write++] = '/';
+            }
+        }
+        else {
+            memmove(path + write, path + read, segEnd - read);
+            write += segEnd - read;
+        }
+        read = segEnd;
+    }
+    if (write == 0) {
+        path[write++] = '/';
+    }
+    return write;
+}
+
+// append link resolved against base to out, null-terminated; false if it is not a crawlable http URL
+static bool resolve(std::string_view link, const LinkBase& base, std::vector<char>& out) {
+    while (!link.empty() && isSpace(link.front())) {
+        link.remove_prefix(1);
+    }
+    while (!link.empty() && isSpace(link.back())) {
+        link.remove_suffix(1);
+    }
+    link = link.substr(0, link.find('#'));
+    if (link.empty()) {
+        return false; // the page itself
+    }
+
+    // a scheme is a letter, then letters, digits, '+', '-' or '.', then ':'
+    size_t colon = 0;
+    while (colon < link.size() && (isAlpha(link[colon]) ||
+        (colon > 0 && ((unsigned char)(link[colon] - '0') < 10 || link[colon] == '+' || link[colon] == '-' || link[colon] == '.')))) {
+        colon++;
+    }
+    bool hasScheme = colon > 0 && colon < link.size() && link[colon] == ':';
+
+    size_t start = out.size();
+    size_t pathStart;
+    if (hasScheme || (link.size() >= 2 && link[0] == '/' && link[1] == '/')) {
+        if (hasScheme) {
+            if (!equalsNoCase(link.data(), colon, "http") || link.compare(colon + 1, 2, "//") != 0) {
+                return false; // https, mailto, javascript, ...
+            }
+            appendDecoded(out, link);
+            memcpy(&out[start], "http", 4);
+        }
+        else {
+            out.insert(out.end(), "http:", "http:" + 5);
+            appendDecoded(out, link);
+        }
+        pathStart = start + 7;
+        while (pathStart < out.size() && out[pathStart] != '/' && out[pathStart] != '?') {
+            pathStart++;
+        }
+    }
+    else {
+        out.insert(out.end(), base.origin.begin(), base.origin.end());
+        pathStart = out.size();
+        if (link[0] == '?') {
+            out.insert(out.end(), base.path.begin(), base.path.end());
+        }
+        else if (link[0] != '/') {
+            out.insert(out.end(), base.dir.begin(), base.dir.end());
+        }
+        appendDecoded(out, link);
+    }
+
+    // an authority with no path gets "/"; otherwise clean up its dot segments
+    if (pathStart == out.size() || out[pathStart] == '?') {
+        out.insert(out.begin() + pathStart, '/');
+    }
+    size_t pathEnd = pathStart;
+    while (pathEnd < out.size() && out[pathEnd] != '?') {
+        pathEnd++;
+    }
+    std::string_view path(&out[pathStart], pathEnd - pathStart);
+    if (path.find("/.") != std::string_view::npos) {
+        size_t len = removeDotSegments(&out[pathStart], pathEnd - pathStart);
+        out.erase(out.begin() + pathStart + len, out.begin() + pathEnd);
+    }
+
+    if (out.size() - start >= LINK_MAX_URL) {
+        out.resize(start);
+        return false;
+    }
+    out.push_back('\0');
+    return true;
+}
+
+// walk a tag's attributes from p for the one named wanted; p ends up past its
+// value, or at the '>' if the tag has no such attribute
+static bool findAttribute(const char*& p, const char* end, const char* wanted, std::string_view& value) {
+    while (p < end && *p != '>') {
+        while (p < end && isSpace(*p)) p++;
+        const char* name = p;
+        while (p < end && !isSpace(*p) && *p != '=' && *p != '>') p++;
+        size_t nameLen = p - name;
+        while (p < end && isSpace(*p)) p++;
+
+        if (p >= end || *p != '=') {
+            if (nameLen == 0 && p < end && *p != '>') {
+                p++;
+            }
+            continue;
+        }
+        p++;
+        while (p < end && isSpace(*p)) p++;
+
+        const char* start = p;
+        if (p < end && (*p == '"' || *p == '\'')) {
+            char quote = *p++;
+            start = p;
+            while (p < end && *p != quote) p++;
+            value = std::string_view(start, p - start);
+            if (p < end) p++;
+        }
+        else {
+            while (p < end && !isSpace(*p) && *p != '>') p++;
+            value = std::string_view(start, p - start);
+        }
+
+        if (equalsNoCase(name, nameLen, wanted)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int LinkExtractor::extract(std::string_view html, std::string_view pageURL, LinkArena& arena) const {
+    LinkBase base;
+    if (!setBase(base, pageURL)) {
+        return 0;
+    }
+
+    int added = 0;
+    const char* p = html.data();
+    const char* end = p + html.size();
+    while ((p = findTag(p, end)) < end) {
+        const char* name = p + 1;
+        const char* q = name;
+        while (q < end && isAlpha(*q)) {
+            q++;
+        }
+        size_t nameLen = q - name;
+        p = q;
+        if (q < end && !isSpace(*q) && *q != '>' && *q != '/') {
+            continue; // <a1>, <b:x> and the like
+        }
+
+        TagKind kind = TagKind::None;
+        if (equalsNoCase(name, nameLen, "a") || equalsNoCase(name, nameLen, "area")) {
+            kind = TagKind::Anchor;
+        }
+        else if (equalsNoCase(name, nameLen, "base")) {
+            kind = TagKind::Base;
+        }
+        else if (equalsNoCase(name, nameLen, "frame") || equalsNoCase(name, nameLen, "iframe")) {
+            kind = TagKind::Frame;
+        }
+        if (kind == TagKind::None) {
+            continue;
+        }
+
+        std::string_view value;
+        if (!findAttribute(p, end, kind == TagKind::Frame ? "src" : "href", value)) {
+            continue;
+        }
+
+        if (kind == TagKind::Base) {
+            // resolve it against what came before, then make it the new base
+            std::vector<char> resolved;
+            if (resolve(value, base, resolved)) {
+                base.storage.assign(resolved.data(), resolved.size() - 1);
+                setBase(base, base.storage);
+            }
+        }
+        else if (resolve(value, base, arena.bytes)) {
+            added++;
+        }
+    }
+
+    arena.count += added;
+    return added;
+}
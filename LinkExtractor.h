@@ -0,0 +1,51 @@
+#ifndef LINK_EXTRACTOR_H
+#define LINK_EXTRACTOR_H
+
+#include <string_view>
+#include <vector>
+
+#define LINK_MAX_URL 2048  // longer resolved links are dropped
+
+// which vector unit scans for tags
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+// caller-owned output of LinkExtractor: count absolute URLs, each null-terminated,
+// back to back in bytes. kept by the worker and reused page after page, so
+// extraction stops allocating once it has seen its largest page
+struct LinkArena {
+    std::vector<char> bytes;
+    int count = 0;
+
+    void clear() {
+        bytes.clear();
+        count = 0;
+    }
+};
+
+// single-pass link extractor over a page body in place, replacing the prebuilt
+// HTMLParserBase. SSE2 or AVX2 compares 16 or 32 bytes at a time against '<'
+// followed by the first two letters a tag of interest may start with; only those
+// candidates are looked at byte by byte. <a> and <area> give their href, <frame> and <iframe>
+// their src, and <base href> changes what later links resolve against. links are
+// resolved against the page URL with dot segments removed, fragments dropped and
+// &amp; decoded; anything but http is skipped
+class LinkExtractor {
+    public:
+        // the widest level this CPU supports
+        static SimdLevel detect();
+        static const char* levelName(SimdLevel level);
+
+        explicit LinkExtractor(SimdLevel level = detect());
+
+        // append the page's links to arena; pageURL is "http://host[:port]/path".
+        // returns how many were added
+        int extract(std::string_view html, std::string_view pageURL, LinkArena& arena) const;
+
+    private:
+        // next '<' that may open a tag of interest, or end
+        const char* findTag(const char* p, const char* end) const;
+
+        SimdLevel level;
+};
+
+#endif // LINK_EXTRACTOR_H
@@ -0,0 +1,64 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+
+// intrusive multi-producer single-consumer queue (Vyukov): push is one atomic
+// exchange and never waits, pop belongs to one consumer thread. Node needs a
+// std::atomic<Node*> next member. a pop can briefly see nothing while a push is
+// between its two steps; the consumer just tries again later
+template <typename Node>
+class MPSCQueue {
+    public:
+        MPSCQueue() : head(&stub), tail(&stub) {
+            stub.next.store(nullptr, std::memory_order_relaxed);
+        }
+
+        MPSCQueue(const MPSCQueue&) = delete;
+        MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+        // any thread
+        void push(Node* node) {
+            node->next.store(nullptr, std::memory_order_relaxed);
+            Node* prev = head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        // consumer only; nullptr if nothing is ready
+        Node* pop() {
+            Node* first = tail;
+            Node* next = first->next.load(std::memory_order_acquire);
+            if (first == &stub) {
+                if (!next) {
+                    return nullptr;
+                }
+                tail = next;
+                first = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next) {
+                tail = next;
+                return first;
+            }
+            if (first != head.load(std::memory_order_acquire)) {
+                return nullptr;  // a producer has swapped head but not linked it yet
+            }
+
+            // first is the last node: park the stub behind it so it can be handed out
+            push(&stub);
+            next = first->next.load(std::memory_order_acquire);
+            if (next) {
+                tail = next;
+                return first;
+            }
+            return nullptr;
+        }
+
+    private:
+        // on lines of their own: producers only touch head, the consumer mostly tail
+        alignas(64) std::atomic<Node*> head;  // last pushed
+        alignas(64) Node* tail;               // next to pop, consumer only
+        Node stub;
+};
+
+#endif // MPSC_QUEUE_H
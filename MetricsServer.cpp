@@ -0,0 +1,222 @@
+#include "MetricsServer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#define METRICS_PREFIX "wincrawl_"
+#define METRICS_POLL_MS 250        // how often the listener checks for stop()
+#define METRICS_REQUEST_MAX 8192   // request headers read before giving up on a client
+#define METRICS_CLIENT_TIMEOUT_MS 2000
+
+// 1 when sock is readable, 0 on timeout, negative on error
+static int waitReadable(SOCKET sock, int timeoutMs) {
+#ifdef _WIN32
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(sock, &readfds);
+
+    timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    return select(0, &readfds, nullptr, nullptr, &timeout);
+#else
+    // the crawler may already hold descriptors past FD_SETSIZE, so no select here
+    pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int ret;
+    do {
+        ret = poll(&pfd, 1, timeoutMs);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+#endif
+}
+
+static void appendNumber(std::string& out, double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.15g", value);
+    out += text;
+}
+
+// label values are escaped the same way for both formats: backslash, quote and newline
+static void appendEscaped(std::string& out, const std::string& value) {
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        }
+        else if (c == '\n') {
+            out += "\\n";
+        }
+        else if ((unsigned char)c >= ' ') {
+            out += c;
+        }
+    }
+}
+
+std::string formatPrometheus(const std::vector<Metric>& metrics) {
+    std::string out;
+    out.reserve(metrics.size() * 96);
+    for (const Metric& metric : metrics) {
+        if (metric.help) {
+            out += "# HELP " METRICS_PREFIX + metric.name + " " + metric.help + "\n";
+            out += "# TYPE " METRICS_PREFIX + metric.name + " " + metric.type + "\n";
+        }
+        out += METRICS_PREFIX + metric.name;
+        if (!metric.labels.empty()) {
+            out += '{';
+            for (size_t i = 0; i < metric.labels.size(); i++) {
+                if (i > 0) {
+                    out += ',';
+                }
+                out += metric.labels[i].first + "=\"";
+                appendEscaped(out, metric.labels[i].second);
+                out += '"';
+            }
+            out += '}';
+        }
+        out += ' ';
+        appendNumber(out, metric.value);
+        out += '\n';
+    }
+    return out;
+}
+
+std::string formatJSONLine(const std::vector<Metric>& metrics, double elapsed) {
+    std::string out = "{\"elapsed\":";
+    appendNumber(out, elapsed);
+    for (const Metric& metric : metrics) {
+        out += ",\"";
+        appendEscaped(out, metric.name);
+        for (const std::pair<std::string, std::string>& label : metric.labels) {
+            out += '_';
+            appendEscaped(out, label.second);
+        }
+        out += "\":";
+        appendNumber(out, metric.value);
+    }
+    out += "}\n";
+    return out;
+}
+
+MetricsServer::MetricsServer(Collector collect) : collect(std::move(collect)), listener(INVALID_SOCKET), stopping(false) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(const std::string& address, int port) {
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1) {
+        return false;
+    }
+
+    listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET) {
+        return false;
+    }
+    // a restarted crawler can take the port back while old connections sit in TIME_WAIT
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    if (bind(listener, (sockaddr*)&local, sizeof(local)) == SOCKET_ERROR || listen(listener, 16) == SOCKET_ERROR) {
+        closesocket(listener);
+        listener = INVALID_SOCKET;
+        return false;
+    }
+
+    stopping = false;
+    thread = std::thread(&MetricsServer::Run, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    stopping = true;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (listener != INVALID_SOCKET) {
+        closesocket(listener);
+        listener = INVALID_SOCKET;
+    }
+}
+
+void MetricsServer::Run() {
+    while (!stopping) {
+        if (waitReadable(listener, METRICS_POLL_MS) <= 0) {
+            continue;
+        }
+        SOCKET client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        serve(client);
+        closesocket(client);
+    }
+}
+
+void MetricsServer::serve(SOCKET client) {
+    // read the request headers; the body, if any, is ignored
+    std::string request;
+    char chunk[1024];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(METRICS_CLIENT_TIMEOUT_MS);
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < METRICS_REQUEST_MAX) {
+        int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0 || waitReadable(client, left) <= 0) {
+            return;
+        }
+        int got = recv(client, chunk, sizeof(chunk), 0);
+        if (got <= 0) {
+            return;
+        }
+        request.append(chunk, got);
+    }
+
+    // "GET /metrics HTTP/1.1"; "/" is served too, and a query string is ignored
+    bool head = request.compare(0, 5, "HEAD ") == 0;
+    size_t pathStart = head ? 5 : 4;
+    size_t pathEnd = request.find_first_of(" ?\r", pathStart);
+    std::string path = pathEnd == std::string::npos ? std::string() : request.substr(pathStart, pathEnd - pathStart);
+
+    std::string status, type, body;
+    if (!head && request.compare(0, 4, "GET ") != 0) {
+        status = "405 Method Not Allowed";
+        type = "text/plain";
+        body = "only GET and HEAD\n";
+    }
+    else if (path == "/metrics" || path == "/") {
+        std::vector<Metric> metrics;
+        collect(metrics);
+        status = "200 OK";
+        type = "text/plain; version=0.0.4; charset=utf-8";
+        body = formatPrometheus(metrics);
+    }
+    else {
+        status = "404 Not Found";
+        type = "text/plain";
+        body = "try /metrics\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + type + "\r\nContent-Length: " + std::to_string(body.size()) +
+        "\r\nConnection: close\r\n\r\n";
+    if (!head) {
+        response += body;
+    }
+    for (size_t sent = 0; sent < response.size(); ) {
+        int n = send(client, response.data() + sent, (int)(response.size() - sent), MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        sent += n;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include "Socket.h"
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// one sample of a metric family
+struct Metric {
+    std::string name;  // without the "wincrawl_" prefix
+    const char* help;  // on the first sample of a family only; later samples share its header
+    const char* type;  // "counter", "gauge" or "summary"
+    std::vector<std::pair<std::string, std::string>> labels;
+    double value;
+};
+
+// Prometheus text exposition format 0.0.4
+std::string formatPrometheus(const std::vector<Metric>& metrics);
+
+// one JSON object and a newline; labelled samples get their label values
+// appended to the key, e.g. "http_responses_total_2xx"
+std::string formatJSONLine(const std::vector<Metric>& metrics, double elapsed);
+
+// serves /metrics over HTTP from its own thread. each scrape calls collect,
+// which must only read counters that need no lock, so scraping never waits on
+// or holds up a worker. one request per connection, one connection at a time
+class MetricsServer {
+    public:
+        typedef std::function<void(std::vector<Metric>&)> Collector;
+
+        explicit MetricsServer(Collector collect);
+        ~MetricsServer();
+
+        // listen on address:port and start serving; false if the socket cannot be bound
+        bool start(const std::string& address, int port);
+        void stop();
+
+    private:
+        void Run();
+        void serve(SOCKET client);
+
+        Collector collect;
+        SOCKET listener;
+        std::thread thread;
+        std::atomic<bool> stopping;
+};
+
+#endif // METRICS_SERVER_H
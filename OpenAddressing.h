@@ -0,0 +1,89 @@
+#ifndef OPEN_ADDRESSING_H
+#define OPEN_ADDRESSING_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// 64-bit finalizer from MurmurHash3; spreads nearby keys over every bit
+inline uint64_t mixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// linear probing over a power-of-two table in which a zero (value-initialized)
+// Key marks an empty slot, so callers track the zero key on the side. the low
+// bits of hash(key) pick its home slot. callers hold their own lock and decide
+// when to grow, which keeps the load factor theirs
+
+// true if key was not present before
+template <typename Key, typename Hash>
+bool probeInsert(std::vector<Key>& slots, const Key& key, Hash hash) {
+    static const Key empty = {};
+    size_t mask = slots.size() - 1;
+    size_t slot = hash(key) & mask;
+    while (true) {
+        Key& current = slots[slot];
+        if (current == empty) {
+            current = key;
+            return true;
+        }
+        if (current == key) {
+            return false;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+// double the table, or start it at initialSlots, and reinsert every key
+template <typename Key, typename Hash>
+void growTable(std::vector<Key>& slots, size_t initialSlots, Hash hash) {
+    static const Key empty = {};
+    std::vector<Key> old;
+    old.swap(slots);
+    slots.assign(old.empty() ? initialSlots : old.size() * 2, empty);
+    for (const Key& existing : old) {
+        if (!(existing == empty)) {
+            probeInsert(slots, existing, hash);
+        }
+    }
+}
+
+// true if key was present; later keys of its run shift back into the hole, so
+// no tombstones are needed
+template <typename Key, typename Hash>
+bool probeErase(std::vector<Key>& slots, const Key& key, Hash hash) {
+    static const Key empty = {};
+    if (slots.empty()) {
+        return false;
+    }
+
+    size_t mask = slots.size() - 1;
+    size_t slot = hash(key) & mask;
+    while (!(slots[slot] == key)) {
+        if (slots[slot] == empty) {
+            return false;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask;
+    while (!(slots[next] == empty)) {
+        size_t home = hash(slots[next]) & mask;
+        // a key may fill the hole unless its home lies cyclically in (hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    slots[hole] = empty;
+    return true;
+}
+
+#endif // OPEN_ADDRESSING_H
@@ -0,0 +1,328 @@
+#include "Options.h"
+#include "DNSResolver.h"
+#include "DomainMatcher.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void printUsage(const char* program) {
+    printf("Usage: %s <numThreads> <inputFilePath> [options]\n", program);
+    printf("  --frontier=N             seed URLs read ahead of the workers (default 100000)\n");
+    printf("  --max-depth=N            follow extracted links up to N hops from a seed (default 0: seeds only)\n");
+    printf("  --max-frontier=N         links queued before new ones are dropped (default 1000000, unlimited with --spill-dir)\n");
+    printf("  --spill-dir=DIR          spill frontier links past --frontier-ram to compressed segment files in DIR\n");
+    printf("  --frontier-ram=MB        frontier memory budget when spilling (default 512)\n");
+    printf("  --priority=MODE          depth (default), hosts or score: which queued links are crawled first\n");
+    printf("  --engine=threads|epoll   one blocking socket per thread, or an epoll loop per thread\n");
+    printf("  --connections=N          in-flight connections per epoll worker (default 1000)\n");
+    printf("  --io=blocking|uring      socket backend for the threads engine (uring is no faster than blocking; use --engine=epoll for throughput)\n");
+    printf("  --http=MODE              close (default) or keep-alive: robots and page on one connection\n");
+    printf("  --politeness=MS          crawl every host, at least MS apart per IP (default 0: first host per IP only)\n");
+    printf("  --dns=IP[:PORT]|system   resolver to query (default: first nameserver in /etc/resolv.conf)\n");
+    printf("  --dns-timeout=MS         per-attempt DNS timeout (default 2000)\n");
+    printf("  --dns-retries=N          DNS resends before giving up (default 2)\n");
+    printf("  --dns-negative-ttl=S     seconds to cache failed lookups, 0 to disable (default 60)\n");
+    printf("  --ip-set=compact|bitmap  IP dedupe table, bitmap reserves 512 MB for internet-scale runs\n");
+    printf("  --classify=NAME:SUFFIXES count links into comma-separated domains and their subdomains; repeatable\n");
+    printf("  --metrics=[IP:]PORT      serve Prometheus metrics at /metrics (default IP 127.0.0.1)\n");
+    printf("  --stats-json=FILE        append the same counters to FILE as one JSON line per stats interval\n");
+    printf("  --warc=PREFIX            archive every request and response to PREFIX-<time>-<n>.warc.gz\n");
+    printf("  --warc-size=MB           start a new WARC file past MB (default 1024)\n");
+    printf("  --warc-queue=MB          responses waiting for the WARC writer before new ones are left out (default 256)\n");
+}
+
+// parse "name:suffix,suffix,..."; false if it is malformed
+static bool parseDomainRuleSet(const char* value, DomainRuleSet& out) {
+    const char* colon = strchr(value, ':');
+    if (!colon || colon == value) {
+        return false;
+    }
+    out.name.assign(value, colon - value);
+    out.suffixes.clear();
+
+    for (const char* p = colon + 1; ; ) {
+        const char* comma = strchr(p, ',');
+        std::string suffix = comma ? std::string(p, comma - p) : std::string(p);
+        if (!DomainMatcher::validSuffix(suffix)) {
+            return false;
+        }
+        out.suffixes.push_back(suffix);
+        if (!comma) {
+            return true;
+        }
+        p = comma + 1;
+    }
+}
+
+// parse "[ip:]port" into address and port; false if it is malformed
+static bool parseListenAddress(const char* value, std::string& address, int& port) {
+    const char* colon = strrchr(value, ':');
+    std::string ip = colon ? std::string(value, colon - value) : std::string("127.0.0.1");
+    const char* portText = colon ? colon + 1 : value;
+
+    char* end = nullptr;
+    long parsed = strtol(portText, &end, 10);
+    in_addr addr;
+    if (end == portText || *end != '\0' || parsed < 1 || parsed > 65535 || inet_pton(AF_INET, ip.c_str(), &addr) != 1) {
+        return false;
+    }
+    address = ip;
+    port = static_cast<int>(parsed);
+    return true;
+}
+
+// parse a positive integer option value; false if it is malformed
+static bool parsePositive(const char* value, int& out) {
+    char* end = nullptr;
+    long parsed = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || parsed < 1 || parsed > 1000000000) {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+// as parsePositive, for counts that may exceed an int
+static bool parsePositiveLong(const char* value, long& out) {
+    char* end = nullptr;
+    long long parsed = strtoll(value, &end, 10);
+    if (end == value || *end != '\0' || parsed < 1 || parsed > 1000000000000LL) {
+        return false;
+    }
+    out = static_cast<long>(parsed);
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], CrawlerOptions& options) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return false;
+    }
+
+    options.numThreads = atoi(argv[1]);
+    if (options.numThreads < 1) {
+        printf("Invalid number of threads\n");
+        return false;
+    }
+    options.inputFile = argv[2];
+
+    for (int i = 3; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* eq = strchr(arg, '=');
+        std::string name = eq ? std::string(arg, eq - arg) : std::string(arg);
+        const char* value = eq ? eq + 1 : "";
+
+        if (name == "--frontier") {
+            if (!parsePositive(value, options.frontierSize)) {
+                printf("Invalid frontier size: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--max-depth") {
+            if (strcmp(value, "0") == 0) {
+                options.maxDepth = 0;
+            }
+            else if (!parsePositive(value, options.maxDepth)) {
+                printf("Invalid maximum depth: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--max-frontier") {
+            if (!parsePositiveLong(value, options.maxFrontier)) {
+                printf("Invalid frontier limit: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--spill-dir") {
+            if (*value == '\0') {
+                printf("Missing spill directory\n");
+                return false;
+            }
+            options.spillDir = value;
+        }
+        else if (name == "--frontier-ram") {
+            if (!parsePositive(value, options.frontierRamMb)) {
+                printf("Invalid frontier memory budget: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--priority") {
+            if (strcmp(value, "depth") == 0) {
+                options.order = FrontierOrder::Depth;
+            }
+            else if (strcmp(value, "hosts") == 0) {
+                options.order = FrontierOrder::Hosts;
+            }
+            else if (strcmp(value, "score") == 0) {
+                options.order = FrontierOrder::Score;
+            }
+            else {
+                printf("Unknown priority: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--engine") {
+            if (strcmp(value, "threads") == 0) {
+                options.engine = EngineMode::Threads;
+            }
+            else if (strcmp(value, "epoll") == 0) {
+#ifdef __linux__
+                options.engine = EngineMode::Epoll;
+#else
+                printf("The epoll engine is only available on Linux\n");
+                return false;
+#endif
+            }
+            else {
+                printf("Unknown engine: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--connections") {
+            if (!parsePositive(value, options.maxConnections)) {
+                printf("Invalid number of connections: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--io") {
+            if (strcmp(value, "blocking") == 0) {
+                options.io = IOBackend::Blocking;
+            }
+            else if (strcmp(value, "uring") == 0) {
+#ifdef __linux__
+                options.io = IOBackend::Uring;
+#else
+                printf("The io_uring backend is only available on Linux\n");
+                return false;
+#endif
+            }
+            else {
+                printf("Unknown io backend: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--http") {
+            if (strcmp(value, "close") == 0) {
+                options.http = HTTPMode::Close;
+            }
+            else if (strcmp(value, "keep-alive") == 0) {
+                options.http = HTTPMode::KeepAlive;
+            }
+            else {
+                printf("Unknown HTTP mode: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--politeness") {
+            if (strcmp(value, "0") == 0) {
+                options.politenessMs = 0;
+            }
+            else if (!parsePositive(value, options.politenessMs)) {
+                printf("Invalid politeness delay: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--dns") {
+            sockaddr_in server;
+            if (strcmp(value, "system") != 0 && !DNSResolver::parseServer(value, server)) {
+                printf("Invalid DNS server: %s\n", value);
+                return false;
+            }
+            options.dnsServer = value;
+        }
+        else if (name == "--dns-timeout") {
+            if (!parsePositive(value, options.dnsTimeoutMs)) {
+                printf("Invalid DNS timeout: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--dns-retries") {
+            // zero is allowed here: a single attempt per query
+            if (strcmp(value, "0") == 0) {
+                options.dnsRetries = 0;
+            }
+            else if (!parsePositive(value, options.dnsRetries)) {
+                printf("Invalid number of DNS retries: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--dns-negative-ttl") {
+            if (strcmp(value, "0") == 0) {
+                options.dnsNegativeTtl = 0;
+            }
+            else if (!parsePositive(value, options.dnsNegativeTtl)) {
+                printf("Invalid DNS negative TTL: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--ip-set") {
+            if (strcmp(value, "compact") == 0) {
+                options.ipSet = IPSetMode::Compact;
+            }
+            else if (strcmp(value, "bitmap") == 0) {
+                options.ipSet = IPSetMode::Bitmap;
+            }
+            else {
+                printf("Unknown IP set: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--classify") {
+            DomainRuleSet set;
+            if (!parseDomainRuleSet(value, set)) {
+                printf("Invalid domain rule set: %s\n", value);
+                return false;
+            }
+            if (options.domainSets.size() >= DOMAIN_MAX_SETS) {
+                printf("At most %d domain rule sets\n", DOMAIN_MAX_SETS);
+                return false;
+            }
+            options.domainSets.push_back(set);
+        }
+        else if (name == "--metrics") {
+            if (!parseListenAddress(value, options.metricsAddress, options.metricsPort)) {
+                printf("Invalid metrics address: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--stats-json") {
+            if (*value == '\0') {
+                printf("Missing stats file\n");
+                return false;
+            }
+            options.statsJson = value;
+        }
+        else if (name == "--warc") {
+            if (*value == '\0') {
+                printf("Missing WARC prefix\n");
+                return false;
+            }
+            options.warcPrefix = value;
+        }
+        else if (name == "--warc-size") {
+            if (!parsePositive(value, options.warcSizeMb)) {
+                printf("Invalid WARC file size: %s\n", value);
+                return false;
+            }
+        }
+        else if (name == "--warc-queue") {
+            if (!parsePositive(value, options.warcQueueMb)) {
+                printf("Invalid WARC queue size: %s\n", value);
+                return false;
+            }
+        }
+        else {
+            printf("Unknown option: %s\n", arg);
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+
+    if (options.io == IOBackend::Uring && options.engine != EngineMode::Threads) {
+        printf("--io=uring only applies to the threads engine\n");
+        return false;
+    }
+
+    return true;
+}
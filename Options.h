@@ -0,0 +1,88 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <vector>
+
+// how crawl workers drive their connections
+enum class EngineMode {
+    Threads,  // one blocking socket per thread
+    Epoll     // each thread multiplexes many non-blocking sockets (Linux only)
+};
+
+// how the threaded engine's sockets talk to the kernel
+enum class IOBackend {
+    Blocking,  // poll + recv per segment
+    Uring      // linked connect/send and multishot recv through io_uring (Linux only)
+};
+
+// how robots and page requests share a connection
+enum class HTTPMode {
+    Close,      // HTTP/1.0, one connection per request
+    KeepAlive   // HTTP/1.1, the page request reuses the robots connection
+};
+
+// which extracted links a recursive crawl visits first
+enum class FrontierOrder {
+    Depth,  // breadth first
+    Hosts,  // sites with fewer links queued so far
+    Score   // short, shallow URLs without a query string
+};
+
+// how resolved addresses are deduped
+enum class IPSetMode {
+    Compact,  // open-addressing shards sized to the addresses seen
+    Bitmap    // one bit per IPv4 address, 512 MB reserved up front
+};
+
+// a named list of domain suffixes extracted links are classified against
+struct DomainRuleSet {
+    std::string name;
+    std::vector<std::string> suffixes;
+};
+
+struct CrawlerOptions {
+    int numThreads = 0;
+    std::string inputFile;
+    int frontierSize = 100000;  // seed URLs queued ahead of the workers
+
+    // recursive crawling: links are followed up to maxDepth hops from a seed, 0 crawls the seeds only
+    int maxDepth = 0;
+    long maxFrontier = 0;  // links queued beyond this are dropped; 0: 1000000, or no limit when spilling
+    FrontierOrder order = FrontierOrder::Depth;
+    std::string spillDir;  // "" keeps the whole frontier in memory
+    int frontierRamMb = 512;  // frontier memory before links spill to spillDir
+
+    EngineMode engine = EngineMode::Threads;
+    int maxConnections = 1000;  // in-flight connections per epoll worker
+    IOBackend io = IOBackend::Blocking;
+    HTTPMode http = HTTPMode::Close;
+    int politenessMs = 0;  // gap between hosts on one IP, 0 crawls only the first host per IP
+
+    // "" reads /etc/resolv.conf, "system" keeps getaddrinfo, otherwise "ip[:port]"
+    std::string dnsServer;
+    int dnsTimeoutMs = 2000;  // per attempt
+    int dnsRetries = 2;       // resends after the first attempt times out
+    int dnsNegativeTtl = 60;  // seconds failed lookups stay cached, 0 disables
+
+    IPSetMode ipSet = IPSetMode::Compact;
+
+    std::vector<DomainRuleSet> domainSets;  // links into each are counted per set
+
+    // observability: Prometheus text on metricsAddress:metricsPort (0 is off), and
+    // one JSON line of the same counters per stats interval appended to statsJson
+    std::string metricsAddress = "127.0.0.1";
+    int metricsPort = 0;
+    std::string statsJson;
+
+    // archive every fetch to warcPrefix-*.warc.gz ("" is off), a new file past
+    // warcSizeMb; a response is left out rather than queued past warcQueueMb
+    std::string warcPrefix;
+    int warcSizeMb = 1024;
+    int warcQueueMb = 256;
+};
+
+// parse "<numThreads> <inputFilePath> [--name=value ...]"; prints usage and returns false on error
+bool parseOptions(int argc, char* argv[], CrawlerOptions& options);
+
+#endif // OPTIONS_H
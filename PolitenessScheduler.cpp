@@ -0,0 +1,120 @@
+#include "PolitenessScheduler.h"
+
+#include <algorithm>
+
+PolitenessScheduler::PolitenessScheduler(int delayMs, long capacity)
+    : delayMs(delayMs), capacity(capacity), epoch(std::chrono::steady_clock::now()), wheel(0), held(0), ipCount(0) {
+}
+
+uint64_t PolitenessScheduler::nowMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void PolitenessScheduler::submit(CrawlJob job) {
+    uint32_t ip = job.addr.s_addr;
+    std::lock_guard<std::mutex> guard(lock);
+    held++;
+
+    // an IP with an entry is busy or cooling down, so the job waits its turn
+    auto it = ips.find(ip);
+    if (it != ips.end()) {
+        it->second.queue.push_back(std::move(job));
+        return;
+    }
+
+    IPEntry& entry = ips[ip];
+    entry.ip = ip;
+    entry.timer.data = &entry;
+    ipCount++;
+    ready.push_back(std::move(job));
+    readyCond.notify_one();
+}
+
+bool PolitenessScheduler::tryNext(CrawlJob& job) {
+    std::lock_guard<std::mutex> guard(lock);
+    expireLocked();
+    if (ready.empty()) {
+        return false;
+    }
+
+    job = std::move(ready.front());
+    ready.pop_front();
+    held--;
+    return true;
+}
+
+void PolitenessScheduler::done(in_addr addr, int crawlDelayMs) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = ips.find(addr.s_addr);
+    if (it == ips.end()) {
+        return;
+    }
+    // part of the current millisecond is already gone, so round up
+    wheel.schedule(&it->second.timer, nowMs() + std::max(delayMs, crawlDelayMs) + 1);
+
+    // a waiter may have gone to sleep with no cooldown running at all
+    readyCond.notify_one();
+}
+
+void PolitenessScheduler::expireLocked() {
+    expired.clear();
+    wheel.advance(nowMs(), expired);
+
+    // an IP whose cooldown ended passes its next job on, or is forgotten if it has none
+    for (TimerNode* node : expired) {
+        IPEntry* entry = static_cast<IPEntry*>(node->data);
+        if (entry->head == entry->queue.size()) {
+            ips.erase(entry->ip);
+            ipCount--;
+            continue;
+        }
+
+        ready.push_back(std::move(entry->queue[entry->head++]));
+        if (entry->head == entry->queue.size()) {
+            entry->queue.clear();
+            entry->head = 0;
+        }
+    }
+
+    // the caller takes one, the rest go to whoever is waiting
+    if (ready.size() > 1) {
+        readyCond.notify_all();
+    }
+}
+
+void PolitenessScheduler::wait(int maxMs) {
+    std::unique_lock<std::mutex> guard(lock);
+    expireLocked();
+    if (!ready.empty()) {
+        return;
+    }
+
+    uint64_t due = wheel.nextExpiry();
+    uint64_t now = nowMs();
+    if (due != UINT64_MAX && due > now && due - now < (uint64_t)maxMs) {
+        maxMs = (int)(due - now);
+    }
+    readyCond.wait_for(guard, std::chrono::milliseconds(maxMs));
+}
+
+int PolitenessScheduler::nextDueMs() {
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t due = wheel.nextExpiry();
+    if (due == UINT64_MAX) {
+        return -1;
+    }
+    uint64_t now = nowMs();
+    return due > now ? (int)std::min<uint64_t>(due - now, INT32_MAX) : 0;
+}
+
+long PolitenessScheduler::pending() const {
+    return held.load();
+}
+
+bool PolitenessScheduler::hasRoom() const {
+    return held.load() < capacity;
+}
+
+long PolitenessScheduler::activeIPs() const {
+    return ipCount.load();
+}
@@ -0,0 +1,87 @@
+#ifndef POLITENESS_SCHEDULER_H
+#define POLITENESS_SCHEDULER_H
+
+#include "Socket.h"
+#include "TimerWheel.h"
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// a resolved host waiting for its turn on its IP
+struct CrawlJob {
+    std::string host;
+    std::string request;
+    int port = 80;
+    int depth = 0;  // hops from the seed file, for recursive crawls
+    in_addr addr = {};
+};
+
+// per-IP politeness: at most one host per IP is crawled at a time, and the next
+// one on that IP starts no sooner than delayMs (or the site's Crawl-delay) after
+// the previous one finished. jobs for an IP that is busy or cooling down queue
+// behind it, and the cooldowns run on a timer wheel, so workers only ever see
+// hosts that may be crawled right now and never wait on any single IP
+class PolitenessScheduler {
+    public:
+        // capacity bounds the jobs held across all IPs
+        PolitenessScheduler(int delayMs, long capacity);
+
+        // hand over a resolved host; it is ready at once if its IP is idle
+        void submit(CrawlJob job);
+
+        // next host whose IP may be contacted now; false if none is
+        bool tryNext(CrawlJob& job);
+
+        // the crawl of a host from tryNext() ended; its IP cools down for the
+        // politeness delay or crawlDelayMs, whichever is longer
+        void done(in_addr addr, int crawlDelayMs);
+
+        // sleep until a host may be ready, at most maxMs
+        void wait(int maxMs);
+
+        // milliseconds until the next cooldown may end, -1 if none is running
+        int nextDueMs();
+
+        // jobs held, ready or queued behind a busy IP
+        long pending() const;
+        bool hasRoom() const;
+
+        // IPs that are busy, cooling down or have jobs queued
+        long activeIPs() const;
+
+    private:
+        struct IPEntry {
+            TimerNode timer;
+            uint32_t ip = 0;
+            std::vector<CrawlJob> queue;
+            size_t head = 0;  // queue[head..] are still waiting
+        };
+
+        uint64_t nowMs() const;
+
+        // fire cooldowns that have run out; called with lock held
+        void expireLocked();
+
+        int delayMs;
+        long capacity;
+        std::chrono::steady_clock::time_point epoch;
+
+        mutable std::mutex lock;
+        std::condition_variable readyCond;
+        TimerWheel wheel;
+        std::unordered_map<uint32_t, IPEntry> ips;
+        std::deque<CrawlJob> ready;
+        std::vector<TimerNode*> expired;
+
+        std::atomic<long> held;
+        std::atomic<long> ipCount;
+};
+
+#endif // POLITENESS_SCHEDULER_H
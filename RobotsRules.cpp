@@ -0,0 +1,435 @@
+#include "RobotsRules.h"
+#include "Socket.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static_assert(ROBOTS_MAX_STATES < ROBOTS_UNBUILT, "state ids must fit a uint16_t transition");
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+static bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x += 'a' - 'A';
+        if (y >= 'A' && y <= 'Z') y += 'a' - 'A';
+        if (x != y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+RobotsRules::RobotsRules() : crawlDelayMs(0), numClasses(1) {
+    memset(classOf, 0, sizeof(classOf));
+}
+
+std::shared_ptr<const RobotsRules> RobotsRules::allowAll() {
+    static std::shared_ptr<const RobotsRules> rules(new RobotsRules);
+    return rules;
+}
+
+std::shared_ptr<const RobotsRules> RobotsRules::disallowAll() {
+    static std::shared_ptr<const RobotsRules> rules([] {
+        RobotsRules* all = new RobotsRules;
+        all->addRule("/", false);
+        all->compile();
+        return all;
+    }());
+    return rules;
+}
+
+std::shared_ptr<const RobotsRules> RobotsRules::fromResponse(const HTTPResponse& response, std::string_view userAgent) {
+    if (response.statusCode >= 200 && response.statusCode < 300) {
+        return parse(response.body, userAgent);
+    }
+    if (response.statusCode >= 300 && response.statusCode < 500) {
+        return allowAll();
+    }
+    // a server error may hide rules, so nothing is crawled
+    return disallowAll();
+}
+
+std::shared_ptr<const RobotsRules> RobotsRules::parse(std::string_view body, std::string_view userAgent) {
+    std::unique_ptr<RobotsRules> ours(new RobotsRules), anyone(new RobotsRules);
+    bool named = false;      // some group names our user-agent, so '*' does not apply
+    bool inAgents = false;   // the last record was a user-agent line
+    bool forUs = false, forAnyone = false;
+
+    if (body.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        body.remove_prefix(3);
+    }
+
+    while (!body.empty()) {
+        size_t end = body.find('\n');
+        std::string_view line = body.substr(0, end);
+        body.remove_prefix(end == std::string_view::npos ? body.size() : end + 1);
+
+        line = line.substr(0, line.find('#'));
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string_view key = trim(line.substr(0, colon));
+        std::string_view value = trim(line.substr(colon + 1));
+
+        if (equalsIgnoreCase(key, "user-agent")) {
+            // consecutive user-agent lines share the rules that follow them
+            if (!inAgents) {
+                forUs = forAnyone = false;
+                inAgents = true;
+            }
+            std::string_view token = value.substr(0, value.find_first_of(" /"));
+            if (equalsIgnoreCase(token, userAgent)) {
+                forUs = named = true;
+            }
+            else if (token == "*") {
+                forAnyone = true;
+            }
+            continue;
+        }
+
+        bool allow = equalsIgnoreCase(key, "allow");
+        bool disallow = equalsIgnoreCase(key, "disallow");
+        bool delay = equalsIgnoreCase(key, "crawl-delay");
+        if (!allow && !disallow && !delay) {
+            continue; // sitemap and the like belong to no group
+        }
+        inAgents = false;
+        if (!forUs && !forAnyone) {
+            continue;
+        }
+
+        RobotsRules& target = forUs ? *ours : *anyone;
+        if (delay) {
+            double seconds = strtod(std::string(value).c_str(), nullptr);
+            if (seconds > 0) {
+                target.crawlDelayMs = (int)std::min(seconds * 1000, (double)ROBOTS_MAX_DELAY_MS);
+            }
+        }
+        else {
+            target.addRule(value, allow);
+        }
+    }
+
+    std::unique_ptr<RobotsRules>& rules = named ? ours : anyone;
+    if (rules->rules.empty() && rules->crawlDelayMs == 0) {
+        return allowAll();
+    }
+    rules->compile();
+    return std::shared_ptr<const RobotsRules>(rules.release());
+}
+
+void RobotsRules::addRule(std::string_view value, bool allow) {
+    // an empty Disallow allows everything, and anything else must be a path
+    if (value.empty() || (value[0] != '/' && value[0] != '*')) {
+        return;
+    }
+    Rule rule;
+    rule.score = (int)value.size() * 2 + (allow ? 1 : 0);
+    rule.anchored = value.back() == '$';
+    rule.pattern = std::string(rule.anchored ? value.substr(0, value.size() - 1) : value);
+    rules.push_back(std::move(rule));
+}
+
+void RobotsRules::closure(std::vector<int>& positions) const {
+    // a '*' may match nothing, so whatever follows it is live too
+    for (size_t i = 0; i < positions.size(); i++) {
+        int p = positions[i];
+        const Rule& rule = rules[ruleOf[p]];
+        size_t j = p - base[ruleOf[p]];
+        if (j < rule.pattern.size() && rule.pattern[j] == '*') {
+            positions.push_back(p + 1);
+        }
+    }
+    std::sort(positions.begin(), positions.end());
+    positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+}
+
+void RobotsRules::scores(const std::vector<int>& positions, int32_t& prefix, int32_t& end) const {
+    prefix = end = -1;
+    for (int p : positions) {
+        const Rule& rule = rules[ruleOf[p]];
+        if ((size_t)(p - base[ruleOf[p]]) == rule.pattern.size()) {
+            int32_t& best = rule.anchored ? end : prefix;
+            best = std::max(best, (int32_t)rule.score);
+        }
+    }
+}
+
+void RobotsRules::compile() {
+    base.clear();
+    ruleOf.clear();
+    for (size_t i = 0; i < rules.size(); i++) {
+        base.push_back((int)ruleOf.size());
+        ruleOf.insert(ruleOf.end(), rules[i].pattern.size() + 1, (int)i);
+    }
+
+    // every byte some pattern spells out gets a class of its own; the rest behave alike
+    bool seen[256] = {};
+    numClasses = 1;
+    for (const Rule& rule : rules) {
+        for (char ch : rule.pattern) {
+            uint8_t c = (uint8_t)ch;
+            if (ch != '*' && !seen[c]) {
+                seen[c] = true;
+                classOf[c] = (uint8_t)numClasses++;
+            }
+        }
+    }
+
+    // only the start state up front; the rest are built as paths reach them
+    std::vector<int> start;
+    for (int b : base) {
+        start.push_back(b);
+    }
+    closure(start);
+    dfa.reset(new DFA);
+    if (stateFor(start) < 0) {
+        dfa.reset();
+    }
+}
+
+int RobotsRules::stateFor(std::vector<int>& positions) const {
+    auto it = dfa->ids.find(positions);
+    if (it != dfa->ids.end()) {
+        return it->second;
+    }
+
+    // checked before adding, so a state id always fits a transition below ROBOTS_UNBUILT
+    if (dfa->sets.size() >= ROBOTS_MAX_STATES || dfa->next.size() + numClasses > ROBOTS_MAX_TABLE ||
+        dfa->positions + positions.size() > ROBOTS_MAX_POSITIONS) {
+        return -1;
+    }
+
+    int id = (int)dfa->sets.size();
+    int32_t prefix, end;
+    scores(positions, prefix, end);
+    dfa->prefixBest.push_back(prefix);
+    dfa->endBest.push_back(end);
+    dfa->next.insert(dfa->next.end(), numClasses, ROBOTS_UNBUILT);
+    if (positions.empty()) {
+        dfa->deadState = id;
+    }
+    dfa->positions += positions.size();
+    dfa->ids.emplace(positions, id);
+    dfa->sets.push_back(positions);
+    return id;
+}
+
+bool RobotsRules::buildRow(int state) const {
+    std::vector<int> rest, out;
+    std::vector<std::vector<int>> advanced(numClasses);
+    std::vector<int> touched;
+
+    // one pass sorts positions into those any byte keeps (a '*') and those one class advances
+    for (int p : dfa->sets[state]) {
+        const Rule& rule = rules[ruleOf[p]];
+        size_t j = p - base[ruleOf[p]];
+        if (j == rule.pattern.size()) {
+            continue; // matched already; scores() counted it
+        }
+        if (rule.pattern[j] == '*') {
+            rest.push_back(p);
+            continue;
+        }
+        int k = classOf[(uint8_t)rule.pattern[j]];
+        if (advanced[k].empty()) {
+            touched.push_back(k);
+        }
+        advanced[k].push_back(p + 1);
+    }
+
+    // classes no position advances on lead to the same state
+    closure(rest);
+    int restId = stateFor(rest);
+    if (restId < 0) {
+        return false;
+    }
+    for (int k = 0; k < numClasses; k++) {
+        dfa->next[state * numClasses + k] = (uint16_t)restId;
+    }
+    for (int k : touched) {
+        out = rest;
+        out.insert(out.end(), advanced[k].begin(), advanced[k].end());
+        closure(out);
+        int id = stateFor(out);
+        if (id < 0) {
+            return false;
+        }
+        dfa->next[state * numClasses + k] = (uint16_t)id;
+    }
+    return true;
+}
+
+int32_t RobotsRules::simulate(std::string_view path) const {
+    // the same walk as the DFA, but over live positions, deduped with a stamp per step
+    std::vector<int> positions, out;
+    std::vector<size_t> stamp(ruleOf.size(), 0);
+    size_t generation = 1;
+    int32_t best = -1, end = -1;
+
+    auto add = [&](std::vector<int>& live, int p) {
+        while (stamp[p] != generation) {
+            stamp[p] = generation;
+            live.push_back(p);
+            const Rule& rule = rules[ruleOf[p]];
+            size_t j = p - base[ruleOf[p]];
+            if (j == rule.pattern.size()) {
+                int32_t& target = rule.anchored ? end : best;
+                target = std::max(target, (int32_t)rule.score);
+                return;
+            }
+            if (rule.pattern[j] != '*') {
+                return;
+            }
+            p++;
+        }
+    };
+
+    for (int b : base) {
+        add(positions, b);
+    }
+    for (char ch : path) {
+        generation++;
+        end = -1;
+        out.clear();
+        for (int p : positions) {
+            const Rule& rule = rules[ruleOf[p]];
+            size_t j = p - base[ruleOf[p]];
+            if (j == rule.pattern.size()) {
+                continue;
+            }
+            if (rule.pattern[j] == '*') {
+                add(out, p);
+            }
+            else if (rule.pattern[j] == ch) {
+                add(out, p + 1);
+            }
+        }
+        positions.swap(out);
+        if (positions.empty()) {
+            return best;
+        }
+    }
+    return std::max(best, end);
+}
+
+bool RobotsRules::allowed(std::string_view path) const {
+    if (rules.empty() || path == "/robots.txt") {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (!dfa) {
+        return decide(simulate(path));
+    }
+
+    int state = 0;
+    size_t i = 0;
+    int32_t best = dfa->prefixBest[0];
+    for (; i < path.size(); i++) {
+        size_t slot = (size_t)state * numClasses + classOf[(uint8_t)path[i]];
+        if (dfa->next[slot] == ROBOTS_UNBUILT && !buildRow(state)) {
+            // pathological wildcard sets: give up on the table and run the NFA from now on
+            dfa.reset();
+            return decide(simulate(path));
+        }
+        state = dfa->next[slot];
+        if (state == dfa->deadState) {
+            break;
+        }
+        best = std::max(best, dfa->prefixBest[state]);
+    }
+
+    if (i == path.size()) {
+        best = std::max(best, dfa->endBest[state]);
+    }
+    return decide(best);
+}
+
+bool RobotsRules::decide(int32_t best) {
+    // no rule matched, or the most specific one is an Allow
+    return best < 0 || (best & 1);
+}
+
+int RobotsRules::getCrawlDelayMs() const {
+    return crawlDelayMs;
+}
+
+size_t RobotsRules::PositionHash::operator()(const std::vector<int>& positions) const {
+    size_t hash = positions.size();
+    for (int p : positions) {
+        hash = hash * 1000003 ^ (size_t)p;
+    }
+    return hash;
+}
+
+size_t RobotsRules::getRuleCount() const {
+    return rules.size();
+}
+
+size_t RobotsRules::getStateCount() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return dfa ? dfa->sets.size() : 0;
+}
+
+RobotsCache::RobotsCache(long capacity) : hits(0), misses(0) {
+    shardCapacity = (size_t)std::max(1L, capacity / ROBOTS_CACHE_SHARDS);
+}
+
+RobotsCache::Shard& RobotsCache::shardFor(const std::string& site) {
+    return shards[std::hash<std::string>()(site) % ROBOTS_CACHE_SHARDS];
+}
+
+std::shared_ptr<const RobotsRules> RobotsCache::lookup(const std::string& site) {
+    Shard& shard = shardFor(site);
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    // an expired entry stays until insert() replaces it, so the order holds each site once
+    auto it = shard.entries.find(site);
+    if (it == shard.entries.end() || it->second.expires <= std::chrono::steady_clock::now()) {
+        misses++;
+        return nullptr;
+    }
+    hits++;
+    return it->second.rules;
+}
+
+void RobotsCache::insert(const std::string& site, std::shared_ptr<const RobotsRules> rules) {
+    Entry entry;
+    entry.rules = std::move(rules);
+    entry.expires = std::chrono::steady_clock::now() + std::chrono::seconds(ROBOTS_CACHE_TTL);
+
+    Shard& shard = shardFor(site);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    auto inserted = shard.entries.insert_or_assign(site, std::move(entry));
+    if (!inserted.second) {
+        return;
+    }
+    shard.order.push_back(site);
+    if (shard.order.size() > shardCapacity) {
+        shard.entries.erase(shard.order.front());
+        shard.order.pop_front();
+    }
+}
+
+long RobotsCache::getHits() const {
+    return hits.load();
+}
+
+long RobotsCache::getMisses() const {
+    return misses.load();
+}
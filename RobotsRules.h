@@ -0,0 +1,139 @@
+#ifndef ROBOTS_RULES_H
+#define ROBOTS_RULES_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#define ROBOTS_MAX_STATES 4096           // DFA states before matching falls back to the NFA
+#define ROBOTS_MAX_TABLE (256 * 1024)    // DFA transitions, likewise
+#define ROBOTS_MAX_POSITIONS (64 * 1024) // NFA positions held across all DFA states, likewise
+#define ROBOTS_UNBUILT 0xFFFF            // DFA transition not worked out yet
+#define ROBOTS_MAX_DELAY_MS 60000        // longest Crawl-delay honoured
+#define ROBOTS_CACHE_SHARDS 64
+#define ROBOTS_CACHE_TTL (24 * 3600)     // seconds, as RFC 9309 suggests
+
+struct HTTPResponse;
+
+// the Allow/Disallow rules of one robots.txt that apply to our user-agent,
+// compiled into a DFA over byte classes: a path is checked in one table step
+// per byte, whatever the number of rules or wildcards. states are built the
+// first time a path reaches them, so a site checked for one page pays for one
+// path's worth. the longest matching pattern decides and Allow wins a tie, as
+// in RFC 9309
+class RobotsRules {
+    public:
+        // rules for the group naming userAgent, or the '*' group if none does
+        static std::shared_ptr<const RobotsRules> parse(std::string_view body, std::string_view userAgent);
+
+        // by status: 2xx parses the body, 3xx and 4xx allow everything (redirects
+        // are not followed) and anything else disallows everything
+        static std::shared_ptr<const RobotsRules> fromResponse(const HTTPResponse& response, std::string_view userAgent);
+
+        // shared instances for sites without rules and sites that are off limits
+        static std::shared_ptr<const RobotsRules> allowAll();
+        static std::shared_ptr<const RobotsRules> disallowAll();
+
+        // whether a request path (with its query) may be fetched
+        bool allowed(std::string_view path) const;
+
+        int getCrawlDelayMs() const;
+        size_t getRuleCount() const;
+        size_t getStateCount() const;  // built so far; 0 once the DFA grew too big and the NFA is run instead
+
+    private:
+        struct Rule {
+            std::string pattern;  // without a trailing '$'
+            bool anchored;        // the pattern ended in '$'
+            int score;            // twice the original length, plus one for Allow
+        };
+
+        RobotsRules();
+
+        void addRule(std::string_view value, bool allow);
+        void compile();
+
+        // sets of NFA positions name DFA states
+        struct PositionHash {
+            size_t operator()(const std::vector<int>& positions) const;
+        };
+
+        struct DFA {
+            std::vector<uint16_t> next;      // state * numClasses + class
+            std::vector<int32_t> prefixBest; // best unanchored rule matched on reaching a state, -1 if none
+            std::vector<int32_t> endBest;    // best anchored rule matched if the path ends there
+            std::vector<std::vector<int>> sets;
+            std::unordered_map<std::vector<int>, int, PositionHash> ids;
+            int deadState = -1;              // no rule can match from here
+            size_t positions = 0;            // summed over sets
+        };
+
+        // NFA positions: rule i at offset j is base[i] + j
+        void closure(std::vector<int>& positions) const;
+        void scores(const std::vector<int>& positions, int32_t& prefix, int32_t& end) const;
+        int32_t simulate(std::string_view path) const;
+
+        // the state for a closed position set, added with an unbuilt row if new;
+        // -1 if a new state would pass a ROBOTS_MAX_ limit
+        int stateFor(std::vector<int>& positions) const;
+        // false once a target state would pass a limit, leaving the row half built
+        bool buildRow(int state) const;
+
+        static bool decide(int32_t best);
+
+        std::vector<Rule> rules;
+        std::vector<int> base;
+        std::vector<int> ruleOf;  // position -> rule
+        int crawlDelayMs;
+
+        uint8_t classOf[256];  // byte -> class; bytes no pattern mentions share class 0
+        int numClasses;
+
+        // grown by allowed() from any worker, hence the lock
+        mutable std::mutex lock;
+        mutable std::unique_ptr<DFA> dfa;
+};
+
+// compiled robots.txt per host:port, shared by every worker, so later URLs on a
+// host are checked without another request. locked in shards like DNSCache,
+// and bounded: each shard forgets its oldest host once it is full
+class RobotsCache {
+    public:
+        explicit RobotsCache(long capacity);
+
+        // nullptr on a miss or once the entry is older than ROBOTS_CACHE_TTL
+        std::shared_ptr<const RobotsRules> lookup(const std::string& site);
+        void insert(const std::string& site, std::shared_ptr<const RobotsRules> rules);
+
+        long getHits() const;
+        long getMisses() const;
+
+    private:
+        struct Entry {
+            std::shared_ptr<const RobotsRules> rules;
+            std::chrono::steady_clock::time_point expires;
+        };
+
+        // padded so neighbouring shard locks do not share a cache line
+        struct alignas(64) Shard {
+            std::mutex lock;
+            std::unordered_map<std::string, Entry> entries;
+            std::deque<std::string> order;  // insertion order, for eviction
+        };
+
+        Shard& shardFor(const std::string& site);
+
+        Shard shards[ROBOTS_CACHE_SHARDS];
+        size_t shardCapacity;
+        std::atomic<long> hits;
+        std::atomic<long> misses;
+};
+
+#endif // ROBOTS_RULES_H
@@ -0,0 +1,253 @@
+#include "SeedReader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef WINCRAWL_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define SEED_INFLATE_CHUNK (256 * 1024)
+#define SEED_INFLATE_INPUT ((size_t)1 << 30)  // zlib counts input in 32 bits
+#define SEED_RELEASE_STEP ((size_t)64 * 1024 * 1024)
+
+static std::string_view trim(std::string_view line) {
+    const char* whitespace = " \n\r\t";
+    size_t first = line.find_first_not_of(whitespace);
+    if (first == std::string_view::npos) {
+        return std::string_view();
+    }
+    size_t last = line.find_last_not_of(whitespace);
+    return line.substr(first, last - first + 1);
+}
+
+SeedReader::SeedReader()
+    : data(nullptr), size(0), pos(0), released(0),
+#ifdef _WIN32
+      file(INVALID_HANDLE_VALUE), mapping(NULL),
+#else
+      fd(-1),
+#endif
+      compressed(false), stream(nullptr), textEnd(0), streamDone(false) {
+}
+
+SeedReader::~SeedReader() {
+    close();
+}
+
+bool SeedReader::open(const std::string& path) {
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    size = (size_t)fileSize.QuadPart;
+    if (size > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        data = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (data == nullptr) {
+            close();
+            return false;
+        }
+    }
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close();
+        return false;
+    }
+    size = (size_t)st.st_size;
+    if (size > 0) {
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close();
+            return false;
+        }
+        // pages are read once front to back; let the kernel read ahead
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = (const char*)mapped;
+    }
+#endif
+
+    pos = 0;
+    released = 0;
+    compressed = size >= 2 && (unsigned char)data[0] == 0x1F && (unsigned char)data[1] == 0x8B;
+    if (!compressed) {
+        return true;
+    }
+
+#ifdef WINCRAWL_HAVE_ZLIB
+    stream = new z_stream_s;
+    memset(stream, 0, sizeof(*stream));
+    // 16 + MAX_WBITS: expect a gzip wrapper
+    if (inflateInit2(stream, 16 + MAX_WBITS) != Z_OK) {
+        close();
+        return false;
+    }
+    stream->next_in = (Bytef*)data;
+    stream->avail_in = 0;
+    text.resize(SEED_INFLATE_CHUNK);
+    textEnd = 0;
+    streamDone = false;
+    return true;
+#else
+    printf("Seed file is gzip-compressed but this build has no zlib\n");
+    close();
+    return false;
+#endif
+}
+
+void SeedReader::close() {
+#ifdef WINCRAWL_HAVE_ZLIB
+    if (stream) {
+        inflateEnd(stream);
+        delete stream;
+        stream = nullptr;
+    }
+#endif
+
+#ifdef _WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+        mapping = NULL;
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (data) {
+        munmap((void*)data, size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+    data = nullptr;
+}
+
+void SeedReader::release(size_t consumed) {
+    // every so often hand the pages already read back to the kernel, so resident
+    // memory stays flat however large the seed file is
+    if (consumed - released < SEED_RELEASE_STEP) {
+        return;
+    }
+#ifndef _WIN32
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t end = consumed / pageSize * pageSize;
+    madvise((void*)(data + released), end - released, MADV_DONTNEED);
+    released = end;
+#else
+    released = consumed;
+#endif
+}
+
+long long SeedReader::getFileSize() const {
+    return (long long)size;
+}
+
+bool SeedReader::isCompressed() const {
+    return compressed;
+}
+
+bool SeedReader::nextLine(std::string_view& line) {
+    if (!compressed) {
+        if (pos >= size) {
+            return false;
+        }
+        const char* start = data + pos;
+        const char* newline = (const char*)memchr(start, '\n', size - pos);
+        size_t len = newline ? (size_t)(newline - start) : size - pos;
+        release(pos);
+        pos += len + 1;
+        line = trim(std::string_view(start, len));
+        return true;
+    }
+
+    while (true) {
+        const char* start = text.data() + pos;
+        const char* newline = (const char*)memchr(start, '\n', textEnd - pos);
+        if (newline) {
+            size_t len = newline - start;
+            pos += len + 1;
+            line = trim(std::string_view(start, len));
+            return true;
+        }
+        if (!inflateMore()) {
+            // a last line without a trailing newline
+            if (pos < textEnd) {
+                line = trim(std::string_view(text.data() + pos, textEnd - pos));
+                pos = textEnd;
+                return true;
+            }
+            return false;
+        }
+    }
+}
+
+bool SeedReader::inflateMore() {
+#ifdef WINCRAWL_HAVE_ZLIB
+    if (streamDone) {
+        return false;
+    }
+
+    // slide the partial line to the front, growing only for lines longer than a chunk
+    memmove(text.data(), text.data() + pos, textEnd - pos);
+    textEnd -= pos;
+    pos = 0;
+    if (textEnd == text.size()) {
+        text.resize(text.size() * 2);
+    }
+
+    // feed the mapped input in pieces zlib can count
+    size_t consumed = (const char*)stream->next_in - data;
+    if (stream->avail_in == 0 && consumed < size) {
+        stream->avail_in = (uInt)std::min(size - consumed, SEED_INFLATE_INPUT);
+    }
+    release(consumed);
+
+    stream->next_out = (Bytef*)text.data() + textEnd;
+    stream->avail_out = (uInt)(text.size() - textEnd);
+    int ret = inflate(stream, Z_NO_FLUSH);
+    textEnd = text.size() - stream->avail_out;
+
+    if (ret == Z_STREAM_END) {
+        // concatenated gzip members (e.g. appended seed lists) continue the stream;
+        // a member can end exactly on a slice boundary, so the whole mapping decides
+        if ((size_t)((const char*)stream->next_in - data) < size) {
+            inflateReset(stream);
+        }
+        else {
+            streamDone = true;
+        }
+    }
+    else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        printf("Seed file is corrupt: %s\n", stream->msg ? stream->msg : "inflate failed");
+        streamDone = true;
+    }
+    else if (ret == Z_BUF_ERROR && stream->avail_in == 0 && (size_t)((const char*)stream->next_in - data) == size) {
+        streamDone = true; // truncated input
+    }
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,58 @@
+#ifndef SEED_READER_H
+#define SEED_READER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+struct z_stream_s;
+
+// streams trimmed lines out of a memory-mapped seed file without loading it;
+// gzip input (detected by its magic bytes) is inflated a chunk at a time
+class SeedReader {
+    public:
+        SeedReader();
+        ~SeedReader();
+
+        // map the file; false if it cannot be opened, or is gzip without zlib support
+        bool open(const std::string& path);
+        void close();
+
+        long long getFileSize() const;
+        bool isCompressed() const;
+
+        // next line with surrounding whitespace trimmed, valid until the next call;
+        // false at the end of the input
+        bool nextLine(std::string_view& line);
+
+    private:
+        // inflate more of the mapped input into text; false once it is exhausted
+        bool inflateMore();
+
+        // drop mapped pages before consumed from the resident set
+        void release(size_t consumed);
+
+        const char* data;  // the mapped file
+        size_t size;
+        size_t pos;        // next unread byte of data (plain) or of text (gzip)
+        size_t released;   // bytes of data already handed back by release()
+
+#ifdef _WIN32
+        HANDLE file;
+        HANDLE mapping;
+#else
+        int fd;
+#endif
+
+        bool compressed;
+        z_stream_s* stream;
+        std::vector<char> text;  // inflated bytes not yet returned as lines
+        size_t textEnd;
+        bool streamDone;
+};
+
+#endif // SEED_READER_H
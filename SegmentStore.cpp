@@ -0,0 +1,242 @@
+#include "SegmentStore.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+
+#ifdef WINCRAWL_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define SEGMENT_MAGIC 0x47534357u  // "WCSG"
+#define SEGMENT_DEFLATE 1
+
+// fixed header in front of every segment file
+struct SegmentHeader {
+    uint32_t magic;
+    uint32_t flags;
+    uint64_t rawBytes;
+    uint64_t storedBytes;
+};
+
+SegmentStore::SegmentStore(const std::string& dir)
+    : dir(dir), nextId(0), stopping(false), inMemory(0), bytesWritten(0), onDisk(0) {
+}
+
+SegmentStore::~SegmentStore() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    work.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    // whatever was never read back goes with the frontier
+    for (long id = 0; id < nextId; id++) {
+        std::remove(pathFor(id).c_str());
+    }
+}
+
+bool SegmentStore::open() {
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+
+    // prove the directory is writable before anything depends on it
+    std::string probe = pathFor(-1);
+    FILE* file = fopen(probe.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    fclose(file);
+    std::remove(probe.c_str());
+
+    thread = std::thread(&SegmentStore::run, this);
+    return true;
+}
+
+std::string SegmentStore::pathFor(long id) const {
+    return dir + "/frontier-" + std::to_string(id) + ".seg";
+}
+
+std::shared_ptr<Segment> SegmentStore::write(std::string records, long count) {
+    std::shared_ptr<Segment> segment = std::make_shared<Segment>();
+    segment->count = count;
+    segment->rawBytes = records.size();
+    segment->records = std::move(records);
+    inMemory += (long)segment->rawBytes;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        segment->id = nextId++;
+        writes.push_back(segment);
+    }
+    work.notify_one();
+    return segment;
+}
+
+void SegmentStore::prefetch(const std::shared_ptr<Segment>& segment) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (segment->state != Segment::State::OnDisk) {
+            return; // still in memory, or already on its way back
+        }
+        segment->state = Segment::State::Reading;
+        reads.push_back(segment);
+    }
+    work.notify_one();
+}
+
+void SegmentStore::take(const std::shared_ptr<Segment>& segment, std::string& records) {
+    prefetch(segment);
+
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [&] { return segment->state == Segment::State::Writing || segment->state == Segment::State::Loaded; });
+
+    // a segment still queued for writing is simply handed back; run() skips it
+    segment->taken = true;
+    records = std::move(segment->records);
+    segment->records = std::string();
+    inMemory -= (long)segment->rawBytes;
+}
+
+void SegmentStore::run() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        work.wait(guard, [this] { return stopping || !writes.empty() || !reads.empty(); });
+        if (stopping) {
+            return;
+        }
+
+        // reads first: a worker may be about to wait for one
+        if (!reads.empty()) {
+            std::shared_ptr<Segment> segment = reads.front();
+            reads.pop_front();
+            guard.unlock();
+
+            std::string records;
+            bool ok = readFile(*segment, records);
+            std::remove(pathFor(segment->id).c_str());
+            onDisk--;
+            if (!ok) {
+                printf("Lost frontier segment %ld (%ld links)\n", segment->id, segment->count);
+                records.clear();
+            }
+
+            guard.lock();
+            inMemory += (long)segment->rawBytes;
+            segment->records = std::move(records);
+            segment->state = Segment::State::Loaded;
+            done.notify_all();
+            continue;
+        }
+
+        std::shared_ptr<Segment> segment = writes.front();
+        writes.pop_front();
+        if (segment->taken) {
+            continue;
+        }
+
+        // compress and write a copy, so a take() meanwhile can still move the records out
+        std::string records = segment->records;
+        guard.unlock();
+        bool ok = writeFile(*segment, records);
+        guard.lock();
+
+        if (segment->taken) {
+            std::remove(pathFor(segment->id).c_str());
+            continue;
+        }
+        if (!ok) {
+            // keep it in memory rather than lose it
+            printf("Failed to write frontier segment %ld, keeping it in memory\n", segment->id);
+            continue;
+        }
+        onDisk++;
+        inMemory -= (long)segment->rawBytes;
+        segment->records = std::string();
+        segment->state = Segment::State::OnDisk;
+    }
+}
+
+bool SegmentStore::writeFile(Segment& segment, const std::string& records) {
+    SegmentHeader header;
+    header.magic = SEGMENT_MAGIC;
+    header.flags = 0;
+    header.rawBytes = records.size();
+
+    const char* out = records.data();
+    size_t outBytes = records.size();
+#ifdef WINCRAWL_HAVE_ZLIB
+    // level 1: spilling has to keep up with link extraction
+    std::string packed(compressBound((uLong)records.size()), '\0');
+    uLongf packedBytes = (uLongf)packed.size();
+    if (compress2((Bytef*)&packed[0], &packedBytes, (const Bytef*)records.data(), (uLong)records.size(), 1) == Z_OK) {
+        header.flags = SEGMENT_DEFLATE;
+        out = packed.data();
+        outBytes = packedBytes;
+    }
+#endif
+    header.storedBytes = outBytes;
+
+    std::string path = pathFor(segment.id);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(out, 1, outBytes, file) == outBytes;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        std::remove(path.c_str());
+        return false;
+    }
+    bytesWritten += (long)(sizeof(header) + outBytes);
+    return true;
+}
+
+bool SegmentStore::readFile(Segment& segment, std::string& records) {
+    FILE* file = fopen(pathFor(segment.id).c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    SegmentHeader header;
+    std::string stored;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == SEGMENT_MAGIC;
+    if (ok) {
+        stored.resize(header.storedBytes);
+        ok = fread(&stored[0], 1, stored.size(), file) == stored.size();
+    }
+    fclose(file);
+    if (!ok) {
+        return false;
+    }
+
+    if (!(header.flags & SEGMENT_DEFLATE)) {
+        records = std::move(stored);
+        return true;
+    }
+#ifdef WINCRAWL_HAVE_ZLIB
+    records.resize(header.rawBytes);
+    uLongf rawBytes = (uLongf)records.size();
+    return uncompress((Bytef*)&records[0], &rawBytes, (const Bytef*)stored.data(), (uLong)stored.size()) == Z_OK &&
+        rawBytes == header.rawBytes;
+#else
+    return false;
+#endif
+}
+
+long SegmentStore::memoryBytes() const {
+    return inMemory.load();
+}
+
+long SegmentStore::getBytesWritten() const {
+    return bytesWritten.load();
+}
+
+long SegmentStore::getSegmentsOnDisk() const {
+    return onDisk.load();
+}
@@ -0,0 +1,73 @@
+#ifndef SEGMENT_STORE_H
+#define SEGMENT_STORE_H
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+// one sealed run of serialized frontier records; in memory until it is written,
+// and again once it has been read back
+struct Segment {
+    enum class State { Writing, OnDisk, Reading, Loaded };
+
+    long id = 0;
+    long count = 0;        // records inside
+    size_t rawBytes = 0;   // serialized size before compression
+    State state = State::Writing;
+    bool taken = false;    // handed back to the frontier, the file is no longer needed
+    std::string records;
+};
+
+// append-only spill files for the frontier. sealed segments are compressed and
+// written by one I/O thread, and read back by the same thread ahead of time when
+// the frontier asks, so workers rarely wait on the disk. a segment taken while
+// it is still queued for writing is handed back from memory and never written
+class SegmentStore {
+    public:
+        explicit SegmentStore(const std::string& dir);
+        ~SegmentStore();
+
+        // create the directory and start the I/O thread; false if it is not writable
+        bool open();
+
+        // queue records for writing as the next segment
+        std::shared_ptr<Segment> write(std::string records, long count);
+
+        // start reading a segment back into memory
+        void prefetch(const std::shared_ptr<Segment>& segment);
+
+        // the segment's records, waiting for the I/O thread if they are not in memory yet
+        void take(const std::shared_ptr<Segment>& segment, std::string& records);
+
+        // bytes of spilled segments held in memory: queued for writing or read back
+        long memoryBytes() const;
+        long getBytesWritten() const;
+        long getSegmentsOnDisk() const;
+
+    private:
+        void run();
+        bool writeFile(Segment& segment, const std::string& records);
+        bool readFile(Segment& segment, std::string& records);
+        std::string pathFor(long id) const;
+
+        std::string dir;
+        long nextId;
+
+        std::mutex lock;
+        std::condition_variable work;
+        std::condition_variable done;
+        std::deque<std::shared_ptr<Segment>> writes;
+        std::deque<std::shared_ptr<Segment>> reads;
+        bool stopping;
+        std::thread thread;
+
+        std::atomic<long> inMemory;
+        std::atomic<long> bytesWritten;
+        std::atomic<long> onDisk;
+};
+
+#endif // SEGMENT_STORE_H
@@ -0,0 +1,57 @@
+#ifndef SHARDED_SET_H
+#define SHARDED_SET_H
+
+#include <unordered_set>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+#define SHARDED_SET_BITS 8  // 256 shards
+
+// insert-only concurrent set striped over independently locked shards, so
+// threads deduping different keys almost never wait on the same lock
+template <typename Key, typename Hash = std::hash<Key>>
+class ShardedSet {
+    public:
+        // true if key was not present before
+        bool insert(const Key& key) {
+            size_t hash = Hash()(key);
+            Shard& shard = shards[shardIndex(hash)];
+            std::lock_guard<std::mutex> lock(shard.lock);
+            return shard.keys.insert(key).second;
+        }
+
+        // undo an insert; true if key was present
+        bool erase(const Key& key) {
+            size_t hash = Hash()(key);
+            Shard& shard = shards[shardIndex(hash)];
+            std::lock_guard<std::mutex> lock(shard.lock);
+            return shard.keys.erase(key) > 0;
+        }
+
+        size_t size() {
+            size_t total = 0;
+            for (Shard& shard : shards) {
+                std::lock_guard<std::mutex> lock(shard.lock);
+                total += shard.keys.size();
+            }
+            return total;
+        }
+
+    private:
+        // padded so neighbouring shard locks do not share a cache line
+        struct alignas(64) Shard {
+            std::mutex lock;
+            std::unordered_set<Key, Hash> keys;
+        };
+
+        // the table inside each shard buckets by the low bits of the same hash,
+        // so pick the shard from the high bits of a multiplicative remix
+        static size_t shardIndex(size_t hash) {
+            return (size_t)(((uint64_t)hash * 0x9E3779B97F4A7C15ull) >> (64 - SHARDED_SET_BITS));
+        }
+
+        Shard shards[1 << SHARDED_SET_BITS];
+};
+
+#endif // SHARDED_SET_H
@@ -2,17 +2,46 @@
 #define WIN32_LEAN_AND_MEAN
 
 #include "Socket.h"
+#include "DNSResolver.h"
+#include "DNSCache.h"
 
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <cstring>
+#include <cstdlib>
+#include <cctype>
 #include <chrono>
 
+#ifndef _WIN32
+#include <poll.h>
+#include <fcntl.h>
+#endif
+
+#ifdef __linux__
+#include "IoUring.h"
+
+#define URING_ENTRIES 8
+#define URING_BUFFERS 32        // power of two
+#define URING_BUFFER_SIZE 4096
+
+// io_uring request kinds, kept in the low bits of user_data
+#define URING_OP_CONNECT 1
+#define URING_OP_SEND 2
+#define URING_OP_RECV 3
+#define URING_OP_CANCEL 4
+#endif
+
 #define INITIAL_BUF_SIZE 1024
 #define THRESHOLD 128
 
-Socket::Socket() : sock(INVALID_SOCKET), buf(nullptr), allocatedSize(0), curPos(0) {
+Socket::Socket() : sock(INVALID_SOCKET), buf(nullptr), allocatedSize(0), curPos(0), wouldBlock(false), outPos(0),
+	keepAlive(false), reusable(false), answered(false), msgLen(0), msgEnd(0), framing(HTTPFraming::Headers), scanned(0), bodyStart(0),
+	bodyEnd(0), chunkPos(0), chunkPayload(0), resolver(nullptr), cache(nullptr)
+#ifdef __linux__
+	, ring(nullptr), generation(0), inflight(0)
+#endif
+{
 	buf = new char[INITIAL_BUF_SIZE];
 	if (!buf) {
 		throw std::bad_alloc();
@@ -25,58 +54,37 @@ Socket::~Socket() {
 	if (buf) {
 		delete[] buf;
 	}
+#ifdef __linux__
+	delete ring;
+#endif
 }
 
 bool Socket::Read(const size_t& limit)
 {
-	fd_set readfds;
+#ifdef __linux__
+	if (ring) {
+		return uringRead(limit);
+	}
+#endif
 	auto startTime = std::chrono::high_resolution_clock::now();
 
 	while (true)
 	{
-		// reinitialize on each iteration for multithreading compatibility
-		timeval timeout;
-		timeout.tv_sec = 10;
-		timeout.tv_usec = 0;
-
-		FD_ZERO(&readfds);
-		FD_SET(sock, &readfds);
+		// stop as soon as the response is whole rather than when the peer closes
+		int framed = frameResponse(limit);
+		if (framed != 0) {
+			return framed > 0;
+		}
 
-		// wait to see if socket has any data (see MSDN)
-		int ret = select(0, &readfds, nullptr, nullptr, &timeout);
+		// wait to see if socket has any data
+		int ret = waitReadable(10000);
 		if (ret > 0)
 		{
-			// new data available; make sure there is room left for null terminator
-			if (allocatedSize - curPos <= 1) {
-				if (!resizeBuffer()) {
-					// printf("failed to resize buffer\n");
-					return false;
-				}
+			int status = recvSegment();
+			if (status > 0) {
+				return endOfStream();
 			}
-
-			// now read the next segment
-			int bytes = recv(sock, buf + curPos, allocatedSize - curPos - 1, 0);
-			if (bytes == SOCKET_ERROR) {
-				// print WSAGetLastError()
-				// std::cout << "failed with " << WSAGetLastError() << std::endl;
-				return false;
-			}
-			if (bytes == 0) { // connection closed
-				if (curPos < allocatedSize) { // ensure within bounds
-					buf[curPos] = '\0'; // NULL-terminate buffer
-				}
-				else {
-					// printf("Buffer overflow while null-terminating\n");
-					return false;
-				}
-
-				return true; // normal completion
-			}
-			curPos += bytes; // adjust where the next recv goes
-
-			// check for exceeding size limit
-			if (curPos > limit) {
-				// printf("failed with exceeding max\n");
+			if (status != 0) {
 				return false;
 			}
 
@@ -87,16 +95,6 @@ bool Socket::Read(const size_t& limit)
 				// printf("failed with slow download\n");
 				return false;
 			}
-
-			// extra byte for null terminator
-			if (allocatedSize - curPos - 1 < THRESHOLD) {
-				// resize buffer; you can use realloc(), HeapReAlloc(), or
-				// memcpy the buffer into a bigger array
-				if (!resizeBuffer()) {
-					// printf("failed to resize buffer\n");
-					return false;
-				}
-			}
 		}
 		else if (ret == 0) {
 			// report timeout
@@ -111,6 +109,107 @@ bool Socket::Read(const size_t& limit)
 	}
 }
 
+int Socket::readSome(const size_t& limit)
+{
+	// drain whatever the kernel has buffered without blocking
+	while (true) {
+		int framed = frameResponse(limit);
+		if (framed != 0) {
+			return framed;
+		}
+
+		int status = recvSegment();
+		if (status > 0) {
+			return endOfStream() ? 1 : -1;
+		}
+		if (status != 0) {
+			return status;
+		}
+		if (wouldBlock) {
+			return 0;
+		}
+	}
+}
+
+int Socket::recvSegment()
+{
+	wouldBlock = false;
+
+	// make sure there is room left for null terminator
+	if (allocatedSize - curPos <= 1) {
+		if (!resizeBuffer()) {
+			// printf("failed to resize buffer\n");
+			return -1;
+		}
+	}
+
+	// now read the next segment
+	int bytes = recv(sock, buf + curPos, allocatedSize - curPos - 1, 0);
+	if (bytes == SOCKET_ERROR) {
+		if (isWouldBlock(WSAGetLastError())) {
+			wouldBlock = true;
+			return 0;
+		}
+		// print WSAGetLastError()
+		// std::cout << "failed with " << WSAGetLastError() << std::endl;
+		return -1;
+	}
+	if (bytes == 0) { // connection closed
+		if (curPos < allocatedSize) { // ensure within bounds
+			buf[curPos] = '\0'; // NULL-terminate buffer
+		}
+		else {
+			// printf("Buffer overflow while null-terminating\n");
+			return -1;
+		}
+
+		return 1; // normal completion
+	}
+	curPos += bytes; // adjust where the next recv goes
+
+	// the size limit is checked by frameResponse(), since the buffer may also
+	// hold the start of the next pipelined response
+
+	// extra byte for null terminator
+	if (allocatedSize - curPos - 1 < THRESHOLD) {
+		// resize buffer; you can use realloc(), HeapReAlloc(), or
+		// memcpy the buffer into a bigger array
+		if (!resizeBuffer()) {
+			// printf("failed to resize buffer\n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int Socket::waitReadable(int timeoutMs) {
+#ifdef _WIN32
+	// reinitialize on each call for multithreading compatibility
+	fd_set readfds;
+	FD_ZERO(&readfds);
+	FD_SET(sock, &readfds);
+
+	timeval timeout;
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_usec = (timeoutMs % 1000) * 1000;
+
+	// first argument is ignored by WinSock (see MSDN)
+	return select(0, &readfds, nullptr, nullptr, &timeout);
+#else
+	// poll instead of select since descriptors past FD_SETSIZE are common with many threads
+	pollfd pfd;
+	pfd.fd = sock;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	int ret;
+	do {
+		ret = poll(&pfd, 1, timeoutMs);
+	} while (ret < 0 && errno == EINTR);
+	return ret;
+#endif
+}
+
 bool Socket::resizeBuffer() {
 	//doubling buffer size whenever called
 	int newSize = allocatedSize * 2;
@@ -130,14 +229,65 @@ bool Socket::resizeBuffer() {
 }
 
 void Socket::close() {
+#ifdef __linux__
+	if (ring) {
+		uringCancel();
+	}
+#endif
 	if (sock != INVALID_SOCKET) {
 		closesocket(sock);
 		sock = INVALID_SOCKET;
 	}
+
+	// nothing queued or received belongs to the next connection
+	outBuf.clear();
+	outPos = 0;
+	pendingHead.clear();
+	reusable = false;
+	answered = false;
+	curPos = 0;
+	msgLen = 0;
+	msgEnd = 0;
+	resetFraming();
 }
 
 bool Socket::resolveDNS(const std::string& host) {
+	// IP literals need no lookup
+	in_addr literal;
+	if (inet_pton(AF_INET, host.c_str(), &literal) == 1) {
+		setResolvedAddress(literal);
+		return true;
+	}
+
+	DNSStatus status;
+	in_addr addr = {};
+	if (cache && cache->lookup(host, status, addr)) {
+		if (status != DNSStatus::Ok) {
+			return false;
+		}
+		setResolvedAddress(addr);
+		return true;
+	}
+
+	uint32_t ttl = DNS_CACHE_DEFAULT_TTL;
+	if (resolver) {
+		status = resolver->resolve(host, addr, ttl);
+	}
+	else {
+		status = resolveSystem(host, addr);
+	}
+
+	if (cache) {
+		cache->insert(host, status, addr, ttl);
+	}
+	if (status != DNSStatus::Ok) {
+		return false;
+	}
+	setResolvedAddress(addr);
+	return true;
+}
 
+DNSStatus Socket::resolveSystem(const std::string& host, in_addr& addr) {
 	addrinfo hints = {};
 	hints.ai_family = AF_INET;
 	hints.ai_socktype = SOCK_STREAM;
@@ -147,45 +297,62 @@ bool Socket::resolveDNS(const std::string& host) {
 	int res = getaddrinfo(host.c_str(), NULL, &hints, &result);
 	if (res != 0) {
 		// std::cerr << "getaddrinfo failed with error: " << res << std::endl;
-		return false;
+		return res == EAI_NONAME ? DNSStatus::NXDomain : DNSStatus::Failed;
 	}
 
 	// assume first result is valid
 	sockaddr_in* sockaddr_ipv4 = reinterpret_cast<sockaddr_in*>(result->ai_addr);
-	sin_addr = sockaddr_ipv4->sin_addr;
-
-	// convert IP address to string
-	char ip_str[INET_ADDRSTRLEN];
-	if (inet_ntop(AF_INET, &sin_addr, ip_str, INET_ADDRSTRLEN) == NULL) {
-		std::cerr << "inet_ntop failed with error: " << WSAGetLastError() << std::endl;
-		freeaddrinfo(result);
-		return false;
-	}
-	ipAddr = ip_str;
+	addr = sockaddr_ipv4->sin_addr;
 
 	freeaddrinfo(result);
-	return true;
+	return DNSStatus::Ok;
+}
+
+void Socket::setResolvedAddress(in_addr addr) {
+	sin_addr = addr;
+}
+
+void Socket::setResolver(DNSResolver* dnsResolver) {
+	resolver = dnsResolver;
+}
+
+void Socket::setCache(DNSCache* dnsCache) {
+	cache = dnsCache;
 }
 
 in_addr Socket::getResolvedAddress() const {
 	return sin_addr;
 }
 
-bool Socket::connect(const std::string& host, int port) {
-	
-	if (sock != INVALID_SOCKET) {
-		closesocket(sock);
-		sock = INVALID_SOCKET;
-	}
+bool Socket::openSocket() {
+	close();
 
 	sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
 	if (sock == INVALID_SOCKET) {
 		printf("socket() generated error %d\n", WSAGetLastError());
 		return false;
 	}
+	return true;
+}
+
+bool Socket::connect(const std::string& host, int port) {
+#ifdef __linux__
+	if (ring) {
+		return uringConnect(port);
+	}
+#endif
+	if (!openSocket()) {
+		return false;
+	}
 
 	// set socket timeouts to 10 seconds
+#ifdef _WIN32
 	DWORD timeout = 10000; // timeout in milliseconds
+#else
+	timeval timeout;
+	timeout.tv_sec = 10;
+	timeout.tv_usec = 0;
+#endif
 	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
 	setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
 
@@ -203,45 +370,673 @@ bool Socket::connect(const std::string& host, int port) {
 	return true;
 }
 
-bool Socket::sendHTTPRequest(const std::string& host, const std::string& request, const std::string method) {
-	// assemble request
-	std::string httpRequest = method + " " + request + " HTTP/1.0\r\n"
-		"Host: " + host + "\r\n"
-		"Connection: close\r\n"
+bool Socket::startConnect(int port) {
+	if (!openSocket()) {
+		return false;
+	}
+
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	if (ioctlsocket(sock, FIONBIO, &nonBlocking) == SOCKET_ERROR) {
+		return false;
+	}
+#else
+	int flags = fcntl(sock, F_GETFL, 0);
+	if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0) {
+		return false;
+	}
+#endif
+
+	sockaddr_in server;
+	server.sin_family = AF_INET;
+	server.sin_port = htons(port);
+	server.sin_addr = sin_addr;
+
+	if (::connect(sock, (struct sockaddr*)&server, sizeof(server)) == SOCKET_ERROR) {
+		int err = WSAGetLastError();
+#ifdef _WIN32
+		return err == WSAEWOULDBLOCK;
+#else
+		return err == EINPROGRESS;
+#endif
+	}
+	return true;
+}
+
+bool Socket::finishConnect() {
+	int err = 0;
+	socklen_t len = sizeof(err);
+	if (getsockopt(sock, SOL_SOCKET, SO_ERROR, (char*)&err, &len) == SOCKET_ERROR) {
+		return false;
+	}
+	return err == 0;
+}
+
+SOCKET Socket::getHandle() const {
+	return sock;
+}
+
+std::string Socket::buildHTTPRequest(const std::string& host, const std::string& request, const std::string& method, bool keepAlive) {
+	return method + " " + request + (keepAlive ? " HTTP/1.1\r\n" : " HTTP/1.0\r\n") +
+		"Host: " + host + "\r\n" +
+		(keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n") +
 		"User-agent: ahmadCrawler/1.3\r\n\r\n";
+}
+
+bool Socket::sendHTTPRequest(const std::string& host, const std::string& request, const std::string method) {
+#ifdef __linux__
+	if (ring) {
+		return uringSend(host, request, method);
+	}
+#endif
+	// assemble request behind anything already queued, so pipelined requests share one send
+	queueHTTPRequest(host, request, method);
 
-	// printf("\n%s\n", httpRequest.c_str());
+	// printf("\n%s\n", outBuf.c_str());
 
-	if(send(sock, httpRequest.c_str(), httpRequest.length(), 0) == SOCKET_ERROR) {
-		// std::cout << "failed with " << WSAGetLastError() << std::endl;
+	while (outPos < outBuf.length()) {
+		int bytes = send(sock, outBuf.c_str() + outPos, (int)(outBuf.length() - outPos), MSG_NOSIGNAL);
+		if (bytes == SOCKET_ERROR) {
+			// std::cout << "failed with " << WSAGetLastError() << std::endl;
+			return false;
+		}
+		outPos += bytes;
+	}
+
+	return true;
+}
+
+void Socket::queueHTTPRequest(const std::string& host, const std::string& request, const std::string& method) {
+	// start over once everything queued earlier has gone out
+	if (outPos >= outBuf.length()) {
+		outBuf.clear();
+		outPos = 0;
+	}
+	outBuf += buildHTTPRequest(host, request, method, keepAlive);
+	pendingHead.push_back(method == "HEAD");
+}
+
+int Socket::flushRequest() {
+	while (outPos < outBuf.length()) {
+		int bytes = send(sock, outBuf.c_str() + outPos, (int)(outBuf.length() - outPos), MSG_NOSIGNAL);
+		if (bytes == SOCKET_ERROR) {
+			return isWouldBlock(WSAGetLastError()) ? 0 : -1;
+		}
+		outPos += bytes;
+	}
+	return 1;
+}
+
+void Socket::resetResponse() {
+	// move anything received past the last response, the start of the next
+	// pipelined one, to the front; otherwise recv overwrites the rest
+	if (msgEnd > 0 && msgEnd < curPos) {
+		memmove(buf, buf + msgEnd, curPos - msgEnd);
+		curPos -= msgEnd;
+	}
+	else {
+		curPos = 0;
+	}
+	msgLen = 0;
+	msgEnd = 0;
+	resetFraming();
+	buf[curPos] = '\0';
+}
+
+void Socket::resetFraming() {
+	framing = HTTPFraming::Headers;
+	scanned = 0;
+	bodyStart = 0;
+	bodyEnd = 0;
+	chunkPos = 0;
+	chunkPayload = 0;
+}
+
+void Socket::setKeepAlive(bool enabled) {
+	keepAlive = enabled;
+}
+
+bool Socket::canReuse() const {
+	return reusable && sock != INVALID_SOCKET;
+}
+
+static bool equalsNoCase(std::string_view a, std::string_view b) {
+	if (a.size() != b.size()) {
 		return false;
 	}
+	for (size_t i = 0; i < a.size(); i++) {
+		if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool containsNoCase(std::string_view haystack, std::string_view needle) {
+	for (size_t i = 0; i + needle.size() <= haystack.size(); i++) {
+		if (equalsNoCase(haystack.substr(i, needle.size()), needle)) {
+			return true;
+		}
+	}
+	return false;
+}
 
+// value of the first header field called name, without surrounding blanks; false if absent
+static bool findHeader(std::string_view headers, std::string_view name, std::string_view& value) {
+	size_t pos = headers.find("\r\n");
+	while (pos != std::string_view::npos) {
+		size_t start = pos + 2;
+		pos = headers.find("\r\n", start);
+		std::string_view line = headers.substr(start, pos == std::string_view::npos ? std::string_view::npos : pos - start);
+		if (line.size() > name.size() && line[name.size()] == ':' && equalsNoCase(line.substr(0, name.size()), name)) {
+			value = line.substr(name.size() + 1);
+			while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+				value.remove_prefix(1);
+			}
+			while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+				value.remove_suffix(1);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+// walk the chunks whose size line starts at pos, moving pos past each whole one and
+// adding its data to payload; returns the end of the trailer after the last chunk, 0 if
+// more has to arrive, -1 if malformed. With out set the chunk data is also packed to out
+static long walkChunks(char* buf, long& pos, long end, char* out, long& payload) {
+	while (true) {
+		// chunk size line: hex digits, optional extensions
+		const char* lineEnd = (const char*)memchr(buf + pos, '\n', end - pos);
+		if (!lineEnd) {
+			return 0;
+		}
+		long size = 0;
+		long digits = 0;
+		for (const char* p = buf + pos; isxdigit((unsigned char)*p); p++, digits++) {
+			if (size > (1L << 40)) {
+				return -1;
+			}
+			size = size * 16 + (isdigit((unsigned char)*p) ? *p - '0' : tolower((unsigned char)*p) - 'a' + 10);
+		}
+		if (digits == 0) {
+			return -1;
+		}
+		long data = (lineEnd - buf) + 1;
+
+		if (size == 0) {
+			// trailer fields up to an empty line; pos stays on the last chunk until it is whole
+			while (true) {
+				const char* trailerEnd = (const char*)memchr(buf + data, '\n', end - data);
+				if (!trailerEnd) {
+					return 0;
+				}
+				bool empty = trailerEnd == buf + data || (trailerEnd == buf + data + 1 && buf[data] == '\r');
+				data = (trailerEnd - buf) + 1;
+				if (empty) {
+					return data;
+				}
+			}
+		}
+
+		// data plus its CRLF
+		if (end - data < size + 2) {
+			return 0;
+		}
+		if (out) {
+			memmove(out + payload, buf + data, size);
+		}
+		payload += size;
+		pos = data + size + 2;
+	}
+}
+
+bool Socket::parseFraming(std::string_view headers, const size_t& limit) {
+	int statusCode = 0;
+	size_t space = headers.find(' ');
+	if (space != std::string_view::npos) {
+		statusCode = atoi(buf + space + 1);
+	}
+	bool head = !pendingHead.empty() && pendingHead.front();
+
+	// HTTP/1.1 stays open unless told otherwise, HTTP/1.0 only when asked to
+	std::string_view connection;
+	bool hasConnection = findHeader(headers, "Connection", connection);
+	if (headers.compare(0, 8, "HTTP/1.1") == 0) {
+		reusable = !(hasConnection && containsNoCase(connection, "close"));
+	}
+	else {
+		reusable = hasConnection && containsNoCase(connection, "keep-alive");
+	}
+	reusable = reusable && keepAlive;
+
+	std::string_view value;
+	if (head || (statusCode >= 100 && statusCode < 200) || statusCode == 204 || statusCode == 304) {
+		framing = HTTPFraming::Bodiless;
+	}
+	else if (findHeader(headers, "Transfer-Encoding", value) && containsNoCase(value, "chunked")) {
+		framing = HTTPFraming::Chunked;
+		chunkPos = bodyStart;
+		chunkPayload = 0;
+	}
+	else if (findHeader(headers, "Content-Length", value)) {
+		size_t length = 0;
+		for (char c : value) {
+			if (!isdigit((unsigned char)c) || length > limit) {
+				return false;
+			}
+			length = length * 10 + (c - '0');
+		}
+		if (value.empty() || bodyStart + length > limit) {
+			return false;
+		}
+		framing = HTTPFraming::Length;
+		bodyEnd = bodyStart + (long)length;
+	}
+	else {
+		framing = HTTPFraming::UntilClose;
+		reusable = false;
+	}
 	return true;
 }
 
-bool Socket::receiveResponse(std::string& response, int& statusCode, const size_t& limit) {
-	// reset buffer and position pointer before reading in new response
-	curPos = 0;
-	memset(buf, 0, allocatedSize);
+int Socket::frameResponse(const size_t& limit) {
+	if (msgLen > 0) {
+		return 1;
+	}
+
+	if (framing == HTTPFraming::Headers) {
+		// resume a few bytes back in case the blank line straddles two reads
+		std::string_view raw(buf, curPos);
+		size_t headerEnd = raw.find("\r\n\r\n", scanned > 3 ? scanned - 3 : 0);
+		if (headerEnd == std::string_view::npos) {
+			scanned = curPos;
+			return (size_t)curPos > limit ? -1 : 0;
+		}
+		bodyStart = (int)headerEnd + 4;
+		if (!parseFraming(raw.substr(0, headerEnd), limit)) {
+			return -1;
+		}
+	}
+
+	long end = 0;
+	if (framing == HTTPFraming::Bodiless) {
+		end = bodyStart;
+	}
+	else if (framing == HTTPFraming::Length) {
+		end = bodyEnd <= curPos ? bodyEnd : 0;
+	}
+	else if (framing == HTTPFraming::Chunked) {
+		end = walkChunks(buf, chunkPos, curPos, nullptr, chunkPayload);
+		if (end < 0) {
+			return -1;
+		}
+	}
+	// UntilClose: endOfStream() finishes it
+
+	if (end == 0) {
+		return (size_t)curPos > limit ? -1 : 0;
+	}
+	if ((size_t)end > limit) {
+		return -1;
+	}
+
+	msgEnd = (int)end;
+	msgLen = msgEnd;
+	if (framing == HTTPFraming::Chunked) {
+		// pack the chunk data together right after the headers
+		long pos = bodyStart;
+		long payload = 0;
+		walkChunks(buf, pos, curPos, buf + bodyStart, payload);
+		msgLen = (int)(bodyStart + payload);
+	}
+	// terminate unless that would clobber the next response
+	if (msgLen < msgEnd || msgEnd == curPos) {
+		buf[msgLen] = '\0';
+	}
+	if (!pendingHead.empty()) {
+		pendingHead.pop_front();
+	}
+	answered = true;
+	return 1;
+}
+
+bool Socket::endOfStream() {
+	reusable = false;
+	if (msgLen > 0) {
+		return true;  // already whole by its framing, and the close came with it
+	}
+
+	// a Content-Length or chunked body, or headers, cut short are a failed fetch,
+	// as is a kept-alive connection the server dropped before answering
+	if (framing != HTTPFraming::UntilClose && !(framing == HTTPFraming::Headers && curPos == 0 && !answered)) {
+		return false;
+	}
+	msgLen = curPos;
+	msgEnd = curPos;
+	answered = true;
+	if (!pendingHead.empty()) {
+		pendingHead.pop_front();
+	}
+	return true;
+}
+
+bool Socket::receiveResponse(HTTPResponse& response, const size_t& limit) {
+	resetResponse();
 
 	if (!Read(limit)) {
 		// error output is handled in all False branches of Read()
 		return false;
 	}
 
-	response = std::string(buf, curPos);
-	statusCode = 0;
+	parseResponse(response);
+	return true;
+}
+
+void Socket::parseResponse(HTTPResponse& response) {
+	std::string_view raw(buf, msgLen > 0 ? msgLen : curPos);
+	response.raw = raw;
+	response.statusCode = 0;
 
-	// extract status code from response
-	size_t pos = response.find(" ");
-	if (pos != std::string::npos) {
-		size_t endPos = response.find(" ", pos + 1);
-		if (endPos != std::string::npos) {
-			statusCode = std::stoi(response.substr(pos + 1, endPos - pos - 1));
-		}
+	// extract status code from the status line, "HTTP/1.x NNN reason"
+	size_t lineEnd = raw.find('\n');
+	size_t pos = raw.find(' ');
+	if (pos != std::string_view::npos && pos < lineEnd) {
+		response.statusCode = atoi(buf + pos + 1);
+	}
+
+	size_t headerEnd = raw.find("\r\n\r\n");
+	if (headerEnd == std::string_view::npos) {
+		response.headers = raw;
+		response.body = std::string_view();
+	}
+	else {
+		response.headers = raw.substr(0, headerEnd);
+		response.body = raw.substr(headerEnd + 4);
 	}
 
-	//printf("\n\n%s\n\nStatus Code Var: %i\n\n", response.c_str(), statusCode);
+	//printf("\n\n%s\n\nStatus Code Var: %i\n\n", buf, response.statusCode);
+}
+
+bool Socket::isWouldBlock(int err) {
+#ifdef _WIN32
+	return err == WSAEWOULDBLOCK;
+#else
+	return err == EAGAIN || err == EWOULDBLOCK;
+#endif
+}
+
+#ifdef __linux__
+bool Socket::enableUring() {
+	if (ring) {
+		return true;
+	}
+	ring = new IoUring;
+	if (!ring->init(URING_ENTRIES, URING_BUFFERS, URING_BUFFER_SIZE)) {
+		delete ring;
+		ring = nullptr;
+		return false;
+	}
 	return true;
-}
\ No newline at end of file
+}
+
+uint64_t Socket::uringTag(int op) const {
+	return (generation << 4) | (uint64_t)op;
+}
+
+bool Socket::uringConnect(int port) {
+	if (!openSocket()) {
+		return false;
+	}
+	generation++;
+
+	peer.sin_family = AF_INET;
+	peer.sin_port = htons(port);
+	peer.sin_addr = sin_addr;
+
+	// queued only; submitted together with the send and recv it is linked to
+	io_uring_sqe* sqe = ring->getSqe();
+	if (!sqe) {
+		return false;
+	}
+	sqe->opcode = IORING_OP_CONNECT;
+	sqe->fd = sock;
+	sqe->addr = (uint64_t)(uintptr_t)&peer;
+	sqe->off = sizeof(peer);
+	sqe->flags = IOSQE_IO_LINK;
+	sqe->user_data = uringTag(URING_OP_CONNECT);
+	inflight++;
+	return true;
+}
+
+bool Socket::uringSend(const std::string& host, const std::string& request, const std::string& method) {
+	queueHTTPRequest(host, request, method);
+
+	io_uring_sqe* sqe = ring->getSqe();
+	if (!sqe) {
+		return false;
+	}
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = sock;
+	sqe->addr = (uint64_t)(uintptr_t)(outBuf.data() + outPos);
+	sqe->len = (uint32_t)(outBuf.length() - outPos);
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->flags = IOSQE_IO_LINK;
+	sqe->user_data = uringTag(URING_OP_SEND);
+	inflight++;
+	return true;
+}
+
+bool Socket::uringArmRecv() {
+	io_uring_sqe* sqe = ring->getSqe();
+	if (!sqe) {
+		return false;
+	}
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = sock;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = ring->bufferGroup();
+	sqe->user_data = uringTag(URING_OP_RECV);
+	inflight++;
+	return true;
+}
+
+bool Socket::uringAppend(uint16_t bid, int bytes) {
+	// keep room for the null terminator
+	while (allocatedSize - curPos - 1 < bytes) {
+		if (!resizeBuffer()) {
+			ring->recycleBuffer(bid);
+			return false;
+		}
+	}
+	memcpy(buf + curPos, ring->buffer(bid), bytes);
+	curPos += bytes;
+	ring->recycleBuffer(bid);
+	return true;
+}
+
+bool Socket::uringRead(const size_t& limit) {
+	// a pipelined response may already be buffered in full
+	int framed = frameResponse(limit);
+	if (framed != 0) {
+		uringCancel();
+		return framed > 0;
+	}
+
+	// one multishot recv keeps delivering segments until EOF or the buffers run dry
+	if (!uringArmRecv()) {
+		uringCancel();
+		return false;
+	}
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	bool failed = false;
+	bool done = false;
+	bool framedDone = false;
+
+	while (true) {
+		io_uring_cqe* cqe;
+		while ((cqe = ring->peekCqe()) != nullptr) {
+			uint64_t tag = cqe->user_data;
+			int res = cqe->res;
+			unsigned flags = cqe->flags;
+			ring->seenCqe();
+
+			bool hasBuffer = (flags & IORING_CQE_F_BUFFER) != 0;
+			uint16_t bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+			int op = (int)(tag & 0xF);
+
+			if ((tag >> 4) != generation) {
+				// left over from an earlier request
+				if (hasBuffer) {
+					ring->recycleBuffer(bid);
+				}
+				continue;
+			}
+			if (op != URING_OP_RECV || !(flags & IORING_CQE_F_MORE)) {
+				inflight--;
+			}
+
+			if (op == URING_OP_CONNECT || op == URING_OP_SEND) {
+				if (res < 0) {
+					failed = true;
+				}
+				else if (op == URING_OP_SEND && (outPos += res) < outBuf.length()) {
+					// short send; queue the remainder on its own
+					io_uring_sqe* sqe = ring->getSqe();
+					if (!sqe) {
+						failed = true;
+						continue;
+					}
+					sqe->opcode = IORING_OP_SEND;
+					sqe->fd = sock;
+					sqe->addr = (uint64_t)(uintptr_t)(outBuf.data() + outPos);
+					sqe->len = (uint32_t)(outBuf.length() - outPos);
+					sqe->msg_flags = MSG_NOSIGNAL;
+					sqe->user_data = uringTag(URING_OP_SEND);
+					inflight++;
+				}
+			}
+			else if (op == URING_OP_RECV) {
+				if (res > 0 && hasBuffer) {
+					if (!uringAppend(bid, res)) {
+						failed = true;
+					}
+					else {
+						// cancel the recv once the response is whole instead of waiting for EOF
+						framed = frameResponse(limit);
+						if (framed < 0) {
+							// printf("failed with exceeding max\n");
+							failed = true;
+						}
+						else if (framed > 0) {
+							framedDone = true;
+						}
+					}
+
+					// multishot ends early when it runs out of buffers; re-arm
+					if (!(flags & IORING_CQE_F_MORE) && !failed && !framedDone && !uringArmRecv()) {
+						failed = true;
+					}
+				}
+				else if (res == 0) {
+					done = true;
+				}
+				else if (res == -ENOBUFS) {
+					if (!uringArmRecv()) {
+						failed = true;
+					}
+				}
+				else {
+					failed = true;
+				}
+			}
+		}
+
+		if (failed) {
+			uringCancel();
+			return false;
+		}
+		if (done) {
+			buf[curPos] = '\0'; // NULL-terminate buffer
+			return endOfStream();
+		}
+		if (framedDone) {
+			// anything the recv still delivers before the cancel lands is kept for the next response
+			uringCancel();
+			return true;
+		}
+
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		if (remaining <= 0) {
+			// printf("failed with slow download\n");
+			uringCancel();
+			return false;
+		}
+
+		int ret = ring->submitAndWait(1, (int)remaining);
+		if (ret < 0 && ret != -ETIME) {
+			uringCancel();
+			return false;
+		}
+	}
+}
+
+void Socket::uringCancel() {
+	if (inflight <= 0) {
+		inflight = 0;
+		return;
+	}
+
+	// cancel everything still pending on this descriptor and reap it so the
+	// kernel is done with peer/outBuf before they are reused
+	io_uring_sqe* sqe = ring->getSqe();
+	if (sqe) {
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = sock;
+		sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+		sqe->user_data = uringTag(URING_OP_CANCEL);
+		inflight++;
+	}
+	else if (sock != INVALID_SOCKET) {
+		shutdown(sock, SHUT_RDWR);
+	}
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	ring->submitAndWait(0, 0);
+	while (inflight > 0) {
+		io_uring_cqe* cqe;
+		while ((cqe = ring->peekCqe()) != nullptr) {
+			uint64_t tag = cqe->user_data;
+			int res = cqe->res;
+			unsigned flags = cqe->flags;
+			ring->seenCqe();
+
+			bool current = (tag >> 4) == generation;
+			if (flags & IORING_CQE_F_BUFFER) {
+				uint16_t bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+				if (current && (tag & 0xF) == URING_OP_RECV && res > 0) {
+					// stream data, possibly the start of a pipelined response
+					uringAppend(bid, res);
+				}
+				else {
+					ring->recycleBuffer(bid);
+				}
+			}
+			if (current && ((tag & 0xF) != URING_OP_RECV || !(flags & IORING_CQE_F_MORE))) {
+				inflight--;
+			}
+		}
+		if (inflight <= 0 || std::chrono::steady_clock::now() > deadline) {
+			break;
+		}
+		ring->submitAndWait(1, 100);
+	}
+
+	// anything still outstanding is ignored by its stale generation tag
+	inflight = 0;
+	generation++;
+}
+#endif
@@ -1,39 +1,167 @@
 #ifndef SOCKET_H
 #define SOCKET_H
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <winsock2.h>
 #include <ws2tcpip.h>
-#include <string>
 
 #pragma comment(lib, "Ws2_32.lib")
 
+#define MSG_NOSIGNAL 0
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+
+// map the WinSock names used throughout the crawler onto BSD sockets
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+
+inline int closesocket(SOCKET s) { return ::close(s); }
+inline int WSAGetLastError() { return errno; }
+#endif
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <cstdint>
+
+class DNSResolver;
+class DNSCache;
+enum class DNSStatus;
+#ifdef __linux__
+class IoUring;
+#endif
+
+// how the end of the response being read is found
+enum class HTTPFraming {
+    Headers,     // still looking for the blank line
+    Bodiless,    // HEAD, 1xx, 204 and 304: the headers are all of it
+    Length,      // Content-Length
+    Chunked,     // up to the last chunk and its trailer
+    UntilClose   // neither, so the peer closing ends it
+};
+
+// a received response as views into the socket's own buffer; valid until the
+// socket reads or resets again, and never copied on the way to the parser
+struct HTTPResponse {
+    std::string_view raw;      // everything received
+    std::string_view headers;  // status line and header fields, without the blank line
+    std::string_view body;     // after the blank line; empty if there is none
+    int statusCode = 0;
+};
+
 class Socket {
 private:
     SOCKET sock;          // socket handle
     char* buf;            // current buffer
     int allocatedSize;    // bytes allocated for buf
     int curPos;           // current position in buffer
-    std::string ipAddr;   // ip addr of host
     in_addr sin_addr;     // ip addr of host
+    bool wouldBlock;      // last recv found no data on a non-blocking socket
+    std::string outBuf;   // queued requests, sent back to back
+    size_t outPos;        // bytes of outBuf already sent
+    bool keepAlive;       // HTTP/1.1 requests that leave the connection open
+    bool reusable;        // the last response left the connection open
+    bool answered;        // a response has already come over this connection
+    int msgLen;           // length of the finished response in buf after dechunking, 0 while reading
+    int msgEnd;           // where the next pipelined response starts in buf
+    HTTPFraming framing;  // how the response being read ends
+    int scanned;          // bytes already searched for the end of the headers
+    int bodyStart;        // just past the blank line once the headers are in
+    long bodyEnd;         // with Content-Length framing
+    long chunkPos;        // next chunk size line not yet walked
+    long chunkPayload;    // chunk data bytes walked so far
+    std::deque<bool> pendingHead;  // per request still unanswered: was it a HEAD
+    DNSResolver* resolver; // async resolver to use instead of getaddrinfo, not owned
+    DNSCache* cache;       // shared answers consulted before resolving, not owned
+#ifdef __linux__
+    IoUring* ring;        // set when connect/send/Read go through io_uring
+    sockaddr_in peer;     // must outlive the queued connect
+    uint64_t generation;  // tags completions so stale ones from an earlier request are dropped
+    int inflight;         // submitted requests whose final completion is not yet reaped
+#endif
 
 public:
     Socket();
     ~Socket();
 
-    // read data from the socket with a timeout and dynamic buffer resizing
+    // read data from the socket with a timeout and dynamic buffer resizing, until the
+    // response is whole by its framing (Content-Length, chunks, or none for HEAD) or the peer closes
     bool Read(const size_t& limit);
 
     void close();
     bool resolveDNS(const std::string& host);
+    void setResolvedAddress(in_addr addr);
+    void setResolver(DNSResolver* dnsResolver);
+    void setCache(DNSCache* dnsCache);
     in_addr getResolvedAddress() const;
     bool connect(const std::string& host, int port);
     bool sendHTTPRequest(const std::string& host, const std::string& request, std::string method);
-    bool receiveResponse(std::string& response, int& statusCode, const size_t& limit);
+    bool receiveResponse(HTTPResponse& response, const size_t& limit);
+
+    // send HTTP/1.1 keep-alive requests so the connection can carry the next request
+    void setKeepAlive(bool enabled);
+    bool canReuse() const;  // the last response left the connection open
+
+    // route connect, sendHTTPRequest and Read through a per-socket io_uring that
+    // links connect -> send -> multishot recv into one submission; false if unsupported.
+    // the ring serves this one connection and still waits in io_uring_enter, so it
+    // batches nothing across connections and is no cheaper than blocking I/O
+    bool enableUring();
+
+    // non-blocking interface for event-driven engines; the caller waits for readiness
+    SOCKET getHandle() const;
+    bool startConnect(int port);        // true if connected or in progress
+    bool finishConnect();               // result of a connect once writable
+    // requests queued before the next send go out together, i.e. pipelined
+    void queueHTTPRequest(const std::string& host, const std::string& request, const std::string& method);
+    int flushRequest();                 // 1 sent, 0 would block, -1 error
+    void resetResponse();  // keeps bytes already received for the next pipelined response
+    int readSome(const size_t& limit);  // 1 complete, 0 would block, -1 error
+    void parseResponse(HTTPResponse& response);
+
+    // the exact bytes sendHTTPRequest sends, e.g. for archiving the request
+    static std::string buildHTTPRequest(const std::string& host, const std::string& request, const std::string& method, bool keepAlive);
 
 private:
     // helper to resize buffer if needed
     bool resizeBuffer();
+
+    // wait until the socket is readable; >0 ready, 0 timeout, <0 error
+    int waitReadable(int timeoutMs);
+
+    // one recv into buf; 1 peer closed, 0 more to come, -1 error
+    int recvSegment();
+
+    // frame the response at the start of buf, resuming where the last call stopped;
+    // 1 complete, 0 more to come, -1 malformed or over limit
+    int frameResponse(const size_t& limit);
+    bool parseFraming(std::string_view headers, const size_t& limit);  // false if malformed or over limit
+    // the peer closed: true if that ends the response, i.e. it is framed by the close,
+    // or a fresh connection was closed without a byte; false if it was cut short
+    bool endOfStream();
+    void resetFraming();
+
+    bool openSocket();
+    static DNSStatus resolveSystem(const std::string& host, in_addr& addr);
+    static bool isWouldBlock(int err);
+
+#ifdef __linux__
+    bool uringConnect(int port);
+    bool uringSend(const std::string& host, const std::string& request, const std::string& method);
+    bool uringRead(const size_t& limit);
+    bool uringArmRecv();
+    bool uringAppend(uint16_t bid, int bytes);
+    void uringCancel();
+    uint64_t uringTag(int op) const;
+#endif
 };
 
 #endif // SOCKET_H
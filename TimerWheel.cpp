@@ -0,0 +1,167 @@
+#include "TimerWheel.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define SLOTS (1 << TIMER_WHEEL_BITS)
+#define SLOT_MASK (SLOTS - 1)
+#define MAX_DELTA ((uint64_t(1) << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+static int lowestBit(uint64_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+TimerWheel::TimerWheel(uint64_t now) : occupied(), current(now), count(0) {
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int i = 0; i < SLOTS; i++) {
+            slots[level][i].prev = &slots[level][i];
+            slots[level][i].next = &slots[level][i];
+        }
+    }
+}
+
+void TimerWheel::schedule(TimerNode* node, uint64_t expires) {
+    if (node->pending()) {
+        unlink(node);
+        count--;
+    }
+
+    // the current tick's slot was already swept, and anything past the top level waits in it
+    if (expires <= current) {
+        expires = current + 1;
+    }
+    else if (expires - current > MAX_DELTA) {
+        expires = current + MAX_DELTA;
+    }
+    node->expires = expires;
+    place(node);
+    count++;
+}
+
+void TimerWheel::cancel(TimerNode* node) {
+    if (node->pending()) {
+        unlink(node);
+        count--;
+    }
+}
+
+void TimerWheel::place(TimerNode* node) {
+    // the level is picked by distance, the slot by the absolute expiry bits at that level,
+    // so a slot comes round exactly when its block of ticks starts
+    uint64_t delta = node->expires - current;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (uint64_t(1) << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    TimerNode* head = &slots[level][(node->expires >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK];
+
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+    if (level == 0) {
+        size_t index = head - slots[0];
+        occupied[index / 64] |= uint64_t(1) << (index % 64);
+    }
+}
+
+void TimerWheel::cascade(int level, size_t index) {
+    TimerNode* head = &slots[level][index];
+    TimerNode* node = head->next;
+    head->prev = head;
+    head->next = head;
+
+    // everything here expires within the block that starts now, so it lands lower down
+    while (node != head) {
+        TimerNode* next = node->next;
+        place(node);
+        node = next;
+    }
+}
+
+void TimerWheel::advance(uint64_t now, std::vector<TimerNode*>& expired) {
+    while (current < now) {
+        // an empty wheel has nothing to cascade, so skip the idle stretch
+        if (count == 0) {
+            current = now;
+            return;
+        }
+
+        // jump to the next occupied slot in this block, or to the block's end
+        uint64_t blockStart = current & ~uint64_t(SLOT_MASK);
+        int slot = (current & SLOT_MASK) == SLOT_MASK ? -1 : firstOccupied((int)(current & SLOT_MASK) + 1);
+        uint64_t next = slot >= 0 ? blockStart + slot : blockStart + SLOTS;
+        if (next > now) {
+            current = now;
+            return;
+        }
+        current = next;
+
+        // entering a new block at level 0 pulls the matching slot down from level 1,
+        // and so on up while the higher indexes wrap too
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if ((current & ((uint64_t(1) << (TIMER_WHEEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(level, (current >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK);
+        }
+
+        TimerNode* head = &slots[0][current & SLOT_MASK];
+        while (head->next != head) {
+            TimerNode* node = head->next;
+            unlink(node);
+            count--;
+            expired.push_back(node);
+        }
+    }
+}
+
+uint64_t TimerWheel::nextExpiry() const {
+    if (count == 0) {
+        return UINT64_MAX;
+    }
+
+    // level 0 is exact up to the end of the current block; past it a higher level
+    // may cascade something earlier, so the block boundary is the bound
+    uint64_t blockStart = current & ~uint64_t(SLOT_MASK);
+    int slot = (current & SLOT_MASK) == SLOT_MASK ? -1 : firstOccupied((int)(current & SLOT_MASK) + 1);
+    return slot >= 0 ? blockStart + slot : blockStart + SLOTS;
+}
+
+int TimerWheel::firstOccupied(int from) const {
+    for (int word = from / 64; word < SLOTS / 64; word++) {
+        uint64_t bits = occupied[word];
+        if (word == from / 64) {
+            bits &= ~uint64_t(0) << (from % 64);
+        }
+        if (bits != 0) {
+            return word * 64 + lowestBit(bits);
+        }
+    }
+    return -1;
+}
+
+size_t TimerWheel::size() const {
+    return count;
+}
+
+void TimerWheel::unlink(TimerNode* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+
+    // prev == next only once the list is down to its sentinel
+    TimerNode* level0 = slots[0];
+    if (node->prev == node->next && node->prev >= level0 && node->prev < level0 + SLOTS) {
+        size_t index = node->prev - level0;
+        occupied[index / 64] &= ~(uint64_t(1) << (index % 64));
+    }
+    node->prev = nullptr;
+    node->next = nullptr;
+}
@@ -0,0 +1,63 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#define TIMER_WHEEL_BITS 8    // 256 slots per level
+#define TIMER_WHEEL_LEVELS 4  // 2^32 ticks of range
+
+// a timer lives inside whatever it times, so scheduling never allocates
+struct TimerNode {
+    TimerNode* prev = nullptr;
+    TimerNode* next = nullptr;
+    uint64_t expires = 0;
+    void* data = nullptr;
+
+    bool pending() const { return prev != nullptr; }
+};
+
+// hierarchical timer wheel: level 0 holds the next 256 ticks one slot each, and
+// every level above covers 256 times the span of the one below. schedule() and
+// cancel() are O(1); advance() visits only level-0 slots that hold timers and the
+// block boundaries, where a cascade moves a higher slot's timers down as the wheel
+// comes round to them. not thread safe, the owner locks
+class TimerWheel {
+    public:
+        explicit TimerWheel(uint64_t now = 0);
+
+        // fire at tick expires, or on the next tick if that is already past
+        void schedule(TimerNode* node, uint64_t expires);
+        void cancel(TimerNode* node);
+
+        // move time forward to now, appending every timer that came due
+        void advance(uint64_t now, std::vector<TimerNode*>& expired);
+
+        // earliest tick anything may fire at, never later than the real next expiry;
+        // UINT64_MAX when nothing is scheduled
+        uint64_t nextExpiry() const;
+
+        size_t size() const;
+
+    private:
+        // link into the slot matching expires relative to current
+        void place(TimerNode* node);
+        // re-place every timer in one slot of a higher level
+        void cascade(int level, size_t index);
+
+        // unlink, clearing the slot's occupied bit if it was the last timer there
+        void unlink(TimerNode* node);
+
+        // first slot at or after from at level 0 that holds a timer, -1 if none
+        int firstOccupied(int from) const;
+
+        // each slot is a circular list around a sentinel
+        TimerNode slots[TIMER_WHEEL_LEVELS][1 << TIMER_WHEEL_BITS];
+        // one bit per level-0 slot, so advance() and nextExpiry() skip empty stretches
+        uint64_t occupied[(1 << TIMER_WHEEL_BITS) / 64];
+        uint64_t current;  // last tick processed
+        size_t count;
+};
+
+#endif // TIMER_WHEEL_H
@@ -1,50 +1,153 @@
 #include "Utility.h"
 
-#include <regex>
-#include <iostream>
+#include <cstring>
 
-bool parseURL(const std::string& url, std::string& scheme, std::string& host, int& port, std::string& request) {
-    // port and path are marked as optional so the regex_match() is only checking for http://baseurl basically
-    std::regex urlRegex(R"(^([a-zA-Z][a-zA-Z0-9+.-]*)://([^/:]+)(?::(\d+))?(?:(/.*)?)?)");
-    std::smatch matches;
+static bool isAlpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
 
-    if (std::regex_match(url, matches, urlRegex)) {
-        if ((scheme = matches[1].str()) != "http") {
-            // printf("failed with invalid scheme\n");
-            return false;
-        }
-        host = matches[2].str();
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static char toLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+bool parseURL(std::string_view url, URLParts& parts) {
+    const char* p = url.data();
+    const char* end = p + url.size();
+
+    // scheme ":" "//", and only http is crawlable
+    const char* schemeStart = p;
+    if (p == end || !isAlpha(*p)) {
+        return false;
+    }
+    while (p < end && (isAlpha(*p) || isDigit(*p) || *p == '+' || *p == '-' || *p == '.')) {
+        p++;
+    }
+    parts.scheme = std::string_view(schemeStart, p - schemeStart);
+    if (end - p < 3 || p[0] != ':' || p[1] != '/' || p[2] != '/') {
+        return false;
+    }
+    if (parts.scheme.size() != 4 || toLower(schemeStart[0]) != 'h' || toLower(schemeStart[1]) != 't' ||
+        toLower(schemeStart[2]) != 't' || toLower(schemeStart[3]) != 'p') {
+        return false;
+    }
+    p += 3;
 
-        // extract the port if one exists
-        // default to 80 otherwise
-        if (matches[3].matched) {
-            std::string portStr = matches[3].str();
+    // the authority runs to the first '/', '?' or '#'; userinfo ends at its last '@'
+    const char* authority = p;
+    const char* at = nullptr;
+    while (p < end && *p != '/' && *p != '?' && *p != '#') {
+        if (*p == '@') {
+            at = p;
+        }
+        p++;
+    }
+    const char* authorityEnd = p;
+    parts.userinfo = at ? std::string_view(authority, at - authority) : std::string_view();
+    const char* hostStart = at ? at + 1 : authority;
 
-            try {
-                // will go to catch block if there are no numbers
-                port = std::stoi(portStr);
+    // host, bracketed for IPv6 literals
+    const char* hostEnd;
+    const char* portStart;
+    if (hostStart < authorityEnd && *hostStart == '[') {
+        const char* close = (const char*)memchr(hostStart, ']', authorityEnd - hostStart);
+        if (!close) {
+            return false;
+        }
+        hostEnd = close;
+        hostStart++;
+        portStart = close + 1;
+        if (portStart < authorityEnd && *portStart != ':') {
+            return false;
+        }
+    }
+    else {
+        hostEnd = hostStart;
+        while (hostEnd < authorityEnd && *hostEnd != ':') {
+            hostEnd++;
+        }
+        portStart = hostEnd;
+    }
+    size_t hostLen = hostEnd - hostStart;
+    if (hostLen == 0 || hostLen >= URL_MAX_HOST) {
+        return false;
+    }
 
-                // check if port is invalid (0 or not in valid range)
-                if (port <= 0 || port > 65535) {
-                    // printf("failed with invalid port\n");
-                    return false;
-                }
+    // lowercase into the buffer only if there is something to lowercase
+    parts.host = std::string_view(hostStart, hostLen);
+    for (size_t i = 0; i < hostLen; i++) {
+        if (hostStart[i] >= 'A' && hostStart[i] <= 'Z') {
+            for (size_t j = 0; j < hostLen; j++) {
+                parts.hostBuffer[j] = toLower(hostStart[j]);
             }
-            catch (const std::invalid_argument& e) {
-                // printf("failed with invalid port\n");
+            parts.host = std::string_view(parts.hostBuffer, hostLen);
+            break;
+        }
+    }
+
+    // optional port: 1 to 5 digits in 1..65535
+    parts.port = 80;
+    if (portStart < authorityEnd) {
+        const char* digits = portStart + 1;
+        size_t numDigits = authorityEnd - digits;
+        if (numDigits == 0 || numDigits > 5) {
+            return false;
+        }
+        int port = 0;
+        for (const char* d = digits; d < authorityEnd; d++) {
+            if (!isDigit(*d)) {
                 return false;
             }
+            port = port * 10 + (*d - '0');
         }
-        else {
-            port = 80;
+        if (port <= 0 || port > 65535) {
+            return false;
         }
+        parts.port = port;
+    }
 
-        //path default to /
-        request = matches[4].length() > 0 ? matches[4].str() : "/";
-        return true;
+    // path, then "?query", then "#fragment"
+    const char* pathStart = p;
+    while (p < end && *p != '?' && *p != '#') {
+        p++;
     }
+    const char* pathEnd = p;
+    const char* queryStart = nullptr;
+    if (p < end && *p == '?') {
+        queryStart = ++p;
+        while (p < end && *p != '#') {
+            p++;
+        }
+        parts.query = std::string_view(queryStart, p - queryStart);
+    }
+    else {
+        parts.query = std::string_view();
+    }
+    const char* requestEnd = p;
+    parts.fragment = p < end ? std::string_view(p + 1, end - p - 1) : std::string_view();
 
-    //uh oh
-    // printf("failed with invalid URL\n");
-    return false;
+    if (pathStart < pathEnd) {
+        parts.path = std::string_view(pathStart, pathEnd - pathStart);
+        parts.request = std::string_view(pathStart, requestEnd - pathStart);
+    }
+    else {
+        // no path: the request line still needs its leading '/'
+        parts.path = std::string_view("/", 1);
+        if (!queryStart) {
+            parts.request = parts.path;
+        }
+        else {
+            size_t requestLen = 1 + (requestEnd - pathEnd);
+            if (requestLen > URL_MAX_REQUEST) {
+                return false;
+            }
+            parts.requestBuffer[0] = '/';
+            memcpy(parts.requestBuffer + 1, pathEnd, requestEnd - pathEnd);
+            parts.request = std::string_view(parts.requestBuffer, requestLen);
+        }
+    }
+    return true;
 }
@@ -9,7 +9,33 @@
 #define UTILITY_H
 
 #include <string>
+#include <string_view>
 
-bool parseURL(const std::string& url, std::string& scheme, std::string& host, int& port, std::string& request);
+#define URL_MAX_HOST 256
+#define URL_MAX_REQUEST 2048
+
+// components of a parsed URL as views into the URL itself. host is lowercased
+// and request gets its leading '/' in the internal buffers only when the URL
+// needs it, so the views stay valid only as long as both the URL and this struct
+struct URLParts {
+    std::string_view scheme;
+    std::string_view userinfo;  // before '@', empty if absent
+    std::string_view host;      // lowercased, IPv6 literals without their brackets
+    int port = 80;
+    std::string_view path;      // "/" if the URL has none
+    std::string_view query;     // after '?', without it
+    std::string_view fragment;  // after '#', without it
+    std::string_view request;   // path and query as they go on the request line
+
+    URLParts() = default;
+    URLParts(const URLParts&) = delete;  // the views may point into the buffers below
+    URLParts& operator=(const URLParts&) = delete;
+
+    char hostBuffer[URL_MAX_HOST];
+    char requestBuffer[URL_MAX_REQUEST];
+};
+
+// single pass over an absolute http:// URL, never allocating; false if it is not one
+bool parseURL(std::string_view url, URLParts& parts);
 
 #endif // UTILITY_H
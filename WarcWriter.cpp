@@ -0,0 +1,343 @@
+#include "WarcWriter.h"
+
+#include <cctype>
+#include <cstring>
+#include <ctime>
+
+#ifdef WINCRAWL_HAVE_ZLIB
+#include <zlib.h>
+#define WARC_EXTENSION ".warc.gz"
+#else
+#define WARC_EXTENSION ".warc"
+#endif
+
+#define WARC_BATCH_FETCHES 256  // drained per write
+#define WARC_IDLE_MS 10         // writer sleep while the queue is empty
+#define WARC_GZIP_LEVEL 1       // one thread compresses for every worker, so favor speed
+
+static bool utcTime(time_t t, tm& out) {
+#ifdef _WIN32
+    return gmtime_s(&out, &t) == 0;
+#else
+    return gmtime_r(&t, &out) != nullptr;
+#endif
+}
+
+// "2026-10-17T01:40:16.123456Z"; WARC 1.1 allows the fraction
+static std::string warcDate(std::chrono::system_clock::time_point when) {
+    long long micros = std::chrono::duration_cast<std::chrono::microseconds>(when.time_since_epoch()).count();
+    tm parts;
+    char text[40];
+    if (!utcTime((time_t)(micros / 1000000), parts)) {
+        return "1970-01-01T00:00:00Z";
+    }
+    size_t n = strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &parts);
+    snprintf(text + n, sizeof(text) - n, ".%06lldZ", micros % 1000000);
+    return text;
+}
+
+static bool startsWithNoCase(std::string_view text, const char* prefix) {
+    size_t n = strlen(prefix);
+    if (text.size() < n) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (tolower((unsigned char)text[i]) != prefix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the socket decodes chunked bodies in place, so such a response is archived with
+// its Transfer-Encoding renamed and the decoded length given, which keeps the
+// record parseable as it stands; anything else is kept byte for byte
+static std::string_view archivedResponse(std::string_view raw, std::string& rewritten) {
+    size_t headersEnd = raw.find("\r\n\r\n");
+    if (headersEnd == std::string_view::npos) {
+        return raw;
+    }
+    std::string_view headers = raw.substr(0, headersEnd + 2);
+    std::string_view body = raw.substr(headersEnd + 4);
+
+    bool chunked = false;
+    for (size_t pos = headers.find("\r\n"); pos != std::string_view::npos && pos + 2 < headers.size(); pos = headers.find("\r\n", pos + 2)) {
+        std::string_view line = headers.substr(pos + 2, headers.find("\r\n", pos + 2) - pos - 2);
+        if (startsWithNoCase(line, "transfer-encoding:") && line.find("chunked") != std::string_view::npos) {
+            chunked = true;
+        }
+    }
+    if (!chunked) {
+        return raw;
+    }
+
+    rewritten.clear();
+    size_t lineStart = 0;
+    while (lineStart < headers.size()) {
+        size_t lineEnd = headers.find("\r\n", lineStart);
+        std::string_view line = headers.substr(lineStart, lineEnd - lineStart);
+        if (startsWithNoCase(line, "transfer-encoding:")) {
+            rewritten += "X-Crawler-";
+        }
+        if (!startsWithNoCase(line, "content-length:")) {
+            rewritten.append(line.data(), line.size());
+            rewritten += "\r\n";
+        }
+        lineStart = lineEnd + 2;
+    }
+    rewritten += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    rewritten.append(body.data(), body.size());
+    return rewritten;
+}
+
+WarcWriter::WarcWriter(const std::string& prefix, long long maxFileBytes, size_t maxQueuedBytes, bool keepAlive)
+    : prefix(prefix), maxFileBytes(maxFileBytes), maxQueuedBytes(maxQueuedBytes), keepAlive(keepAlive), queuedBytes(0), stopping(false),
+      file(nullptr), fileBytes(0), batchFetches(0), writeFailed(false), stream(nullptr), fetches(0), dropped(0), files(0), bytesWritten(0) {
+    tm parts;
+    char stamp[20] = "00000000000000";
+    if (utcTime(time(nullptr), parts)) {
+        strftime(stamp, sizeof(stamp), "%Y%m%d%H%M%S", &parts);
+    }
+    startStamp = stamp;
+}
+
+WarcWriter::~WarcWriter() {
+    close();
+
+    // anything pushed after close() never reaches a file
+    while (Entry* entry = queue.pop()) {
+        delete entry;
+    }
+}
+
+bool WarcWriter::start() {
+#ifdef WINCRAWL_HAVE_ZLIB
+    stream = new z_stream();
+    // 16 + MAX_WBITS: gzip wrapper
+    if (deflateInit2(stream, WARC_GZIP_LEVEL, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        delete stream;
+        stream = nullptr;
+        return false;
+    }
+#endif
+    rng.seed(std::random_device()() ^ (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count());
+    if (!openFile()) {
+        return false;
+    }
+    thread = std::thread(&WarcWriter::Run, this);
+    return true;
+}
+
+bool WarcWriter::add(const std::string& host, int port, const std::string& path, in_addr addr, uint64_t fetchMicros, std::string_view response) {
+    // what the entry holds while queued; checked before copying anything
+    long long cost = (long long)(sizeof(Entry) + host.size() + path.size() + response.size());
+    if (queuedBytes.load(std::memory_order_relaxed) + cost > (long long)maxQueuedBytes) {
+        dropped++;
+        return false;
+    }
+    queuedBytes += cost;
+
+    Entry* entry = new Entry();
+    entry->host = host;
+    entry->port = port;
+    entry->path = path;
+    entry->addr = addr;
+    entry->fetched = std::chrono::system_clock::now();
+    entry->fetchMicros = fetchMicros;
+    entry->response.assign(response.data(), response.size());
+    queue.push(entry);
+    return true;
+}
+
+void WarcWriter::close() {
+    stopping = true;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+#ifdef WINCRAWL_HAVE_ZLIB
+    if (stream) {
+        deflateEnd(stream);
+        delete stream;
+        stream = nullptr;
+    }
+#endif
+}
+
+void WarcWriter::Run() {
+    while (true) {
+        // read before draining, so nothing queued ahead of close() is left behind
+        bool last = stopping.load();
+        writeBatch();
+        if (last) {
+            break;
+        }
+        if (queuedBytes.load(std::memory_order_relaxed) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(WARC_IDLE_MS));
+        }
+    }
+}
+
+void WarcWriter::writeBatch() {
+    while (true) {
+        int drained = 0;
+        Entry* entry;
+        while (drained < WARC_BATCH_FETCHES && (entry = queue.pop()) != nullptr) {
+            // a fetch never straddles two files
+            if (fileBytes + (long long)batch.size() >= maxFileBytes && (!flushBatch() || !openFile())) {
+                dropped++;
+            }
+            else {
+                formatFetch(*entry, batch);
+                batchFetches++;
+            }
+            queuedBytes -= (long long)(sizeof(Entry) + entry->host.size() + entry->path.size() + entry->response.size());
+            delete entry;
+            drained++;
+        }
+        flushBatch();
+        if (drained < WARC_BATCH_FETCHES) {
+            return;
+        }
+    }
+}
+
+std::string WarcWriter::recordId() {
+    // random (version 4) UUID
+    uint64_t high = rng(), low = rng();
+    high = (high & ~0xf000ull) | 0x4000ull;
+    low = (low & ~(3ull << 62)) | (2ull << 62);
+    char text[64];
+    snprintf(text, sizeof(text), "<urn:uuid:%08x-%04x-%04x-%04x-%012llx>", (unsigned)(high >> 32), (unsigned)((high >> 16) & 0xffff), (unsigned)(high & 0xffff),
+        (unsigned)(low >> 48), (unsigned long long)(low & 0xffffffffffffull));
+    return text;
+}
+
+void WarcWriter::appendRecord(const std::string& header, std::string_view block, std::string& out) {
+    std::string record = header + "Content-Length: " + std::to_string(block.size()) + "\r\n\r\n";
+    record.append(block.data(), block.size());
+    record += "\r\n\r\n";
+
+#ifdef WINCRAWL_HAVE_ZLIB
+    if (stream) {
+        deflateReset(stream);
+        size_t start = out.size();
+        out.resize(start + deflateBound(stream, (uLong)record.size()) + 32);
+        stream->next_in = (Bytef*)&record[0];
+        stream->avail_in = (uInt)record.size();
+        stream->next_out = (Bytef*)&out[start];
+        stream->avail_out = (uInt)(out.size() - start);
+        deflate(stream, Z_FINISH);
+        out.resize(out.size() - stream->avail_out);
+        return;
+    }
+#endif
+    out += record;
+}
+
+void WarcWriter::formatFetch(const Entry& entry, std::string& out) {
+    std::string url = "http://" + entry.host;
+    if (entry.port != 80) {
+        url += ":" + std::to_string(entry.port);
+    }
+    url += entry.path;
+
+    char ip[INET_ADDRSTRLEN] = "0.0.0.0";
+    inet_ntop(AF_INET, &entry.addr, ip, sizeof(ip));
+    std::string date = warcDate(entry.fetched);
+    std::string responseId = recordId();
+    std::string common = "WARC-Date: " + date + "\r\nWARC-Target-URI: " + url + "\r\nWARC-IP-Address: " + ip + "\r\n";
+
+    std::string rewritten;
+    appendRecord("WARC/1.1\r\nWARC-Type: response\r\nWARC-Record-ID: " + responseId + "\r\n" + common +
+        "Content-Type: application/http;msgtype=response\r\n", archivedResponse(entry.response, rewritten), out);
+
+    appendRecord("WARC/1.1\r\nWARC-Type: request\r\nWARC-Record-ID: " + recordId() + "\r\nWARC-Concurrent-To: " + responseId + "\r\n" + common +
+        "Content-Type: application/http;msgtype=request\r\n", Socket::buildHTTPRequest(entry.host, entry.path, "GET", keepAlive), out);
+
+    // request sent to response complete, as the crawler's page latency measures it
+    char fields[64];
+    snprintf(fields, sizeof(fields), "fetchTimeMs: %.3f\r\n", entry.fetchMicros / 1000.0);
+    appendRecord("WARC/1.1\r\nWARC-Type: metadata\r\nWARC-Record-ID: " + recordId() + "\r\nWARC-Concurrent-To: " + responseId + "\r\nWARC-Date: " + date +
+        "\r\nWARC-Target-URI: " + url + "\r\nContent-Type: application/warc-fields\r\n", fields, out);
+}
+
+bool WarcWriter::openFile() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    char number[16];
+    snprintf(number, sizeof(number), "%05ld", files.load());
+    std::string name = prefix + "-" + startStamp + "-" + number + WARC_EXTENSION;
+    file = fopen(name.c_str(), "wb");
+    if (!file) {
+        printf("Cannot create %s\n", name.c_str());
+        return false;
+    }
+    fileName = name;
+    fileBytes = 0;
+    files++;
+
+    // each file opens with a warcinfo record describing the crawl
+    size_t slash = name.find_last_of("/\\");
+    std::string baseName = slash == std::string::npos ? name : name.substr(slash + 1);
+    std::string info = "software: wincrawl\r\nformat: WARC File Format 1.1\r\nrobots: obey\r\n";
+    std::string header;
+    appendRecord("WARC/1.1\r\nWARC-Type: warcinfo\r\nWARC-Record-ID: " + recordId() + "\r\nWARC-Date: " + warcDate(std::chrono::system_clock::now()) +
+        "\r\nWARC-Filename: " + baseName + "\r\nContent-Type: application/warc-fields\r\n", info, header);
+    return flush(header);
+}
+
+bool WarcWriter::flush(std::string& out) {
+    if (out.empty()) {
+        return true;
+    }
+    bool ok = file && fwrite(out.data(), 1, out.size(), file) == out.size() && fflush(file) == 0;
+    if (ok) {
+        fileBytes += (long long)out.size();
+        bytesWritten += (long long)out.size();
+    }
+    out.clear();
+    return ok;
+}
+
+bool WarcWriter::flushBatch() {
+    long pending = batchFetches;
+    batchFetches = 0;
+    if (flush(batch)) {
+        fetches += pending;
+        return true;
+    }
+    dropped += pending;
+
+    // once, like openFile(); a file that could not be created was reported there
+    if (file && !writeFailed) {
+        printf("Cannot write to %s, dropping fetches from the archive\n", fileName.c_str());
+        writeFailed = true;
+    }
+    return false;
+}
+
+long WarcWriter::getFetches() const {
+    return fetches.load();
+}
+
+long WarcWriter::getDropped() const {
+    return dropped.load();
+}
+
+long WarcWriter::getFiles() const {
+    return files.load();
+}
+
+long long WarcWriter::getBytesWritten() const {
+    return bytesWritten.load();
+}
+
+long long WarcWriter::getQueuedBytes() const {
+    return queuedBytes.load();
+}
@@ -0,0 +1,98 @@
+#ifndef WARC_WRITER_H
+#define WARC_WRITER_H
+
+#include "Socket.h"
+#include "MPSCQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+
+struct z_stream_s;
+
+// archives fetched responses as WARC 1.1 files. a worker's add() copies the
+// response out of its socket buffer and pushes it onto a lock-free queue; one
+// writer thread drains the queue in batches, turns each fetch into request,
+// response and metadata records, gzips every record as its own member (when
+// built with zlib; plain .warc otherwise), and starts a new file past the size
+// limit. workers never wait on the disk: past the queue's byte budget a
+// response is dropped from the archive and counted instead
+class WarcWriter {
+    public:
+        // files are named prefix-<start time>-<n>.warc.gz
+        WarcWriter(const std::string& prefix, long long maxFileBytes, size_t maxQueuedBytes, bool keepAlive);
+        ~WarcWriter();
+
+        // open the first file and start the writer thread; false if it cannot be created
+        bool start();
+
+        // queue one fetch of http://host[:port]path from addr; any thread, never blocks.
+        // false if it was dropped for the queue being over budget
+        bool add(const std::string& host, int port, const std::string& path, in_addr addr, uint64_t fetchMicros, std::string_view response);
+
+        // write out everything queued, then stop the thread and close the file
+        void close();
+
+        long getFetches() const;    // archived so far
+        long getDropped() const;
+        long getFiles() const;
+        long long getBytesWritten() const;
+        long long getQueuedBytes() const;
+
+    private:
+        struct Entry {
+            std::atomic<Entry*> next;
+            std::string host;
+            int port;
+            std::string path;
+            in_addr addr;
+            std::chrono::system_clock::time_point fetched;
+            uint64_t fetchMicros;
+            std::string response;
+        };
+
+        void Run();
+        void writeBatch();
+
+        // append one fetch's records to out
+        void formatFetch(const Entry& entry, std::string& out);
+        void appendRecord(const std::string& header, std::string_view block, std::string& out);
+        std::string recordId();
+
+        bool openFile();
+        bool flush(std::string& out);
+        // flush batch and count its fetches as archived, or as dropped if the write fails
+        bool flushBatch();
+
+        std::string prefix;
+        std::string startStamp;
+        long long maxFileBytes;
+        size_t maxQueuedBytes;
+        bool keepAlive;
+
+        MPSCQueue<Entry> queue;
+        std::atomic<long long> queuedBytes;
+        std::atomic<bool> stopping;
+        std::thread thread;
+
+        // writer thread only
+        FILE* file;
+        std::string fileName;
+        long long fileBytes;
+        std::mt19937_64 rng;
+        std::string batch;  // compressed records waiting for one write
+        long batchFetches;  // fetches in batch, counted once it is written
+        bool writeFailed;   // a failed write was already reported
+        z_stream_s* stream; // reset per record, so every record is its own gzip member
+
+        std::atomic<long> fetches;
+        std::atomic<long> dropped;
+        std::atomic<long> files;
+        std::atomic<long long> bytesWritten;
+};
+
+#endif // WARC_WRITER_H
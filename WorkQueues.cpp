@@ -0,0 +1,131 @@
+#include "WorkQueues.h"
+
+WorkQueues::WorkQueues(int numWorkers, long capacity)
+    : numWorkers(numWorkers), deques(new Deque[numWorkers]), total(0), capacity(capacity),
+      idleWorkers(0), producerWaiting(false), closed(false) {
+}
+
+void WorkQueues::push(int worker, std::string url) {
+    Deque& deque = deques[worker];
+    {
+        std::lock_guard<std::mutex> lock(deque.lock);
+        deque.urls.push_back(std::move(url));
+    }
+    deque.size++;
+    total++;
+
+    // the count is already visible, so a worker checking it under waitLock cannot miss this
+    if (idleWorkers.load() > 0) {
+        std::lock_guard<std::mutex> lock(waitLock);
+        notEmpty.notify_all();
+    }
+}
+
+bool WorkQueues::pop(int worker, std::string& url) {
+    while (true) {
+        if (tryPop(worker, url)) {
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(waitLock);
+        if (closed && total.load() == 0) {
+            return false;
+        }
+        idleWorkers++;
+        notEmpty.wait(lock, [this] { return closed || total.load() > 0; });
+        idleWorkers--;
+    }
+}
+
+bool WorkQueues::tryPop(int worker, std::string& url) {
+    if (!take(worker, url)) {
+        return false;
+    }
+
+    // wake the producer once there is room again
+    if (producerWaiting.load()) {
+        std::lock_guard<std::mutex> lock(waitLock);
+        notFull.notify_one();
+    }
+    return true;
+}
+
+bool WorkQueues::take(int worker, std::string& url) {
+    Deque& deque = deques[worker];
+    if (deque.size.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(deque.lock);
+        if (!deque.urls.empty()) {
+            url = std::move(deque.urls.front());
+            deque.urls.pop_front();
+            deque.size--;
+            total--;
+            return true;
+        }
+    }
+    return steal(worker, url);
+}
+
+void WorkQueues::waitForRoom() {
+    if (total.load() < capacity) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(waitLock);
+    producerWaiting = true;
+    notFull.wait(lock, [this] { return total.load() < capacity; });
+    producerWaiting = false;
+}
+
+void WorkQueues::close() {
+    std::lock_guard<std::mutex> lock(waitLock);
+    closed = true;
+    notEmpty.notify_all();
+}
+
+bool WorkQueues::steal(int thief, std::string& url) {
+    std::vector<std::string> batch;
+
+    // scan the other workers in ring order so thieves spread over different victims
+    for (int i = 1; i < numWorkers; i++) {
+        Deque& victim = deques[(thief + i) % numWorkers];
+        if (victim.size.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(victim.lock);
+            size_t take = (victim.urls.size() + 1) / 2;
+            for (size_t j = 0; j < take; j++) {
+                batch.push_back(std::move(victim.urls.back()));
+                victim.urls.pop_back();
+            }
+            victim.size -= (long)take;
+        }
+        if (batch.empty()) {
+            continue; // drained between the size check and the lock
+        }
+
+        // keep one, move the rest into our own deque in their original order
+        url = std::move(batch.back());
+        batch.pop_back();
+        total--;
+
+        if (!batch.empty()) {
+            Deque& own = deques[thief];
+            std::lock_guard<std::mutex> lock(own.lock);
+            for (size_t j = batch.size(); j-- > 0; ) {
+                own.urls.push_back(std::move(batch[j]));
+            }
+            own.size += (long)batch.size();
+        }
+        return true;
+    }
+    return false;
+}
+
+long WorkQueues::size() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+int WorkQueues::getNumWorkers() const {
+    return numWorkers;
+}
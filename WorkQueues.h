@@ -0,0 +1,65 @@
+#ifndef WORK_QUEUES_H
+#define WORK_QUEUES_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+// per-worker URL deques with work stealing: a worker pops the front of its own
+// deque under its own lock, and only when that runs dry takes half of another
+// worker's backlog from the back, so workers rarely touch the same lock.
+// a producer fills them while workers drain them; it blocks in waitForRoom()
+// once capacity URLs are queued, and close() says nothing more is coming
+class WorkQueues {
+    public:
+        WorkQueues(int numWorkers, long capacity);
+
+        // append to the given worker's deque
+        void push(int worker, std::string url);
+
+        // next URL for worker, stealing if its own deque is empty and waiting for the
+        // producer if every deque is; false once they are all empty and closed
+        bool pop(int worker, std::string& url);
+
+        // pop without waiting, for event loops that have other work to do
+        bool tryPop(int worker, std::string& url);
+
+        // block the producer until fewer than capacity URLs are queued
+        void waitForRoom();
+        void close();
+
+        // approximate number of queued URLs, read without locking
+        long size() const;
+
+        int getNumWorkers() const;
+
+    private:
+        // one non-blocking attempt: own deque first, then steal
+        bool take(int worker, std::string& url);
+        bool steal(int thief, std::string& url);
+
+        struct alignas(64) Deque {
+            std::mutex lock;
+            std::deque<std::string> urls;
+            std::atomic<long> size{0};  // lets thieves skip empty deques without locking
+        };
+
+        int numWorkers;
+        std::unique_ptr<Deque[]> deques;
+        std::atomic<long> total;
+        long capacity;
+
+        // only idle workers and a blocked producer touch these
+        std::mutex waitLock;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        std::atomic<int> idleWorkers;
+        std::atomic<bool> producerWaiting;
+        bool closed;
+};
+
+#endif // WORK_QUEUES_H
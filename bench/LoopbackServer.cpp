@@ -0,0 +1,250 @@
+#include "LoopbackServer.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <deque>
+
+#define CHUNK_BYTES 4096
+
+struct ServerConnection {
+    int fd;
+    std::string request;                       // received, not yet answered
+    std::deque<const std::string*> responses;  // answers in request order
+    size_t sent;                               // bytes of responses.front() already sent
+    bool closeAfter;                           // the last request answered did not keep the connection
+    bool writing;                              // registered for EPOLLOUT
+};
+
+LoopbackServer::LoopbackServer(int numThreads, size_t pageBytes, bool chunked)
+    : numThreads(numThreads), listenFd(-1), port(0), stopFd(-1), lingerMs(0), accepted(0) {
+    std::string body(pageBytes, 'x');
+    if (pageBytes >= 64) {
+        // a few links so the page is worth parsing
+        const char* links = "<html><a href=\"/a\">a</a><a href=\"http://example.com/\">b</a>";
+        memcpy(&body[0], links, strlen(links));
+    }
+    pageResponse = "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\nContent-Length: " + std::to_string(pageBytes) + "\r\n\r\n" + body;
+    robotsResponse = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+    robotsResponse11 = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    if (!chunked) {
+        pageResponse11 = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: " + std::to_string(pageBytes) + "\r\n\r\n" + body;
+        return;
+    }
+    pageResponse11 = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nTransfer-Encoding: chunked\r\n\r\n";
+    char sizeLine[32];
+    for (size_t pos = 0; pos < body.size(); pos += CHUNK_BYTES) {
+        size_t n = body.size() - pos < CHUNK_BYTES ? body.size() - pos : CHUNK_BYTES;
+        snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", n);
+        pageResponse11 += sizeLine;
+        pageResponse11.append(body, pos, n);
+        pageResponse11 += "\r\n";
+    }
+    pageResponse11 += "0\r\n\r\n";
+}
+
+LoopbackServer::~LoopbackServer() {
+    stop();
+}
+
+void LoopbackServer::setLinger(int ms) {
+    lingerMs = ms;
+}
+
+bool LoopbackServer::start() {
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (listenFd < 0) {
+        return false;
+    }
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 4096) < 0) {
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listenFd, (sockaddr*)&addr, &len);
+    port = ntohs(addr.sin_port);
+
+    stopFd = eventfd(0, EFD_NONBLOCK);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back(&LoopbackServer::serve, this);
+    }
+    return true;
+}
+
+void LoopbackServer::stop() {
+    if (stopFd >= 0) {
+        uint64_t one = 1;
+        if (write(stopFd, &one, sizeof(one)) < 0) {
+            perror("eventfd write");
+        }
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    threads.clear();
+    if (listenFd >= 0) {
+        close(listenFd);
+        listenFd = -1;
+    }
+    if (stopFd >= 0) {
+        close(stopFd);
+        stopFd = -1;
+    }
+}
+
+int LoopbackServer::getPort() const {
+    return port;
+}
+
+long LoopbackServer::getAccepted() const {
+    return accepted.load();
+}
+
+void LoopbackServer::serve() {
+    int epfd = epoll_create1(0);
+
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.ptr = nullptr;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listenFd, &ev);
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = &stopFd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, stopFd, &ev);
+
+    epoll_event events[128];
+    char chunk[4096];
+    std::deque<std::pair<std::chrono::steady_clock::time_point, int>> lingering;  // due in order
+    bool running = true;
+
+    while (running) {
+        // wake up for the next lingering connection due to close
+        int waitMs = -1;
+        if (!lingering.empty()) {
+            auto due = std::chrono::duration_cast<std::chrono::milliseconds>(lingering.front().first - std::chrono::steady_clock::now()).count();
+            waitMs = due > 0 ? (int)due : 0;
+        }
+
+        int n = epoll_wait(epfd, events, 128, waitMs);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == &stopFd) {
+                running = false;
+                continue;
+            }
+
+            if (events[i].data.ptr == nullptr) {
+                // accept everything pending
+                while (true) {
+                    int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+                    if (fd < 0) {
+                        break;
+                    }
+                    accepted++;
+                    ServerConnection* conn = new ServerConnection{ fd, std::string(), {}, 0, false, false };
+                    epoll_event cev;
+                    cev.events = EPOLLIN;
+                    cev.data.ptr = conn;
+                    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &cev);
+                }
+                continue;
+            }
+
+            ServerConnection* conn = static_cast<ServerConnection*>(events[i].data.ptr);
+            bool closeIt = false;
+
+            if (!conn->closeAfter) {
+                ssize_t got;
+                while ((got = recv(conn->fd, chunk, sizeof(chunk), 0)) > 0) {
+                    conn->request.append(chunk, got);
+                }
+                if (got == 0 || (got < 0 && errno != EAGAIN)) {
+                    closeIt = true;
+                }
+            }
+
+            // answer every complete request, pipelined ones in order
+            size_t end;
+            while (!closeIt && !conn->closeAfter && (end = conn->request.find("\r\n\r\n")) != std::string::npos) {
+                std::string head = conn->request.substr(0, end);
+                bool robots = head.compare(0, 5, "HEAD ") == 0 || head.find("/robots.txt") != std::string::npos;
+                bool keepAlive = head.find(" HTTP/1.1\r\n") != std::string::npos && head.find("Connection: close") == std::string::npos;
+                if (keepAlive) {
+                    conn->responses.push_back(robots ? &robotsResponse11 : &pageResponse11);
+                }
+                else {
+                    conn->responses.push_back(robots ? &robotsResponse : &pageResponse);
+                    conn->closeAfter = true;
+                }
+                conn->request.erase(0, end + 4);
+            }
+
+            while (!closeIt && !conn->responses.empty()) {
+                const std::string* response = conn->responses.front();
+                ssize_t sent = send(conn->fd, response->data() + conn->sent, response->size() - conn->sent, MSG_NOSIGNAL);
+                if (sent < 0) {
+                    if (errno != EAGAIN) {
+                        closeIt = true;
+                    }
+                    break;
+                }
+                conn->sent += sent;
+                if (conn->sent == response->size()) {
+                    conn->responses.pop_front();
+                    conn->sent = 0;
+                }
+            }
+            if (conn->responses.empty() && conn->closeAfter) {
+                if (lingerMs > 0) {
+                    // answered in full, but the close comes only later
+                    epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, nullptr);
+                    lingering.emplace_back(std::chrono::steady_clock::now() + std::chrono::milliseconds(lingerMs), conn->fd);
+                    delete conn;
+                    continue;
+                }
+                closeIt = true;
+            }
+
+            // wait for room to send, or else for the next request
+            bool writing = !conn->responses.empty();
+            if (!closeIt && writing != conn->writing) {
+                epoll_event cev;
+                cev.events = writing ? EPOLLOUT : EPOLLIN;
+                cev.data.ptr = conn;
+                epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &cev);
+                conn->writing = writing;
+            }
+
+            if (closeIt) {
+                close(conn->fd);
+                delete conn;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        while (!lingering.empty() && lingering.front().first <= now) {
+            close(lingering.front().second);
+            lingering.pop_front();
+        }
+    }
+
+    for (auto& due : lingering) {
+        close(due.second);
+    }
+    close(epfd);
+}
@@ -0,0 +1,44 @@
+#ifndef LOOPBACK_SERVER_H
+#define LOOPBACK_SERVER_H
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+// minimal epoll HTTP server on 127.0.0.1 for benchmarks: answers every request
+// with the same canned response and closes the connection, except that HTTP/1.1
+// requests get keep-alive, pipelined requests included
+class LoopbackServer {
+    public:
+        // chunked: send HTTP/1.1 pages with chunked encoding instead of Content-Length
+        LoopbackServer(int numThreads, size_t pageBytes, bool chunked = false);
+        ~LoopbackServer();
+
+        // keep each connection open this long after its last response, like a lingering server
+        void setLinger(int ms);
+
+        // bind an ephemeral port and start serving; false on failure
+        bool start();
+        void stop();
+
+        int getPort() const;
+        long getAccepted() const;  // connections so far
+
+    private:
+        void serve();
+
+        int numThreads;
+        int listenFd;
+        int port;
+        int stopFd;  // eventfd that wakes every server thread on stop()
+        int lingerMs;
+        std::string pageResponse;
+        std::string robotsResponse;
+        std::string pageResponse11;
+        std::string robotsResponse11;
+        std::atomic<long> accepted;
+        std::vector<std::thread> threads;
+};
+
+#endif // LOOPBACK_SERVER_H
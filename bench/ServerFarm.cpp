@@ -0,0 +1,455 @@
+#include "ServerFarm.h"
+#include "StubDNSServer.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <deque>
+#include <queue>
+#include <unordered_map>
+
+#define CHUNK_BYTES 4096
+
+typedef std::chrono::steady_clock Clock;
+
+// a response queued on a connection, not yet sent in full
+struct FarmResponse {
+    const std::string* data;
+    const HostProfile* profile;
+    bool page;
+    Clock::time_point readyAt;  // nothing more of it goes out before then
+};
+
+struct FarmConnection {
+    int fd;
+    uint64_t id;
+    in_addr local;                        // the address the client dialed
+    std::string request;                  // received, not yet answered
+    std::deque<FarmResponse> responses;   // answers in request order
+    size_t sent;                          // bytes of responses.front() already sent
+    bool closeAfter;                      // the last request answered did not keep the connection
+    uint32_t events;                      // what the connection is registered for
+};
+
+static const char* reasonFor(int status) {
+    switch (status / 100) {
+    case 2: return "OK";
+    case 3: return "Moved";
+    case 4: return status == 404 ? "Not Found" : "Client Error";
+    default: return status == 503 ? "Service Unavailable" : "Server Error";
+    }
+}
+
+static std::string response(const char* version, int status, const std::string& body, bool chunked) {
+    std::string out = std::string(version) + " " + std::to_string(status) + " " + reasonFor(status) + "\r\nContent-Type: text/html\r\n";
+    if (!chunked) {
+        return out + "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+    out += "Transfer-Encoding: chunked\r\n\r\n";
+    char sizeLine[32];
+    for (size_t pos = 0; pos < body.size(); pos += CHUNK_BYTES) {
+        size_t n = body.size() - pos < CHUNK_BYTES ? body.size() - pos : CHUNK_BYTES;
+        snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", n);
+        out += sizeLine;
+        out.append(body, pos, n);
+        out += "\r\n";
+    }
+    return out + "0\r\n\r\n";
+}
+
+bool parseHostProfile(const std::string& spec, HostProfile& profile) {
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t comma = spec.find(',', pos);
+        std::string field = spec.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? spec.size() : comma + 1;
+
+        size_t eq = field.find('=');
+        std::string name = field.substr(0, eq);
+        const char* value = eq == std::string::npos ? "" : field.c_str() + eq + 1;
+        char* end = nullptr;
+        if (name == "latency") {
+            profile.latencyMs = (int)strtol(value, &end, 10);
+        }
+        else if (name == "page") {
+            profile.pageBytes = (size_t)strtoull(value, &end, 10);
+        }
+        else if (name == "status") {
+            profile.status = (int)strtol(value, &end, 10);
+            if (profile.status < 100 || profile.status > 999) {
+                return false;
+            }
+        }
+        else if (name == "links") {
+            profile.links = (int)strtol(value, &end, 10);
+        }
+        else if (name == "trickle") {
+            profile.trickleBytes = (size_t)strtoull(value, &end, 10);
+            if (*end != '/' || profile.trickleBytes == 0) {
+                return false;
+            }
+            const char* ms = end + 1;
+            profile.trickleMs = (int)strtol(ms, &end, 10);
+            if (end == ms) {
+                return false;
+            }
+        }
+        else if (name == "chunked" && eq == std::string::npos) {
+            profile.chunked = true;
+            continue;
+        }
+        else if (name == "robots") {
+            if (strcmp(value, "allow") == 0) {
+                profile.robots = RobotsBehavior::Allow;
+            }
+            else if (strcmp(value, "disallow") == 0) {
+                profile.robots = RobotsBehavior::Disallow;
+            }
+            else if (strcmp(value, "missing") == 0) {
+                profile.robots = RobotsBehavior::Missing;
+            }
+            else if (strcmp(value, "error") == 0) {
+                profile.robots = RobotsBehavior::Error;
+            }
+            else {
+                return false;
+            }
+            continue;
+        }
+        else {
+            return false;
+        }
+        if (end == value || *end != '\0') {
+            return false;
+        }
+    }
+    return profile.latencyMs >= 0 && profile.links >= 0 && profile.trickleMs >= 0;
+}
+
+std::string describeHostProfile(const HostProfile& profile) {
+    static const char* robots[] = { "allow", "disallow", "missing", "error" };
+    std::string text = "latency=" + std::to_string(profile.latencyMs) + ",page=" + std::to_string(profile.pageBytes) + ",status=" +
+        std::to_string(profile.status) + ",robots=" + robots[(int)profile.robots] + ",links=" + std::to_string(profile.links);
+    if (profile.chunked) {
+        text += ",chunked";
+    }
+    if (profile.trickleBytes > 0) {
+        text += ",trickle=" + std::to_string(profile.trickleBytes) + "/" + std::to_string(profile.trickleMs);
+    }
+    return text;
+}
+
+ServerFarm::ServerFarm(int numThreads, const std::vector<HostProfile>& profiles)
+    : numThreads(numThreads), listenFd(-1), port(0), stopFd(-1), profiles(profiles), accepted(0), pagesServed(0), robotsServed(0), bytesServed(0),
+      misdirected(0) {
+    if (this->profiles.empty()) {
+        this->profiles.push_back(HostProfile());
+    }
+
+    for (const HostProfile& profile : this->profiles) {
+        // links first, so even a short page has some, then padding up to the size
+        std::string body = "<html><head><title>farm</title></head><body>\n";
+        for (int i = 0; i < profile.links; i++) {
+            body += "<a href=\"/p" + std::to_string(i) + ".html\">page " + std::to_string(i) + "</a>\n";
+        }
+        std::string tail = "</body></html>\n";
+        if (body.size() + tail.size() < profile.pageBytes) {
+            body.append(profile.pageBytes - body.size() - tail.size(), 'x');
+            body += tail;
+        }
+        body.resize(profile.pageBytes);
+
+        std::string robotsBody;
+        int robotsStatus = 200;
+        switch (profile.robots) {
+        case RobotsBehavior::Allow: robotsBody = "User-agent: *\nDisallow: /private/\n"; break;
+        case RobotsBehavior::Disallow: robotsBody = "User-agent: *\nDisallow: /\n"; break;
+        case RobotsBehavior::Missing: robotsStatus = 404; break;
+        case RobotsBehavior::Error: robotsStatus = 503; break;
+        }
+
+        Responses built;
+        built.robots10 = response("HTTP/1.0", robotsStatus, robotsBody, false);
+        built.robots11 = response("HTTP/1.1", robotsStatus, robotsBody, false);
+        built.page10 = response("HTTP/1.0", profile.status, body, false);
+        built.page11 = response("HTTP/1.1", profile.status, body, profile.chunked);
+        responses.push_back(built);
+    }
+}
+
+ServerFarm::~ServerFarm() {
+    stop();
+}
+
+bool ServerFarm::start() {
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (listenFd < 0) {
+        return false;
+    }
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    // every address, since each host connects to its own 127.x.y.z; accepts
+    // from anywhere else are closed in serve()
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = 0;
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 4096) < 0) {
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listenFd, (sockaddr*)&addr, &len);
+    port = ntohs(addr.sin_port);
+
+    stopFd = eventfd(0, EFD_NONBLOCK);
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back(&ServerFarm::serve, this);
+    }
+    return true;
+}
+
+void ServerFarm::stop() {
+    if (stopFd >= 0) {
+        uint64_t one = 1;
+        if (write(stopFd, &one, sizeof(one)) < 0) {
+            perror("eventfd write");
+        }
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    threads.clear();
+    if (listenFd >= 0) {
+        close(listenFd);
+        listenFd = -1;
+    }
+    if (stopFd >= 0) {
+        close(stopFd);
+        stopFd = -1;
+    }
+}
+
+int ServerFarm::getPort() const {
+    return port;
+}
+
+long ServerFarm::getAccepted() const {
+    return accepted.load();
+}
+
+long ServerFarm::getPagesServed() const {
+    return pagesServed.load();
+}
+
+long ServerFarm::getRobotsServed() const {
+    return robotsServed.load();
+}
+
+long ServerFarm::getBytesServed() const {
+    return bytesServed.load();
+}
+
+long ServerFarm::getMisdirected() const {
+    return misdirected.load();
+}
+
+// N of a "Host: h<N>..." header, or -1
+static long hostNumber(const std::string& head) {
+    size_t pos = 0;
+    while ((pos = head.find("\r\n", pos)) != std::string::npos) {
+        pos += 2;
+        if (head.size() - pos > 5 && strncasecmp(head.c_str() + pos, "host:", 5) == 0) {
+            pos += 5;
+            while (pos < head.size() && head[pos] == ' ') {
+                pos++;
+            }
+            if (pos < head.size() && (head[pos] == 'h' || head[pos] == 'H')) {
+                return (long)strtoul(head.c_str() + pos + 1, nullptr, 10);
+            }
+            return -1;
+        }
+    }
+    return -1;
+}
+
+void ServerFarm::serve() {
+    int epfd = epoll_create1(0);
+
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.ptr = nullptr;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listenFd, &ev);
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = &stopFd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, stopFd, &ev);
+
+    // latency and trickle waits, by connection id so a closed connection's entries go stale
+    typedef std::pair<Clock::time_point, uint64_t> Timer;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    std::unordered_map<uint64_t, FarmConnection*> live;
+    uint64_t nextId = 1;
+
+    epoll_event events[128];
+    char chunk[4096];
+    bool running = true;
+
+    // read, answer and send what can be, then register for what the connection waits on
+    auto handle = [&](FarmConnection* conn, bool readable, bool hangup) {
+        Clock::time_point now = Clock::now();
+        bool closeIt = hangup;
+
+        if (readable && !conn->closeAfter) {
+            ssize_t got;
+            while ((got = recv(conn->fd, chunk, sizeof(chunk), 0)) > 0) {
+                conn->request.append(chunk, got);
+            }
+            if (got == 0 || (got < 0 && errno != EAGAIN)) {
+                closeIt = true;
+            }
+        }
+
+        // queue an answer to every complete request, pipelined ones in order
+        size_t end;
+        while (!closeIt && !conn->closeAfter && (end = conn->request.find("\r\n\r\n")) != std::string::npos) {
+            std::string head = conn->request.substr(0, end + 2);
+            conn->request.erase(0, end + 4);
+
+            long number = hostNumber(head);
+            if (number >= 0 && StubDNSServer::addressFor((unsigned)number).s_addr != conn->local.s_addr) {
+                misdirected++;
+            }
+            size_t profile = (size_t)std::max(number, 0L) % profiles.size();
+            bool robots = head.find(" /robots.txt ") != std::string::npos;
+            bool keepAlive = head.find(" HTTP/1.1\r\n") != std::string::npos && head.find("Connection: close") == std::string::npos;
+            const Responses& built = responses[profile];
+            const std::string* data = robots ? (keepAlive ? &built.robots11 : &built.robots10) : (keepAlive ? &built.page11 : &built.page10);
+            conn->responses.push_back(FarmResponse{ data, &profiles[profile], !robots, now + std::chrono::milliseconds(profiles[profile].latencyMs) });
+            conn->closeAfter = !keepAlive;
+        }
+
+        bool blocked = false;
+        while (!closeIt && !conn->responses.empty()) {
+            FarmResponse& front = conn->responses.front();
+            if (now < front.readyAt) {
+                timers.emplace(front.readyAt, conn->id);
+                break;
+            }
+            size_t left = front.data->size() - conn->sent;
+            size_t trickle = front.profile->trickleBytes;
+            size_t n = trickle > 0 && trickle < left ? trickle : left;
+            ssize_t sent = send(conn->fd, front.data->data() + conn->sent, n, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EAGAIN) {
+                    blocked = true;
+                }
+                else {
+                    closeIt = true;
+                }
+                break;
+            }
+            conn->sent += sent;
+            bytesServed += sent;
+            if (conn->sent == front.data->size()) {
+                (front.page ? pagesServed : robotsServed)++;
+                conn->responses.pop_front();
+                conn->sent = 0;
+                continue;
+            }
+            if (trickle > 0 && (size_t)sent == n) {
+                front.readyAt = now + std::chrono::milliseconds(front.profile->trickleMs);
+                timers.emplace(front.readyAt, conn->id);
+                break;
+            }
+        }
+        if (conn->responses.empty() && conn->closeAfter) {
+            closeIt = true;
+        }
+
+        if (closeIt) {
+            live.erase(conn->id);
+            close(conn->fd);
+            delete conn;
+            return;
+        }
+
+        // room to send, the next request, or nothing while a timer runs down a closing connection
+        uint32_t wanted = blocked ? EPOLLOUT : (conn->closeAfter ? 0 : EPOLLIN);
+        if (wanted != conn->events) {
+            epoll_event cev;
+            cev.events = wanted;
+            cev.data.ptr = conn;
+            epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &cev);
+            conn->events = wanted;
+        }
+    };
+
+    while (running) {
+        int waitMs = -1;
+        if (!timers.empty()) {
+            auto due = std::chrono::duration_cast<std::chrono::microseconds>(timers.top().first - Clock::now()).count();
+            waitMs = due > 0 ? (int)((due + 999) / 1000) : 0;
+        }
+
+        int n = epoll_wait(epfd, events, 128, waitMs);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == &stopFd) {
+                running = false;
+                continue;
+            }
+
+            if (events[i].data.ptr == nullptr) {
+                while (true) {
+                    int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+                    if (fd < 0) {
+                        break;
+                    }
+                    sockaddr_in local;
+                    socklen_t len = sizeof(local);
+                    if (getsockname(fd, (sockaddr*)&local, &len) < 0 || (ntohl(local.sin_addr.s_addr) >> 24) != 127) {
+                        close(fd);
+                        continue;
+                    }
+                    accepted++;
+                    FarmConnection* conn = new FarmConnection{ fd, nextId++, local.sin_addr, std::string(), {}, 0, false, EPOLLIN };
+                    live[conn->id] = conn;
+                    epoll_event cev;
+                    cev.events = EPOLLIN;
+                    cev.data.ptr = conn;
+                    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &cev);
+                }
+                continue;
+            }
+
+            FarmConnection* conn = static_cast<FarmConnection*>(events[i].data.ptr);
+            handle(conn, (events[i].events & EPOLLIN) != 0, (events[i].events & (EPOLLHUP | EPOLLERR)) != 0);
+        }
+
+        Clock::time_point now = Clock::now();
+        while (!timers.empty() && timers.top().first <= now) {
+            uint64_t id = timers.top().second;
+            timers.pop();
+            auto found = live.find(id);
+            if (found != live.end()) {
+                handle(found->second, false, false);
+            }
+        }
+    }
+
+    for (auto& entry : live) {
+        close(entry.second->fd);
+        delete entry.second;
+    }
+    close(epfd);
+}
@@ -0,0 +1,77 @@
+#ifndef SERVER_FARM_H
+#define SERVER_FARM_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// what a host's /robots.txt does
+enum class RobotsBehavior {
+    Allow,     // a group that disallows only /private/
+    Disallow,  // "Disallow: /", so the page is never fetched
+    Missing,   // 404, which allows everything
+    Error      // 503, which disallows everything
+};
+
+// how one host of the farm answers
+struct HostProfile {
+    int latencyMs = 0;          // before each response starts
+    size_t pageBytes = 16384;
+    int status = 200;           // of page responses
+    RobotsBehavior robots = RobotsBehavior::Allow;
+    bool chunked = false;       // HTTP/1.1 pages in chunked encoding
+    size_t trickleBytes = 0;    // nonzero: send responses this many bytes at a time,
+    int trickleMs = 0;          // trickleMs apart
+    int links = 20;             // on each page
+};
+
+// "latency=MS,page=BYTES,status=CODE,robots=allow|disallow|missing|error,chunked,
+// trickle=BYTES/MS,links=N", every field optional; false if it is malformed
+bool parseHostProfile(const std::string& spec, HostProfile& profile);
+std::string describeHostProfile(const HostProfile& profile);
+
+// multi-threaded epoll HTTP server standing in for many sites at once. it listens
+// on one port of every local address, and with StubDNSServer resolving h<N> to
+// its own 127.x.y.z each host has an address of its own, as it would on the
+// internet. host h<N> (from the Host header) answers as profiles[N % count].
+// connections from outside 127.0.0.0/8 are refused, and a request for h<N> that
+// arrives on another host's address is answered but counted as misdirected
+class ServerFarm {
+    public:
+        ServerFarm(int numThreads, const std::vector<HostProfile>& profiles);
+        ~ServerFarm();
+
+        // bind an ephemeral port and start serving; false on failure
+        bool start();
+        void stop();
+
+        int getPort() const;
+        long getAccepted() const;     // connections so far
+        long getPagesServed() const;  // page responses sent in full
+        long getRobotsServed() const;
+        long getBytesServed() const;
+        long getMisdirected() const;  // requests whose Host header is not the address dialed
+
+    private:
+        struct Responses {
+            std::string robots10, robots11, page10, page11;
+        };
+
+        void serve();
+
+        int numThreads;
+        int listenFd;
+        int port;
+        int stopFd;  // eventfd that wakes every server thread on stop()
+        std::vector<HostProfile> profiles;
+        std::vector<Responses> responses;  // prebuilt per profile
+        std::atomic<long> accepted;
+        std::atomic<long> pagesServed;
+        std::atomic<long> robotsServed;
+        std::atomic<long> bytesServed;
+        std::atomic<long> misdirected;
+        std::vector<std::thread> threads;
+};
+
+#endif // SERVER_FARM_H
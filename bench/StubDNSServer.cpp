@@ -0,0 +1,212 @@
+#include "StubDNSServer.h"
+
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <strings.h>
+#include <unistd.h>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define DNS_HEADER_SIZE 12
+#define DNS_TYPE_A 1
+#define DNS_TYPE_AAAA 28
+
+StubDNSServer::StubDNSServer(int dropEvery, unsigned ttl)
+    : dropEvery(dropEvery), ttl(ttl), fd(-1), port(0), stopFd(-1), queries(0), dropped(0) {
+}
+
+StubDNSServer::~StubDNSServer() {
+    stop();
+}
+
+bool StubDNSServer::start() {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    // plenty of room for a burst of pipelined queries
+    int bufSize = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    port = ntohs(addr.sin_port);
+
+    stopFd = eventfd(0, EFD_NONBLOCK);
+    thread = std::thread(&StubDNSServer::serve, this);
+    return true;
+}
+
+void StubDNSServer::stop() {
+    if (stopFd >= 0) {
+        uint64_t one = 1;
+        if (write(stopFd, &one, sizeof(one)) < 0) {
+            perror("eventfd write");
+        }
+    }
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (stopFd >= 0) {
+        close(stopFd);
+        stopFd = -1;
+    }
+}
+
+int StubDNSServer::getPort() const {
+    return port;
+}
+
+long StubDNSServer::getQueries() const {
+    return queries.load();
+}
+
+long StubDNSServer::getDropped() const {
+    return dropped.load();
+}
+
+in_addr StubDNSServer::addressFor(unsigned n) {
+    // skip 127.0.0.0 so every host gets a usable address
+    in_addr addr;
+    addr.s_addr = htonl(0x7F000000u | ((n + 1) & 0xFFFFFFu));
+    return addr;
+}
+
+void StubDNSServer::serve() {
+    unsigned char packet[512];
+    unsigned char reply[512];
+    pollfd fds[2];
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = stopFd;
+    fds[1].events = POLLIN;
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            continue;
+        }
+        if (fds[1].revents) {
+            return;
+        }
+
+        sockaddr_in from;
+        socklen_t fromLen = sizeof(from);
+        int len = (int)recvfrom(fd, packet, sizeof(packet), MSG_DONTWAIT, (sockaddr*)&from, &fromLen);
+        if (len <= 0) {
+            continue;
+        }
+
+        long n = ++queries;
+        if (dropEvery > 0 && n % dropEvery == 0) {
+            dropped++;
+            continue;
+        }
+
+        int replyLen = answer(packet, len, reply);
+        if (replyLen > 0) {
+            sendto(fd, reply, replyLen, 0, (sockaddr*)&from, fromLen);
+        }
+    }
+}
+
+int StubDNSServer::answer(const unsigned char* query, int len, unsigned char* reply) {
+    if (len < DNS_HEADER_SIZE + 5) {
+        return -1;
+    }
+
+    // walk the question name, remembering the first label
+    int pos = DNS_HEADER_SIZE;
+    const unsigned char* firstLabel = query + pos + 1;
+    int firstLen = query[pos];
+    while (pos < len && query[pos] != 0) {
+        if (query[pos] & 0xC0) {
+            return -1;
+        }
+        pos += query[pos] + 1;
+    }
+    pos++;
+    if (pos + 4 > len) {
+        return -1;
+    }
+    int questionEnd = pos + 4;
+    uint16_t qtype = (uint16_t)((query[pos] << 8) | query[pos + 1]);
+
+    // "h<N>" resolves, anything else does not exist
+    bool found = false;
+    bool v6only = firstLen == 6 && strncasecmp((const char*)firstLabel, "v6only", 6) == 0;
+    unsigned n = 0;
+    if (firstLen >= 2 && tolower(firstLabel[0]) == 'h') {
+        found = true;
+        for (int i = 1; i < firstLen; i++) {
+            if (!isdigit(firstLabel[i])) {
+                found = false;
+                break;
+            }
+            n = n * 10 + (firstLabel[i] - '0');
+        }
+    }
+
+    // header: same ID, response + recursion available, echoed question
+    memcpy(reply, query, questionEnd);
+    reply[2] = 0x81;
+    found = found || v6only;
+    reply[3] = found ? 0x80 : 0x83;
+    reply[4] = 0;
+    reply[5] = 1;
+    memset(reply + 6, 0, 6);
+    int out = questionEnd;
+
+    if (!found || (qtype != DNS_TYPE_A && qtype != DNS_TYPE_AAAA)) {
+        return out;
+    }
+
+    in_addr addr = addressFor(n);
+    unsigned char rdata[16];
+    int rdLength;
+    uint16_t type = v6only ? DNS_TYPE_AAAA : qtype;
+    if (type == DNS_TYPE_A) {
+        memcpy(rdata, &addr, 4);
+        rdLength = 4;
+    }
+    else {
+        // ::ffff:a.b.c.d
+        memset(rdata, 0, 10);
+        rdata[10] = 0xFF;
+        rdata[11] = 0xFF;
+        memcpy(rdata + 12, &addr, 4);
+        rdLength = 16;
+    }
+
+    reply[7] = 1; // ANCOUNT
+    reply[out++] = 0xC0; // pointer to the question name
+    reply[out++] = DNS_HEADER_SIZE;
+    reply[out++] = (unsigned char)(type >> 8);
+    reply[out++] = (unsigned char)(type & 0xFF);
+    reply[out++] = 0;
+    reply[out++] = 1; // class IN
+    reply[out++] = (unsigned char)(ttl >> 24);
+    reply[out++] = (unsigned char)(ttl >> 16);
+    reply[out++] = (unsigned char)(ttl >> 8);
+    reply[out++] = (unsigned char)(ttl & 0xFF);
+    reply[out++] = 0;
+    reply[out++] = (unsigned char)rdLength;
+    memcpy(reply + out, rdata, rdLength);
+    return out + rdLength;
+}
@@ -0,0 +1,43 @@
+#ifndef STUB_DNS_SERVER_H
+#define STUB_DNS_SERVER_H
+
+#include <netinet/in.h>
+#include <string>
+#include <thread>
+#include <atomic>
+
+// authoritative-looking UDP DNS server on 127.0.0.1 for benchmarks: "h<N>.<any>"
+// answers A with addressFor(N) (AAAA with its v4-mapped form), "v6only.<any>"
+// answers an A query with an AAAA record as a broken server might, everything
+// else is NXDOMAIN; every dropEvery-th query is ignored to exercise resolver retries
+class StubDNSServer {
+    public:
+        explicit StubDNSServer(int dropEvery = 0, unsigned ttl = 300);
+        ~StubDNSServer();
+
+        // bind an ephemeral port and start serving; false on failure
+        bool start();
+        void stop();
+
+        int getPort() const;
+        long getQueries() const;
+        long getDropped() const;
+
+        // 127.x.y.z address handed out for h<n>; distinct for n below 2^24 - 1
+        static in_addr addressFor(unsigned n);
+
+    private:
+        void serve();
+        int answer(const unsigned char* query, int len, unsigned char* reply);
+
+        int dropEvery;
+        unsigned ttl;
+        int fd;
+        int port;
+        int stopFd;  // eventfd that wakes the server thread on stop()
+        std::atomic<long> queries;
+        std::atomic<long> dropped;
+        std::thread thread;
+};
+
+#endif // STUB_DNS_SERVER_H
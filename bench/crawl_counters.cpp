@@ -0,0 +1,122 @@
+// the crawl counters on the per-URL hot path: the old adjacent std::atomic<long>
+// fields, each bumped with a locked add that every thread fights over, against
+// one WorkerCounters block per thread summed by the reader. each simulated URL
+// bumps the handful of counters a crawled page does, and both sides must end on
+// the same totals
+//
+// usage: bench_crawl_counters [urlsPerThread] [maxThreads]
+
+#include "CrawlCounters.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// what Crawler kept before: one shared field per counter, packed together
+struct SharedCounters {
+    std::atomic<long> values[COUNTER_COUNT];
+
+    SharedCounters() {
+        for (std::atomic<long>& value : values) {
+            value = 0;
+        }
+    }
+};
+
+// the counters one crawled page touches, and by how much
+static const Counter pageCounters[] = {
+    Counter::ExtractedURLs, Counter::UniqueHosts, Counter::DNSLookups, Counter::UniqueIPs,
+    Counter::RobotsChecked, Counter::RobotsPassed, Counter::Http2xx, Counter::PagesCrawled
+};
+
+static double runShared(int numThreads, long urls, std::vector<uint64_t>& totals) {
+    SharedCounters counters;
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&counters, urls] {
+            for (long i = 0; i < urls; i++) {
+                for (Counter counter : pageCounters) {
+                    counters.values[(int)counter]++;
+                }
+                counters.values[(int)Counter::TotalLinks] += 40;
+                counters.values[(int)Counter::TotalBytes] += 16384 + (i & 1023);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        totals[i] = (uint64_t)counters.values[i].load();
+    }
+    return seconds;
+}
+
+static double runPerWorker(int numThreads, long urls, std::vector<uint64_t>& totals) {
+    std::unique_ptr<WorkerCounters[]> counters(new WorkerCounters[numThreads]);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&counters, t, urls] {
+            WorkerCounters& own = counters[t];
+            for (long i = 0; i < urls; i++) {
+                for (Counter counter : pageCounters) {
+                    own.add(counter, 1);
+                }
+                own.add(Counter::TotalLinks, 40);
+                own.add(Counter::TotalBytes, 16384 + (i & 1023));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // what Crawler::getCounter does
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        totals[i] = 0;
+        for (int t = 0; t < numThreads; t++) {
+            totals[i] += counters[t].values[i].load(std::memory_order_relaxed);
+        }
+    }
+    return seconds;
+}
+
+int main(int argc, char* argv[]) {
+    long urls = argc > 1 ? atol(argv[1]) : 2000000;
+    int maxThreads = argc > 2 ? atoi(argv[2]) : 64;
+
+    printf("%d counters, %zu-byte worker block, %ld URLs per thread, %u hardware threads\n", COUNTER_COUNT, sizeof(WorkerCounters), urls,
+        std::thread::hardware_concurrency());
+    printf("%8s %16s %16s %8s\n", "threads", "shared Murls/s", "worker Murls/s", "speedup");
+
+    std::vector<uint64_t> shared(COUNTER_COUNT), perWorker(COUNTER_COUNT);
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        double sharedSeconds = runShared(numThreads, urls, shared);
+        double workerSeconds = runPerWorker(numThreads, urls, perWorker);
+        if (shared != perWorker) {
+            printf("mismatch at %d threads\n", numThreads);
+            printf("FAILED\n");
+            return 1;
+        }
+
+        double total = (double)urls * numThreads;
+        printf("%8d %16.2f %16.2f %7.2fx\n", numThreads, total / sharedSeconds / 1e6, total / workerSeconds / 1e6, sharedSeconds / workerSeconds);
+    }
+
+    // the byte counter must get past where a 32-bit long stopped
+    WorkerCounters big;
+    big.add(Counter::TotalBytes, 3ull << 30);
+    big.add(Counter::TotalBytes, 3ull << 30);
+    bool ok = big.values[(int)Counter::TotalBytes].load() == (6ull << 30);
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
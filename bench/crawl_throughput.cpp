@@ -0,0 +1,189 @@
+// end-to-end crawler throughput against a reproducible internet stand-in: a
+// ServerFarm answering for every host on its own 127.x.y.z, which StubDNSServer
+// resolves h<N> to. For each seed count a seed file of http://h<N>.farm URLs is
+// generated and the real wincrawl binary is run on it as a child process, so its
+// CPU time and peak RSS are its own. Pages and bytes come from the crawler's
+// --stats-json file. Each host answers as one of the --host profiles, taken
+// round-robin by host number. A run fails if any request reaches the address
+// of a host other than the one it names.
+//
+// usage: bench_crawl_throughput [urls[,urls...]] [threads] [--host=PROFILE ...]
+//            [--farm-threads=N] [crawler options...]
+//   PROFILE: latency=MS,page=BYTES,status=CODE,robots=allow|disallow|missing|error,
+//            chunked,trickle=BYTES/MS,links=N (every field optional)
+//   e.g. bench_crawl_throughput 10000,100000,1000000 64 --engine=epoll --host=page=16384 --host=latency=20,chunked
+
+#include "ServerFarm.h"
+#include "StubDNSServer.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef WINCRAWL_BINARY
+#define WINCRAWL_BINARY "./wincrawl"
+#endif
+
+static bool writeSeeds(const std::string& path, long urls, int port) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    static char buffer[1 << 20];
+    setvbuf(file, buffer, _IOFBF, sizeof(buffer));
+    for (long i = 0; i < urls; i++) {
+        fprintf(file, "http://h%ld.farm:%d/p%ld.html\n", i, port, i);
+    }
+    return fclose(file) == 0;
+}
+
+// value of "key": in the last line of a --stats-json file, -1 if it is not there
+static double lastStat(const std::string& path, const char* key) {
+    std::ifstream file(path);
+    std::string line, last;
+    while (std::getline(file, line)) {
+        if (!line.empty()) {
+            last = line;
+        }
+    }
+    std::string quoted = std::string("\"") + key + "\":";
+    size_t pos = last.find(quoted);
+    return pos == std::string::npos ? -1 : strtod(last.c_str() + pos + quoted.size(), nullptr);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<long> sizes;
+    std::string threads = "16";
+    std::vector<HostProfile> profiles;
+    std::vector<std::string> crawlerOptions;
+    int farmThreads = 4;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--host=") == 0) {
+            HostProfile profile;
+            if (!parseHostProfile(arg.substr(7), profile)) {
+                printf("Invalid host profile: %s\n", arg.c_str() + 7);
+                return 1;
+            }
+            profiles.push_back(profile);
+        }
+        else if (arg.compare(0, 15, "--farm-threads=") == 0) {
+            farmThreads = atoi(arg.c_str() + 15);
+        }
+        else if (arg.compare(0, 2, "--") == 0) {
+            crawlerOptions.push_back(arg);
+        }
+        else if (positional++ == 0) {
+            std::stringstream list(arg);
+            std::string size;
+            while (std::getline(list, size, ',')) {
+                sizes.push_back(atol(size.c_str()));
+            }
+        }
+        else {
+            threads = arg;
+        }
+    }
+    if (sizes.empty()) {
+        sizes.push_back(10000);
+    }
+    if (profiles.empty()) {
+        profiles.push_back(HostProfile());
+    }
+    if (farmThreads < 1) {
+        farmThreads = 1;
+    }
+
+    StubDNSServer dns;
+    ServerFarm farm(farmThreads, profiles);
+    if (!dns.start() || !farm.start()) {
+        printf("Cannot start the loopback servers\n");
+        return 1;
+    }
+    printf("farm on port %d with %d threads, stub DNS on port %d, crawler %s with %s threads\n", farm.getPort(), farmThreads, dns.getPort(), WINCRAWL_BINARY,
+        threads.c_str());
+    for (size_t i = 0; i < profiles.size(); i++) {
+        printf("  host profile %zu: %s\n", i, describeHostProfile(profiles[i]).c_str());
+    }
+    printf("%10s %10s %10s %8s %10s %10s %12s %10s\n", "urls", "pages", "served", "wall s", "pps", "Mbps", "cpu us/page", "peak MB");
+
+    bool ok = true;
+    for (long urls : sizes) {
+        std::string seeds = "bench-seeds-" + std::to_string(urls) + ".txt";
+        std::string stats = "bench-stats-" + std::to_string(urls) + ".json";
+        std::string log = "bench-crawl-" + std::to_string(urls) + ".log";
+        if (!writeSeeds(seeds, urls, farm.getPort())) {
+            printf("Cannot write %s\n", seeds.c_str());
+            return 1;
+        }
+        remove(stats.c_str());
+
+        std::vector<std::string> args = { WINCRAWL_BINARY, threads, seeds, "--dns=127.0.0.1:" + std::to_string(dns.getPort()), "--stats-json=" + stats };
+        args.insert(args.end(), crawlerOptions.begin(), crawlerOptions.end());
+        std::vector<char*> childArgv;
+        for (std::string& arg : args) {
+            childArgv.push_back(&arg[0]);
+        }
+        childArgv.push_back(nullptr);
+
+        long servedBefore = farm.getPagesServed();
+        long misdirectedBefore = farm.getMisdirected();
+        auto start = std::chrono::steady_clock::now();
+        pid_t pid = fork();
+        if (pid == 0) {
+            int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0) {
+                dup2(fd, 1);
+                dup2(fd, 2);
+            }
+            execv(childArgv[0], childArgv.data());
+            _exit(127);
+        }
+        int status = 0;
+        rusage usage;
+        memset(&usage, 0, sizeof(usage));
+        if (pid < 0 || wait4(pid, &status, 0, &usage) < 0) {
+            printf("Cannot run %s\n", WINCRAWL_BINARY);
+            return 1;
+        }
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double pages = lastStat(stats, "pages_crawled_total");
+        double bytes = lastStat(stats, "bytes_total");
+        long served = farm.getPagesServed() - servedBefore;
+        double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || pages < 0) {
+            printf("%10ld crawler failed (status %d), see %s\n", urls, status, log.c_str());
+            ok = false;
+            continue;
+        }
+
+        printf("%10ld %10.0f %10ld %8.2f %10.0f %10.1f %12.1f %10.1f\n", urls, pages, served, wall, pages / wall, bytes * 8 / wall / 1e6,
+            pages > 0 ? cpu * 1e6 / pages : 0.0, usage.ru_maxrss / 1024.0);
+        // every host has its own address, so a request on another one was sent to the wrong IP
+        long misdirected = farm.getMisdirected() - misdirectedBefore;
+        if (misdirected > 0) {
+            printf("%10ld %ld requests reached another host's address\n", urls, misdirected);
+            ok = false;
+        }
+        remove(seeds.c_str());
+        remove(stats.c_str());
+        remove(log.c_str());
+    }
+
+    farm.stop();
+    dns.stop();
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
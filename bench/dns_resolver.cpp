@@ -0,0 +1,211 @@
+// checks DNSResolver against a loopback stub server and measures how many
+// lookups per second it sustains one at a time versus pipelined
+//
+// usage: bench_dns_resolver [names] [window] [dropEvery]
+
+#include "StubDNSServer.h"
+#include "DNSResolver.h"
+
+#include <poll.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// short, so a dropped query costs the serial run little more than a loopback round trip
+#define BENCH_TIMEOUT_MS 100
+
+static bool sameAddress(const in_addr& a, const in_addr& b) {
+    return a.s_addr == b.s_addr;
+}
+
+static bool check(bool ok, const char* what) {
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static sockaddr_in loopback(int port) {
+    sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server.sin_port = htons((uint16_t)port);
+    return server;
+}
+
+// wait for and collect every outstanding answer
+static void drain(DNSResolver& resolver, std::vector<DNSResult>& results) {
+    while (resolver.pending() > 0) {
+        pollfd pfd;
+        pfd.fd = resolver.getHandle();
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        ::poll(&pfd, 1, resolver.nextTimeoutMs());
+        resolver.poll(results);
+    }
+}
+
+static bool runChecks(int port) {
+    bool ok = true;
+    printf("checks:\n");
+
+    DNSResolver resolver;
+    ok &= check(resolver.init(loopback(port), 200, 2), "init");
+
+    in_addr addr;
+    uint32_t ttl;
+    ok &= check(resolver.resolve("h42.example.com", addr, ttl) == DNSStatus::Ok && sameAddress(addr, StubDNSServer::addressFor(42)), "blocking A lookup");
+    ok &= check(resolver.resolve("nx.example.com", addr, ttl) == DNSStatus::NXDomain, "blocking NXDOMAIN lookup");
+    ok &= check(resolver.resolve("v6only.example.com", addr, ttl) == DNSStatus::NXDomain, "A lookup answered only with AAAA");
+
+    // many queries in flight at once, answered out of submission order is fine
+    std::vector<int> cookies(64);
+    for (int i = 0; i < 64; i++) {
+        cookies[i] = i;
+        resolver.submit("H" + std::to_string(i) + ".Example.COM", DNS_TYPE_A, &cookies[i]);
+    }
+    resolver.submit("h7.example.com", DNS_TYPE_AAAA, nullptr);
+    resolver.submit("nxdomain.example.com", DNS_TYPE_A, nullptr);
+
+    std::vector<DNSResult> results;
+    drain(resolver, results);
+    int matched = 0;
+    bool sawAAAA = false, sawNX = false;
+    for (const DNSResult& result : results) {
+        if (result.cookie != nullptr) {
+            int i = *static_cast<int*>(result.cookie);
+            if (result.status == DNSStatus::Ok && result.addrs.size() == 1 && result.ttl == 300 &&
+                sameAddress(result.addrs[0], StubDNSServer::addressFor(i))) {
+                matched++;
+            }
+        }
+        else if (result.qtype == DNS_TYPE_AAAA) {
+            sawAAAA = result.status == DNSStatus::Ok && result.addrs6.size() == 1 && result.addrs6[0].s6_addr[10] == 0xFF;
+        }
+        else {
+            sawNX = result.status == DNSStatus::NXDomain;
+        }
+    }
+    ok &= check(results.size() == 66 && matched == 64, "64 pipelined A lookups matched by ID");
+    ok &= check(sawAAAA, "AAAA lookup");
+    ok &= check(sawNX, "pipelined NXDOMAIN");
+
+    // a server that never answers: one send plus two retries, then Timeout
+    StubDNSServer silent(1);
+    silent.start();
+    DNSResolver lost;
+    lost.init(loopback(silent.getPort()), 50, 2);
+    results.clear();
+    lost.submit("h1.example.com", DNS_TYPE_A, nullptr);
+    auto start = std::chrono::steady_clock::now();
+    drain(lost, results);
+    double waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ok &= check(results.size() == 1 && results[0].status == DNSStatus::Timeout, "timeout after retries");
+    ok &= check(silent.getQueries() == 3 && waited >= 0.15, "two retries sent before giving up");
+
+    // every fourth packet dropped: retries still get everything through
+    StubDNSServer lossy(4);
+    lossy.start();
+    DNSResolver retrying;
+    retrying.init(loopback(lossy.getPort()), 20, 3);
+    results.clear();
+    for (int i = 0; i < 32; i++) {
+        retrying.submit("h" + std::to_string(i) + ".example.com", DNS_TYPE_A, nullptr);
+    }
+    drain(retrying, results);
+    int answered = 0;
+    for (const DNSResult& result : results) {
+        answered += result.status == DNSStatus::Ok;
+    }
+    ok &= check(answered == 32 && lossy.getDropped() > 0, "retries recover dropped queries");
+
+    return ok;
+}
+
+struct Throughput {
+    long ok = 0;
+    long failed = 0;
+    double seconds = 0;
+};
+
+static Throughput runSerial(int port, long names) {
+    DNSResolver resolver;
+    resolver.init(loopback(port), BENCH_TIMEOUT_MS, 2);
+
+    Throughput t;
+    in_addr addr;
+    uint32_t ttl;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < names; i++) {
+        if (resolver.resolve("h" + std::to_string(i) + ".bench.test", addr, ttl) == DNSStatus::Ok) {
+            t.ok++;
+        }
+        else {
+            t.failed++;
+        }
+    }
+    t.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return t;
+}
+
+static Throughput runPipelined(int port, long names, int window) {
+    DNSResolver resolver;
+    resolver.init(loopback(port), BENCH_TIMEOUT_MS, 2);
+
+    Throughput t;
+    std::vector<DNSResult> results;
+    long next = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (next < names || resolver.pending() > 0) {
+        while (next < names && (int)resolver.pending() < window) {
+            resolver.submit("h" + std::to_string(next) + ".bench.test", DNS_TYPE_A, nullptr);
+            next++;
+        }
+
+        pollfd pfd;
+        pfd.fd = resolver.getHandle();
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        ::poll(&pfd, 1, resolver.nextTimeoutMs());
+
+        results.clear();
+        resolver.poll(results);
+        for (const DNSResult& result : results) {
+            if (result.status == DNSStatus::Ok) {
+                t.ok++;
+            }
+            else {
+                t.failed++;
+            }
+        }
+    }
+    t.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return t;
+}
+
+static void report(const char* name, const Throughput& t) {
+    printf("%-10s %8ld ok %6ld failed %10.0f lookups/s\n", name, t.ok, t.failed, (t.ok + t.failed) / t.seconds);
+}
+
+int main(int argc, char* argv[]) {
+    long names = argc > 1 ? atol(argv[1]) : 20000;
+    int window = argc > 2 ? atoi(argv[2]) : 256;
+    int dropEvery = argc > 3 ? atoi(argv[3]) : 0;
+
+    StubDNSServer server;
+    if (!server.start()) {
+        printf("failed to start the stub DNS server\n");
+        return 1;
+    }
+    bool ok = runChecks(server.getPort());
+
+    StubDNSServer benchServer(dropEvery);
+    benchServer.start();
+    printf("\n%ld names, window %d, dropping every %d-th query\n", names, window, dropEvery);
+    report("serial", runSerial(benchServer.getPort(), names));
+    report("pipelined", runPipelined(benchServer.getPort(), names, window));
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+// per-link domain classification: the std::regex_match the crawler used to run
+// on every link for one domain, against DomainMatcher with several rule sets,
+// one of them thousands of suffixes long. Every link's result is diffed against
+// a naive loop over all suffixes, and the matcher must not allocate.
+// Allocations are counted through a replaced global operator new.
+//
+// usage: bench_domain_matcher [links] [targetDomains]
+
+#include "DomainMatcher.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+static std::atomic<long> allocations(0);
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+struct RuleSet {
+    std::string name;
+    std::vector<std::string> suffixes;
+};
+
+static std::string lowered(std::string s) {
+    for (char& c : s) {
+        if (c >= 'A' && c <= 'Z') {
+            c |= 0x20;
+        }
+    }
+    return s;
+}
+
+// whether host is suffix or a name under it, one suffix at a time
+static uint64_t naiveMatch(const std::vector<RuleSet>& sets, const std::string& url) {
+    std::string host = lowered(std::string(DomainMatcher::hostOf(url)));
+    if (!host.empty() && host.back() == '.') {
+        host.pop_back();
+    }
+    uint64_t matched = 0;
+    for (size_t set = 0; set < sets.size(); set++) {
+        for (const std::string& suffix : sets[set].suffixes) {
+            if (host == suffix || (host.size() > suffix.size() && host.compare(host.size() - suffix.size(), suffix.size(), suffix) == 0 &&
+                host[host.size() - suffix.size() - 1] == '.')) {
+                matched |= 1ull << set;
+                break;
+            }
+        }
+    }
+    return matched;
+}
+
+static std::string randomLabel(std::mt19937& rng, int minLength, int maxLength) {
+    std::string label;
+    for (int i = minLength + (int)(rng() % (maxLength - minLength + 1)); i > 0; i--) {
+        label += "abcdefghijklmnopqrstuvwxyz0123456789-"[rng() % (rng() % 8 == 0 ? 37 : 26)];
+    }
+    return label;
+}
+
+int main(int argc, char* argv[]) {
+    long count = argc > 1 ? atol(argv[1]) : 500000;
+    int targets = argc > 2 ? atoi(argv[2]) : 10000;
+
+    std::mt19937 rng(19);
+    std::vector<RuleSet> sets = {
+        { "tamu", { "tamu.edu" } },
+        { "government", { "gov", "mil", "gov.uk", "gc.ca" } },
+        { "targets", {} },
+    };
+    for (int i = 0; i < targets; i++) {
+        sets[2].suffixes.push_back(randomLabel(rng, 3, 12) + (rng() % 3 == 0 ? ".org" : ".com"));
+    }
+
+    DomainMatcher matcher;
+    for (const RuleSet& set : sets) {
+        matcher.addRuleSet(set.name, set.suffixes);
+    }
+
+    // a mix of hits under every set, near misses and unrelated hosts
+    static const char* tlds[] = { ".com", ".org", ".edu", ".net", ".gov", ".co.uk" };
+    std::vector<std::string> urls;
+    urls.reserve(count);
+    for (long i = 0; i < count; i++) {
+        std::string host;
+        switch (rng() % 8) {
+        case 0: host = "tamu.edu"; break;
+        case 1: host = randomLabel(rng, 2, 8) + ".TAMU.edu"; break;
+        case 2: host = "www." + sets[2].suffixes[rng() % targets]; break;
+        case 3: host = sets[2].suffixes[rng() % targets]; break;
+        case 4: host = "x" + sets[2].suffixes[rng() % targets]; break;  // not a label boundary
+        case 5: host = randomLabel(rng, 3, 10) + ".state.gov."; break;
+        default: host = "www." + randomLabel(rng, 3, 12) + tlds[rng() % 6]; break;
+        }
+        std::string url = "http://";
+        if (rng() % 50 == 0) {
+            url += "user@";
+        }
+        url += host;
+        if (rng() % 10 == 0) {
+            url += ":8080";
+        }
+        url += "/path/page.html?id=" + std::to_string(i);
+        urls.push_back(url);
+    }
+
+    // differential pass
+    long mismatches = 0;
+    for (const std::string& url : urls) {
+        uint64_t got = matcher.match(DomainMatcher::hostOf(url));
+        uint64_t want = naiveMatch(sets, url);
+        if (got != want && mismatches++ < 10) {
+            printf("mismatch on %s: got %llx, want %llx\n", url.c_str(), (unsigned long long)got, (unsigned long long)want);
+        }
+    }
+    printf("%zu rule sets, %zu trie nodes; %zu links diffed, %ld mismatches\n", sets.size(), matcher.getNodeCount(), urls.size(), mismatches);
+
+    // the regex from the old commented-out TAMU check, on one domain. as written it
+    // ended at "(/|$)", so regex_match never matched a link with a path; the path
+    // and any case are let through here so that it at least finds the same links
+    const std::regex tamuRegex(R"(^https?://([a-zA-Z0-9-]+\.)*tamu\.edu(/.*)?)", std::regex::icase);
+    size_t regexLinks = urls.size() < 50000 ? urls.size() : 50000;
+    long regexHits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < regexLinks; i++) {
+        regexHits += std::regex_match(urls[i], tamuRegex);
+    }
+    double regexSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const int rounds = 10;
+    long hits[DOMAIN_MAX_SETS] = {};
+    long before = allocations.load();
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const std::string& url : urls) {
+            uint64_t matched = matcher.match(DomainMatcher::hostOf(url));
+            for (int set = 0; matched != 0; set++, matched >>= 1) {
+                hits[set] += matched & 1;
+            }
+        }
+    }
+    double matcherSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long matcherAllocations = allocations.load() - before;
+
+    printf("regex, 1 domain       %8.1f ns/link (%ld of %zu hit)\n", regexSeconds * 1e9 / regexLinks, regexHits, regexLinks);
+    printf("matcher, %5zu domains %8.1f ns/link, %ld allocations\n", sets[0].suffixes.size() + sets[1].suffixes.size() + sets[2].suffixes.size(),
+        matcherSeconds * 1e9 / (urls.size() * rounds), matcherAllocations);
+    for (size_t set = 0; set < sets.size(); set++) {
+        printf("  %-12s %ld hits\n", sets[set].name.c_str(), hits[set] / rounds);
+    }
+
+    bool ok = mismatches == 0 && matcherAllocations == 0;
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
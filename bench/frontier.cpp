@@ -0,0 +1,212 @@
+// Frontier throughput and ordering. Worker threads act as parse-heavy crawlers:
+// each pops a URL, "extracts" linksPerPage links to fresh hosts and pushes them
+// back, either one push per link or one batch per page. The run ends through
+// the frontier's own idle detection. A single-threaded pass then checks that
+// each built-in priority pops in the order it promises, and a spill pass pushes
+// spillLinks links through a frontier with a spillMB memory budget and checks
+// that every one comes back, in order, from the segment files.
+//
+// usage: bench_frontier [pages] [threads] [linksPerPage] [spillLinks] [spillMB]
+
+#include "Frontier.h"
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+static FrontierLink makeLink(long id, int depth, const char* path) {
+    FrontierLink link;
+    link.url = "http://h" + std::to_string(id) + ".example.com";
+    link.hostLength = link.url.size() - 7;
+    link.url += path;
+    link.depth = depth;
+    return link;
+}
+
+struct RunResult {
+    double seconds;
+    long popped;
+    long inserted;
+};
+
+static RunResult run(long pages, int threads, int linksPerPage, bool batched) {
+    FingerprintSet seen;
+    Frontier frontier(FrontierPriority::create(FrontierOrder::Depth), seen, FrontierDedupe::Host, threads, 1 << 20, pages * 2);
+    std::atomic<long> nextHost(1), popped(0);
+    frontier.pushSeed("http://h0.example.com/");
+    frontier.close();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            std::string url;
+            int depth;
+            std::vector<FrontierLink> batch;
+            while (frontier.pop(url, depth)) {
+                popped++;
+                for (int i = 0; i < linksPerPage; i++) {
+                    long id = nextHost++;
+                    if (id >= pages) {
+                        break;
+                    }
+                    batch.push_back(makeLink(id, depth + 1, "/index.html"));
+                    if (!batched) {
+                        frontier.push(batch);
+                    }
+                }
+                frontier.push(batch);
+            }
+            frontier.leave();
+        });
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    RunResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.popped = popped;
+    result.inserted = frontier.getInserted();
+    return result;
+}
+
+// every tenth link shares a site, so host diversity has something to push back
+static FrontierLink orderLink(long i) {
+    static const char* paths[] = { "/", "/a/b/c/d", "/a?q=1", "/very/long/path/to/a/page/that/goes/on/and/on/index.html" };
+    FrontierLink link = makeLink(i, (int)(i * 7 % 5), paths[i % 4]);
+    if (i % 10 == 0) {
+        link.url = "http://www" + std::to_string(i) + ".crowded.org" + paths[i % 4];
+        link.hostLength = link.url.find('/', 7) - 7;
+    }
+    return link;
+}
+
+// pop everything single-threaded; false if any pop ranks ahead of one before it
+static bool checkOrder(FrontierOrder order, const char* name) {
+    const long count = 4000;
+    FingerprintSet seen;
+    Frontier frontier(FrontierPriority::create(order), seen, FrontierDedupe::Host, 1, 1 << 20, 1 << 20);
+    std::vector<FrontierLink> batch;
+    for (long i = 0; i < count; i++) {
+        batch.push_back(orderLink(i));
+    }
+    frontier.push(batch);
+    frontier.close();
+
+    // a fresh instance fed the same links in the same order ranks them the same way
+    std::unique_ptr<FrontierPriority> reference = FrontierPriority::create(order);
+    std::unordered_map<std::string, int> ranks;
+    for (long i = 0; i < count; i++) {
+        FrontierLink link = orderLink(i);
+        ranks[link.url] = reference->rank(link);
+    }
+
+    std::string url;
+    int depth, last = 0;
+    long popped = 0;
+    bool ok = true;
+    while (frontier.pop(url, depth)) {
+        int rank = ranks.count(url) ? ranks[url] : -1;
+        ok = ok && rank >= last;
+        last = rank;
+        popped++;
+    }
+    ok = ok && popped == count;
+    printf("order %-6s %ld popped, last rank %d: %s\n", name, popped, last, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static long peakRssMB() {
+#ifdef __linux__
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;
+#else
+    return 0;
+#endif
+}
+
+// push everything, then pop it all; links come out by depth, and in push order
+// within a depth, whether they stayed in memory or went through the disk
+static bool checkSpill(long count, int ramMB) {
+    const int depths = 3;
+    FingerprintSet seen;
+    Frontier frontier(FrontierPriority::create(FrontierOrder::Depth), seen, FrontierDedupe::Host, 1, 1 << 20, LONG_MAX);
+    if (!frontier.enableSpill("bench-spill", (long)ramMB * 1024 * 1024)) {
+        printf("spill: cannot write to bench-spill: FAILED\n");
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<FrontierLink> batch;
+    for (long i = 0; i < count; i++) {
+        batch.push_back(makeLink(i, (int)(i % depths), "/some/typical/path/index.html"));
+        if (batch.size() == 50) {
+            frontier.push(batch);
+        }
+    }
+    frontier.push(batch);
+    frontier.close();
+    double pushSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::string url;
+    int depth, lastDepth = 0;
+    long popped = 0, lastId = -1;
+    bool ok = true;
+    start = std::chrono::steady_clock::now();
+    while (frontier.pop(url, depth)) {
+        long id = atol(url.c_str() + 8);
+        if (depth != lastDepth) {
+            ok = ok && depth == lastDepth + 1;
+            lastDepth = depth;
+            lastId = -1;
+        }
+        ok = ok && id > lastId && id % depths == depth;
+        lastId = id;
+        popped++;
+    }
+    double popSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ok = ok && popped == count && frontier.getDropped() == 0;
+
+    printf("spill  %ld links, %d MB budget: push %.0f links/s, pop %.0f links/s, %.1f MB spilled, peak RSS %ld MB: %s\n",
+        popped, ramMB, count / pushSeconds, popped / popSeconds, frontier.getSpilledBytes() / (1024.0 * 1024.0), peakRssMB(),
+        ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    long pages = argc > 1 ? atol(argv[1]) : 1000000;
+    int threads = argc > 2 ? atoi(argv[2]) : 8;
+    int linksPerPage = argc > 3 ? atoi(argv[3]) : 50;
+    long spillLinks = argc > 4 ? atol(argv[4]) : 5000000;
+    int spillMB = argc > 5 ? atoi(argv[5]) : 16;
+    bool allOk = true;
+
+    // first, so peak RSS is the spilling frontier's own
+    allOk = checkSpill(spillLinks, spillMB) && allOk;
+
+    printf("%ld pages, %d threads, %d links per page\n", pages, threads, linksPerPage);
+    for (int batched = 0; batched < 2; batched++) {
+        RunResult r = run(pages, threads, linksPerPage, batched != 0);
+        bool ok = r.popped == pages && r.inserted == pages - 1;
+        printf("%-14s %10.0f links/s  %ld pages popped: %s\n", batched ? "batch per page" : "push per link",
+            r.inserted / r.seconds, r.popped, ok ? "ok" : "FAILED");
+        allOk = allOk && ok;
+    }
+
+    allOk = checkOrder(FrontierOrder::Depth, "depth") && allOk;
+    allOk = checkOrder(FrontierOrder::Hosts, "hosts") && allOk;
+    allOk = checkOrder(FrontierOrder::Score, "score") && allOk;
+    return allOk ? 0 : 1;
+}
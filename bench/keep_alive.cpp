@@ -0,0 +1,154 @@
+// per-host cost of the crawler's robots + page sequence against a loopback
+// server with each --http mode: a connection per request (close), both requests
+// on one connection (keep-alive), and the page request sent right behind robots
+// (pipeline). The crawler itself has no pipeline mode, since it would request pages
+// before robots.txt can disallow them; that row shows what it gives up. Pages are framed by Content-Length or chunked encoding, and every
+// page body is checked after dechunking.
+//
+// usage: bench_keep_alive [hosts] [concurrency] [pageBytes]
+
+#include "LoopbackServer.h"
+#include "Socket.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define ROBOTS_LIMIT (16 * 1024)
+#define PAGE_LIMIT (64 * 1024 * 1024)
+
+// the crawler's --http modes, plus the pipelining it no longer does
+enum class SequenceMode {
+    Close,
+    KeepAlive,
+    Pipeline
+};
+
+static const char* modeName(SequenceMode mode) {
+    switch (mode) {
+    case SequenceMode::Close: return "close";
+    case SequenceMode::KeepAlive: return "keep-alive";
+    default: return "pipeline";
+    }
+}
+
+// the same steps as Crawler::Run for one host; true if the whole page arrived intact
+static bool crawlHost(Socket& socket, int port, SequenceMode mode, size_t pageBytes, HTTPResponse& response) {
+    const std::string host = "127.0.0.1";
+    bool pipelined = mode == SequenceMode::Pipeline;
+
+    if (!socket.connect(host, port)) {
+        return false;
+    }
+    if (pipelined) {
+        socket.queueHTTPRequest(host, "/robots.txt", "GET");
+    }
+    if (!socket.sendHTTPRequest(host, pipelined ? "/" : "/robots.txt", "GET") ||
+        !socket.receiveResponse(response, ROBOTS_LIMIT) || response.statusCode != 404) {
+        return false;
+    }
+
+    if (!socket.canReuse()) {
+        if (!socket.connect(host, port) || !socket.sendHTTPRequest(host, "/", "GET")) {
+            return false;
+        }
+    }
+    else if (!pipelined && !socket.sendHTTPRequest(host, "/", "GET")) {
+        return false;
+    }
+    if (!socket.receiveResponse(response, PAGE_LIMIT)) {
+        return false;
+    }
+    return response.statusCode == 200 && response.body.size() == pageBytes && response.body.compare(0, 6, "<html>") == 0;
+}
+
+struct RunResult {
+    long ok = 0;
+    long failed = 0;
+    long connections = 0;
+    double seconds = 0;
+};
+
+static RunResult run(LoopbackServer& server, SequenceMode mode, bool useUring, long hosts, int concurrency, size_t pageBytes) {
+    std::atomic<long> remaining(hosts);
+    std::atomic<long> ok(0), failed(0);
+    std::vector<std::thread> threads;
+    long acceptedBefore = server.getAccepted();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < concurrency; t++) {
+        threads.emplace_back([&] {
+            Socket socket;
+#ifdef __linux__
+            if (useUring && !socket.enableUring()) {
+                failed += remaining.exchange(0);
+                return;
+            }
+#endif
+            socket.setKeepAlive(mode != SequenceMode::Close);
+            socket.resolveDNS("127.0.0.1");
+
+            HTTPResponse response;
+            while (remaining.fetch_sub(1) > 0) {
+                if (crawlHost(socket, server.getPort(), mode, pageBytes, response)) {
+                    ok++;
+                }
+                else {
+                    failed++;
+                }
+            }
+            socket.close();
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    RunResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.ok = ok;
+    result.failed = failed;
+    result.connections = server.getAccepted() - acceptedBefore;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    long hosts = argc > 1 ? atol(argv[1]) : 20000;
+    int concurrency = argc > 2 ? atoi(argv[2]) : 8;
+    size_t pageBytes = argc > 3 ? (size_t)atol(argv[3]) : 16 * 1024;
+
+    const SequenceMode modes[] = { SequenceMode::Close, SequenceMode::KeepAlive, SequenceMode::Pipeline };
+    bool allOk = true;
+
+    printf("%ld hosts, %d threads, %zu-byte pages\n", hosts, concurrency, pageBytes);
+    for (int chunked = 0; chunked < 2; chunked++) {
+        LoopbackServer server(2, pageBytes, chunked != 0);
+        if (!server.start()) {
+            printf("failed to start loopback server\n");
+            return 1;
+        }
+
+        for (int uring = 0; uring < 2; uring++) {
+#ifndef __linux__
+            if (uring) {
+                continue;
+            }
+#endif
+            for (SequenceMode mode : modes) {
+                RunResult r = run(server, mode, uring != 0, hosts, concurrency, pageBytes);
+                printf("%-14s %-8s %-10s %9.0f hosts/s %5.2f connections/host %6ld failed\n",
+                    chunked ? "chunked" : "content-length", uring ? "uring" : "blocking", modeName(mode),
+                    r.ok / r.seconds, (double)r.connections / hosts, r.failed);
+                if (r.failed > 0) {
+                    allOk = false;
+                }
+            }
+        }
+        server.stop();
+    }
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+// link extraction throughput on a corpus of real pages: the old HTMLParserBase
+// against LinkExtractor at each SIMD level this CPU has, in MB/s on one core.
+// Hand-written pages check resolution first; then every level must produce the
+// same bytes as the scalar scan, and the old parser's links must broadly show up
+// in the new output (they differ by design on dot segments, &amp; and "?query"
+// links, which the old parser resolved against the directory).
+//
+// usage: bench_link_extractor [corpusDir] [passes] [maxMB]
+// without a corpus directory, synthetic pages are generated instead
+
+#include "LinkExtractor.h"
+#include "HTMLParserBase.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#define DEFAULT_CORPUS "/usr/share/doc"
+
+struct Page {
+    std::string url;
+    std::string html;
+};
+
+static std::vector<std::string> links(const LinkArena& arena) {
+    std::vector<std::string> out;
+    const char* link = arena.bytes.data();
+    for (int i = 0; i < arena.count; i++) {
+        out.push_back(link);
+        link += out.back().size() + 1;
+    }
+    return out;
+}
+
+static bool expect(const char* html, const char* pageURL, const std::vector<std::string>& want) {
+    bool ok = true;
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+        LinkArena arena;
+        LinkExtractor(level).extract(html, pageURL, arena);
+        std::vector<std::string> got = links(arena);
+        if (got != want) {
+            printf("%s on %s:\n", LinkExtractor::levelName(level), html);
+            for (const std::string& link : got) {
+                printf("  got  %s\n", link.c_str());
+            }
+            for (const std::string& link : want) {
+                printf("  want %s\n", link.c_str());
+            }
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static bool checkPages() {
+    bool ok = true;
+    ok = expect("<a href=\"b.html\">x</a> <A HREF='/c'> <a class=x href=d?e=1&amp;f=2#top>",
+        "http://h.com/dir/a.html",
+        { "http://h.com/dir/b.html", "http://h.com/c", "http://h.com/dir/d?e=1&f=2" }) && ok;
+    ok = expect("<a href=\"../up/./x\"><a href=\"..\"><a href=\"?q=1\"><a href=\"#frag\"><a href=\"\">",
+        "http://h.com/a/b/c",
+        { "http://h.com/a/up/x", "http://h.com/a/", "http://h.com/a/b/c?q=1" }) && ok;
+    ok = expect("<a href=\"https://s.com/\"><a href=\"mailto:x@y\"><a href=\"javascript:void(0)\">"
+        "<a href=\"//other.com\"><a href=\"HTTP://Big.com/p\"><a href=\"http://q.com?x\">",
+        "http://h.com:8080/",
+        { "http://other.com/", "http://Big.com/p", "http://q.com/?x" }) && ok;
+    ok = expect("<abbr href=no><area shape=rect href=map><iframe src=\"f.html\"></iframe><frame src=g>"
+        "<base href=\"http://cdn.com/root/\"><a href=\"rel\"><a href=/abs><b>bold</b><img src=no.png>",
+        "http://h.com/x/",
+        { "http://h.com/x/map", "http://h.com/x/f.html", "http://h.com/x/g", "http://cdn.com/root/rel", "http://cdn.com/abs" }) && ok;
+    ok = expect("<a\nhref = \" spaced.html \"\n>text<a href=", "http://h.com",
+        { "http://h.com/spaced.html" }) && ok;
+
+    std::string longLink = "<a href=\"/" + std::string(LINK_MAX_URL, 'x') + "\"><a href=short>";
+    ok = expect(longLink.c_str(), "http://h.com/", { "http://h.com/short" }) && ok;
+
+    printf("hand-written pages: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static void loadCorpus(const std::string& dir, size_t maxBytes, std::vector<Page>& pages, size_t& bytes) {
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(dir, error), end; !error && it != end; it.increment(error)) {
+        std::string ext = it->path().extension().string();
+        if (!it->is_regular_file(error) || (ext != ".html" && ext != ".htm")) {
+            continue;
+        }
+        std::ifstream file(it->path(), std::ios::binary);
+        std::stringstream contents;
+        contents << file.rdbuf();
+
+        Page page;
+        page.url = "http://corpus.local/" + std::filesystem::relative(it->path(), dir, error).generic_string();
+        page.html = contents.str();
+        bytes += page.html.size();
+        pages.push_back(std::move(page));
+        if (bytes >= maxBytes) {
+            break;
+        }
+    }
+}
+
+// text-heavy pages with a few links of every kind
+static void syntheticCorpus(size_t maxBytes, std::vector<Page>& pages, size_t& bytes) {
+    static const char* words[] = { "crawler ", "frontier ", "<b>bold</b> ", "<p>", "</p>\n", "<div class=\"x\">", "</div>", "<img src=\"i.png\"> " };
+    std::mt19937 rng(18);
+    while (bytes < maxBytes) {
+        Page page;
+        page.url = "http://synthetic.local/dir" + std::to_string(pages.size() % 100) + "/page.html";
+        page.html = "<html><head><title>t</title></head><body>\n";
+        for (int i = 0; i < 2000; i++) {
+            switch (rng() % 40) {
+            case 0: page.html += "<a href=\"/abs/" + std::to_string(rng() % 1000) + ".html\">a</a> "; break;
+            case 1: page.html += "<a class=\"n\" href=\"../rel" + std::to_string(rng() % 1000) + "\">r</a> "; break;
+            case 2: page.html += "<a href=\"http://h" + std::to_string(rng() % 500) + ".com/\">h</a> "; break;
+            default: page.html += words[rng() % (sizeof(words) / sizeof(words[0]))]; break;
+            }
+        }
+        page.html += "</body></html>\n";
+        bytes += page.html.size();
+        pages.push_back(std::move(page));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string dir = argc > 1 ? argv[1] : DEFAULT_CORPUS;
+    int passes = argc > 2 ? atoi(argv[2]) : 5;
+    size_t maxBytes = (size_t)(argc > 3 ? atol(argv[3]) : 64) << 20;
+    bool ok = checkPages();
+
+    std::vector<Page> pages;
+    size_t bytes = 0;
+    loadCorpus(dir, maxBytes, pages, bytes);
+    if (pages.empty()) {
+        printf("no .html under %s, generating pages\n", dir.c_str());
+        syntheticCorpus(maxBytes, pages, bytes);
+    }
+    printf("%zu pages, %.1f MB, %d passes\n", pages.size(), bytes / 1e6, passes);
+
+    // old parser
+    HTMLParserBase parser;
+    long oldLinks = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (Page& page : pages) {
+            int nLinks = 0;
+            parser.Parse(&page.html[0], (int)page.html.size(), &page.url[0], (int)page.url.size(), &nLinks);
+            oldLinks += nLinks;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-14s %8.1f MB/s  %ld links per pass\n", "HTMLParserBase", bytes * (double)passes / seconds / 1e6, oldLinks / passes);
+
+    // each level the CPU supports, with scalar output kept to diff the others against
+    SimdLevel best = LinkExtractor::detect();
+    std::vector<std::vector<char>> reference(pages.size());
+    LinkArena arena;
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+        if (level > best) {
+            break;
+        }
+        LinkExtractor extractor(level);
+        long newLinks = 0;
+        start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; pass++) {
+            for (const Page& page : pages) {
+                arena.clear();
+                newLinks += extractor.extract(page.html, page.url, arena);
+            }
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%-14s %8.1f MB/s  %ld links per pass\n", LinkExtractor::levelName(level), bytes * (double)passes / seconds / 1e6, newLinks / passes);
+
+        long differ = 0;
+        for (size_t i = 0; i < pages.size(); i++) {
+            arena.clear();
+            extractor.extract(pages[i].html, pages[i].url, arena);
+            if (level == SimdLevel::Scalar) {
+                reference[i] = arena.bytes;
+            }
+            else if (arena.bytes != reference[i] && differ++ < 3) {
+                printf("%s differs from scalar on %s\n", LinkExtractor::levelName(level), pages[i].url.c_str());
+            }
+        }
+        ok = ok && differ == 0;
+    }
+
+    // how many of the old parser's links the new one finds too, once they are run
+    // back through the extractor to get the same dot segment and &amp; handling
+    LinkExtractor extractor(best);
+    long found = 0, total = 0;
+    for (size_t i = 0; i < pages.size(); i++) {
+        std::unordered_set<std::string> mine;
+        for (size_t at = 0; at < reference[i].size(); at += strlen(&reference[i][at]) + 1) {
+            mine.insert(&reference[i][at]);
+        }
+        int nLinks = 0;
+        const char* link = parser.Parse(&pages[i].html[0], (int)pages[i].html.size(), &pages[i].url[0], (int)pages[i].url.size(), &nLinks);
+        for (int j = 0; j < nLinks; j++, link += strlen(link) + 1) {
+            arena.clear();
+            extractor.extract("<a href=\"" + std::string(link) + "\">", pages[i].url, arena);
+            if (arena.count == 1 && mine.count(arena.bytes.data())) {
+                found++;
+            }
+            else if (total - found < 3) {
+                printf("old parser only: %s\n", link);
+            }
+            total++;
+        }
+    }
+    double agreement = total ? 100.0 * found / total : 100.0;
+    bool agrees = agreement >= 90;
+    printf("old parser's links also found: %.1f%%: %s\n", agreement, agrees ? "ok" : "FAILED");
+    return ok && agrees ? 0 : 1;
+}
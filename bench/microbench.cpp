@@ -0,0 +1,245 @@
+// Google Benchmark suite over the per-URL hot functions on their own: URL
+// parsing, the seen-host and seen-IP sets under contention, response framing and
+// status parsing, receive buffer growth, and link extraction on a fixed corpus.
+// Results are written as JSON with the library's own flags, so runs can be diffed
+// between commits:
+//
+//   bench_micro --benchmark_out=micro.json --benchmark_out_format=json
+//   bench_micro --benchmark_filter=SeenHosts --benchmark_repetitions=5
+//
+// Every input is generated from fixed seeds, so two builds see the same work.
+
+#include "Utility.h"
+#include "FingerprintSet.h"
+#include "IPSet.h"
+#include "Socket.h"
+#include "LinkExtractor.h"
+#include "HTMLParserBase.h"
+#include "LoopbackServer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// URLs shaped like extracted links: mostly plain, some with ports, queries,
+// fragments, userinfo or upper case
+static const std::vector<std::string>& urlCorpus() {
+    static std::vector<std::string> urls;
+    if (urls.empty()) {
+        std::mt19937 rng(24);
+        static const char* tlds[] = { ".com", ".org", ".edu", ".net", ".co.uk" };
+        for (int i = 0; i < 4096; i++) {
+            std::string url = rng() % 16 == 0 ? "HTTP://" : "http://";
+            if (rng() % 64 == 0) {
+                url += "user:pass@";
+            }
+            url += "www.site" + std::to_string(rng() % 100000) + tlds[rng() % 5];
+            if (rng() % 8 == 0) {
+                url += ":" + std::to_string(8000 + rng() % 100);
+            }
+            url += "/dir" + std::to_string(rng() % 50) + "/page" + std::to_string(i) + ".html";
+            if (rng() % 4 == 0) {
+                url += "?id=" + std::to_string(rng()) + "&sort=asc";
+            }
+            if (rng() % 16 == 0) {
+                url += "#section";
+            }
+            urls.push_back(url);
+        }
+    }
+    return urls;
+}
+
+static void BM_ParseURL(benchmark::State& state) {
+    const std::vector<std::string>& urls = urlCorpus();
+    URLParts parts;
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parseURL(urls[i++ & 4095], parts));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseURL);
+
+// what Crawler::checkAndInsertHost does, from several threads into one set. one
+// name in four repeats an earlier one, as with links to hosts already seen, and
+// once a thread has cycled through its names every insert finds its name there
+#define SEEN_NAMES (1 << 16)
+static std::unique_ptr<FingerprintSet> seenHosts;
+
+static void BM_SeenHosts(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        seenHosts.reset(new FingerprintSet());
+    }
+    std::vector<std::string> names;
+    for (long i = 0; i < SEEN_NAMES; i++) {
+        long id = (i % 4 == 3) ? i / 2 : i;
+        names.push_back("www.host" + std::to_string(id * 64 + state.thread_index()) + ".example.com");
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(seenHosts->insert(FingerprintSet::fingerprint(FingerprintKind::AdmittedHost, names[i++ & (SEEN_NAMES - 1)])));
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        seenHosts.reset();
+    }
+}
+BENCHMARK(BM_SeenHosts)->ThreadRange(1, 16)->UseRealTime();
+
+// what Crawler::checkAndInsertIP does, in each IPSet mode
+static std::unique_ptr<IPSet> seenIPs;
+
+static void BM_SeenIPs(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        seenIPs.reset(new IPSet(state.range(0) == 0 ? IPSetMode::Compact : IPSetMode::Bitmap));
+    }
+    std::mt19937 rng(24 + state.thread_index());
+    in_addr addr;
+    for (auto _ : state) {
+        // drawn from 2^24 addresses, so repeats grow as the set fills
+        addr.s_addr = rng() & 0x00ffffff;
+        benchmark::DoNotOptimize(seenIPs->insert(addr));
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        seenIPs.reset();
+    }
+}
+BENCHMARK(BM_SeenIPs)->Arg(0)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_SeenIPs)->Arg(1)->Threads(1)->Threads(8)->UseRealTime();
+
+static in_addr loopback() {
+    in_addr addr;
+    addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+// one keep-alive request and its framed, status-parsed response per iteration,
+// on a connection and buffer that are reused, so buffer growth is paid only once
+static void BM_ReceiveResponse(benchmark::State& state) {
+    LoopbackServer server(1, (size_t)state.range(0));
+    if (!server.start()) {
+        state.SkipWithError("cannot start the loopback server");
+        return;
+    }
+    Socket socket;
+    socket.setKeepAlive(true);
+    socket.setResolvedAddress(loopback());
+    HTTPResponse response;
+    int robots = 0;
+    for (auto _ : state) {
+        // the robots request gets a bodiless 404, the page a 200 with its Content-Length
+        bool ok = (socket.canReuse() || socket.connect("127.0.0.1", server.getPort())) &&
+            socket.sendHTTPRequest("127.0.0.1", (robots++ & 1) ? "/robots.txt" : "/page.html", "GET") && socket.receiveResponse(response, 4 << 20);
+        if (!ok || response.statusCode == 0) {
+            state.SkipWithError("request failed");
+            break;
+        }
+        benchmark::DoNotOptimize(response.statusCode);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ReceiveResponse)->Arg(512)->Arg(16 << 10)->Arg(256 << 10)->UseRealTime();
+
+// the same response into a fresh Socket each time, whose buffer has to double its
+// way up to the page size; against BM_ReceiveResponse, the difference is growth
+// (and the connect that a new socket needs)
+static void BM_BufferGrowth(benchmark::State& state) {
+    LoopbackServer server(1, (size_t)state.range(0));
+    if (!server.start()) {
+        state.SkipWithError("cannot start the loopback server");
+        return;
+    }
+    HTTPResponse response;
+    for (auto _ : state) {
+        Socket socket;
+        socket.setResolvedAddress(loopback());
+        if (!socket.connect("127.0.0.1", server.getPort()) || !socket.sendHTTPRequest("127.0.0.1", "/page.html", "GET") ||
+            !socket.receiveResponse(response, 4 << 20)) {
+            state.SkipWithError("request failed");
+            break;
+        }
+        benchmark::DoNotOptimize(response.raw.size());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BufferGrowth)->Arg(16 << 10)->Arg(256 << 10)->Arg(2 << 20)->UseRealTime();
+
+struct Page {
+    std::string url;
+    std::string html;
+};
+
+// 64 pages of about 40 KB of mixed markup, one link per 40 tokens or so
+static const std::vector<Page>& pageCorpus() {
+    static std::vector<Page> pages;
+    if (pages.empty()) {
+        static const char* words[] = { "crawler ", "frontier ", "<b>bold</b> ", "<p>", "</p>\n", "<div class=\"x\">", "</div>", "<img src=\"i.png\"> " };
+        std::mt19937 rng(24);
+        for (int p = 0; p < 64; p++) {
+            Page page;
+            page.url = "http://corpus.local/dir" + std::to_string(p) + "/page.html";
+            page.html = "<html><head><title>t</title></head><body>\n";
+            for (int i = 0; i < 3000; i++) {
+                switch (rng() % 40) {
+                case 0: page.html += "<a href=\"/abs/" + std::to_string(rng() % 1000) + ".html\">a</a> "; break;
+                case 1: page.html += "<a class=\"n\" href=\"../rel" + std::to_string(rng() % 1000) + "\">r</a> "; break;
+                case 2: page.html += "<a href=\"http://h" + std::to_string(rng() % 500) + ".com/\">h</a> "; break;
+                default: page.html += words[rng() % (sizeof(words) / sizeof(words[0]))]; break;
+                }
+            }
+            page.html += "</body></html>\n";
+            pages.push_back(std::move(page));
+        }
+    }
+    return pages;
+}
+
+static int64_t corpusBytes(const std::vector<Page>& pages) {
+    int64_t bytes = 0;
+    for (const Page& page : pages) {
+        bytes += (int64_t)page.html.size();
+    }
+    return bytes;
+}
+
+// LinkExtractor at Scalar, SSE2 and AVX2; levels the CPU lacks are skipped
+static void BM_LinkExtractor(benchmark::State& state) {
+    SimdLevel level = (SimdLevel)state.range(0);
+    if ((int)level > (int)LinkExtractor::detect()) {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    state.SetLabel(LinkExtractor::levelName(level));
+    const std::vector<Page>& pages = pageCorpus();
+    LinkExtractor extractor(level);
+    LinkArena arena;
+    for (auto _ : state) {
+        for (const Page& page : pages) {
+            arena.clear();
+            benchmark::DoNotOptimize(extractor.extract(page.html, page.url, arena));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * corpusBytes(pages));
+}
+BENCHMARK(BM_LinkExtractor)->DenseRange(0, 2);
+
+// the prebuilt parser LinkExtractor replaced, on the same pages
+static void BM_HTMLParserBase(benchmark::State& state) {
+    std::vector<Page> pages = pageCorpus();
+    HTMLParserBase parser;
+    int nLinks;
+    for (auto _ : state) {
+        for (Page& page : pages) {
+            benchmark::DoNotOptimize(parser.Parse(&page.html[0], (int)page.html.size(), &page.url[0], (int)page.url.size(), &nLinks));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * corpusBytes(pages));
+}
+BENCHMARK(BM_HTMLParserBase);
+
+BENCHMARK_MAIN();
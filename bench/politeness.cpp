@@ -0,0 +1,244 @@
+// TimerWheel and PolitenessScheduler. The wheel is first run against a sorted
+// reference through random schedule/cancel/advance steps and must fire exactly
+// the same timers at every step. Then schedule + expire cost per timer is timed
+// for the wheel and a std::multimap as the number of pending timers grows. Last,
+// worker threads drain hosts spread over a few IPs through the scheduler. The run
+// fails if two hosts on one IP ever overlap or start less than the delay apart.
+//
+// usage: bench_politeness [timers] [threads] [ips] [hostsPerIp] [delayMs]
+
+#include "PolitenessScheduler.h"
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#define WAIT_MS 50
+
+typedef std::chrono::steady_clock Clock;
+
+// random operations against a std::set of (expires, id); false on the first disagreement
+static bool differential(long steps) {
+    std::mt19937_64 rng(11);
+    const size_t numNodes = 4096;
+    std::vector<TimerNode> nodes(numNodes);
+    std::set<std::pair<uint64_t, size_t>> reference;
+    std::vector<TimerNode*> expired;
+    std::vector<size_t> fired, expected;
+
+    // start just short of a level-2 boundary so cascades happen early
+    uint64_t now = (1 << 16) - 300;
+    TimerWheel wheel(now);
+    for (size_t i = 0; i < numNodes; i++) {
+        nodes[i].data = (void*)i;
+    }
+
+    // delays spread over every level of the wheel
+    static const uint64_t spans[] = { 16, 256, 4096, 1 << 16, 1 << 20, 1 << 24 };
+    for (long step = 0; step < steps; step++) {
+        size_t i = rng() % numNodes;
+        int op = rng() % 8;
+        if (op < 5) {
+            uint64_t expires = now + rng() % spans[rng() % 6];
+            if (nodes[i].pending()) {
+                reference.erase({ nodes[i].expires, i });
+            }
+            wheel.schedule(&nodes[i], expires);
+            reference.insert({ std::max(expires, now + 1), i });
+        }
+        else if (op < 6) {
+            if (nodes[i].pending()) {
+                reference.erase({ nodes[i].expires, i });
+            }
+            wheel.cancel(&nodes[i]);
+        }
+        else {
+            // mostly short hops, sometimes a long jump across several cascades
+            uint64_t hop = (op == 6) ? rng() % 300 : rng() % (1 << 18);
+
+            // the bound may be early but never late
+            uint64_t bound = wheel.nextExpiry();
+            if (!reference.empty() && bound > reference.begin()->first) {
+                printf("step %ld: nextExpiry %llu after the first timer at %llu\n", step,
+                    (unsigned long long)bound, (unsigned long long)reference.begin()->first);
+                return false;
+            }
+
+            now += hop;
+            expired.clear();
+            wheel.advance(now, expired);
+
+            fired.clear();
+            for (TimerNode* node : expired) {
+                fired.push_back((size_t)node->data);
+            }
+            expected.clear();
+            while (!reference.empty() && reference.begin()->first <= now) {
+                expected.push_back(reference.begin()->second);
+                reference.erase(reference.begin());
+            }
+            std::sort(fired.begin(), fired.end());
+            std::sort(expected.begin(), expected.end());
+            if (fired != expected) {
+                printf("step %ld: advancing to %llu fired %zu timers, expected %zu\n", step,
+                    (unsigned long long)now, fired.size(), expected.size());
+                return false;
+            }
+        }
+        if (wheel.size() != reference.size()) {
+            printf("step %ld: wheel holds %zu timers, expected %zu\n", step, wheel.size(), reference.size());
+            return false;
+        }
+    }
+    return true;
+}
+
+// schedule count timers up to ten minutes out, then run time forward until all fire
+static double timeWheel(size_t count, std::vector<uint64_t>& delays) {
+    std::vector<TimerNode> nodes(count);
+    std::vector<TimerNode*> expired;
+    expired.reserve(count);
+    TimerWheel wheel(0);
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; i++) {
+        wheel.schedule(&nodes[i], delays[i]);
+    }
+    for (uint64_t now = 0; wheel.size() > 0; now += 10) {
+        wheel.advance(now, expired);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return expired.size() == count ? seconds : -1;
+}
+
+static double timeMultimap(size_t count, std::vector<uint64_t>& delays) {
+    std::multimap<uint64_t, size_t> timers;
+    size_t fired = 0;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; i++) {
+        timers.emplace(delays[i], i);
+    }
+    for (uint64_t now = 0; !timers.empty(); now += 10) {
+        while (!timers.empty() && timers.begin()->first <= now) {
+            timers.erase(timers.begin());
+            fired++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return fired == count ? seconds : -1;
+}
+
+struct IPLog {
+    std::mutex lock;
+    bool busy = false;
+    Clock::time_point lastEnd;
+    long visits = 0;
+    double minGapMs = 1e9;
+};
+
+int main(int argc, char* argv[]) {
+    size_t maxTimers = argc > 1 ? (size_t)atol(argv[1]) : 2000000;
+    int threads = argc > 2 ? atoi(argv[2]) : 8;
+    int numIps = argc > 3 ? atoi(argv[3]) : 50;
+    int hostsPerIp = argc > 4 ? atoi(argv[4]) : 20;
+    int delayMs = argc > 5 ? atoi(argv[5]) : 20;
+    bool allOk = true;
+
+    // correctness of the wheel itself
+    bool wheelOk = differential(2000000);
+    printf("differential vs std::set: %s\n", wheelOk ? "ok" : "FAILED");
+    allOk = allOk && wheelOk;
+
+    // cost per timer as the pending count grows
+    std::mt19937_64 rng(3);
+    for (size_t count = 1000; count <= maxTimers; count *= 10) {
+        std::vector<uint64_t> delays(count);
+        for (uint64_t& d : delays) {
+            d = 1 + rng() % (10 * 60 * 1000);
+        }
+        double wheelSeconds = timeWheel(count, delays);
+        double mapSeconds = timeMultimap(count, delays);
+        printf("%8zu timers  wheel %7.1f ns/timer  multimap %7.1f ns/timer\n", count,
+            wheelSeconds * 1e9 / count, mapSeconds * 1e9 / count);
+        allOk = allOk && wheelSeconds >= 0 && mapSeconds >= 0;
+    }
+
+    // spacing per IP through the scheduler
+    long total = (long)numIps * hostsPerIp;
+    PolitenessScheduler scheduler(delayMs, total);
+    std::vector<IPLog> logs(numIps);
+    for (int h = 0; h < hostsPerIp; h++) {
+        for (int ip = 0; ip < numIps; ip++) {
+            CrawlJob job;
+            job.host = "h" + std::to_string(ip) + "-" + std::to_string(h);
+            job.request = "/";
+            job.addr.s_addr = htonl(0x7f000001 + ip);
+            scheduler.submit(std::move(job));
+        }
+    }
+
+    std::atomic<long> finished(0), overlaps(0);
+    std::vector<std::thread> workers;
+    auto start = Clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            CrawlJob job;
+            while (finished.load() < total) {
+                if (!scheduler.tryNext(job)) {
+                    scheduler.wait(WAIT_MS);
+                    continue;
+                }
+                IPLog& log = logs[ntohl(job.addr.s_addr) - 0x7f000001];
+                {
+                    std::lock_guard<std::mutex> guard(log.lock);
+                    Clock::time_point now = Clock::now();
+                    if (log.busy) {
+                        overlaps++;
+                    }
+                    if (log.visits > 0) {
+                        log.minGapMs = std::min(log.minGapMs, std::chrono::duration<double, std::milli>(now - log.lastEnd).count());
+                    }
+                    log.busy = true;
+                    log.visits++;
+                }
+
+                // a short "crawl"
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                {
+                    std::lock_guard<std::mutex> guard(log.lock);
+                    log.busy = false;
+                    log.lastEnd = Clock::now();
+                }
+                scheduler.done(job.addr, 0);
+                finished++;
+            }
+        });
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    double minGap = 1e9;
+    for (const IPLog& log : logs) {
+        minGap = std::min(minGap, log.minGapMs);
+    }
+    // hostsPerIp visits per IP need hostsPerIp - 1 gaps of at least the delay
+    double floorSeconds = (hostsPerIp - 1) * delayMs / 1000.0;
+    bool spacingOk = overlaps == 0 && minGap >= delayMs;
+    printf("%d threads, %d IPs x %d hosts, %d ms delay: %.2f s (floor %.2f s), smallest gap %.2f ms, %ld overlaps: %s\n",
+        threads, numIps, hostsPerIp, delayMs, seconds, floorSeconds, minGap, overlaps.load(), spacingOk ? "ok" : "FAILED");
+    allOk = allOk && spacingOk;
+
+    return allOk ? 0 : 1;
+}
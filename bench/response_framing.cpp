@@ -0,0 +1,117 @@
+// time to the end of a response from a server that lingers after answering:
+// the old reader, which waits for the peer to close, versus Socket's framed
+// reader, which stops at the end of the headers for HEAD and at Content-Length
+// for GET. Both run the crawler's HEAD /robots.txt + GET / sequence per host.
+//
+// usage: bench_response_framing [hosts] [lingerMs]
+
+#include "LoopbackServer.h"
+#include "Socket.h"
+
+#include <poll.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define PAGE_BYTES (16 * 1024)
+#define ROBOTS_LIMIT (16 * 1024)
+#define PAGE_LIMIT (2 * 1024 * 1024)
+
+typedef std::chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// the reader as it was before: one request per connection, read until recv returns 0
+static bool legacyFetch(int port, const char* method, const char* path, std::string& response) {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET) {
+        return false;
+    }
+    sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::string request = std::string(method) + " " + path + " HTTP/1.0\r\nHost: 127.0.0.1\r\nConnection: close\r\n"
+        "User-agent: ahmadCrawler/1.3\r\n\r\n";
+    bool ok = ::connect(sock, (sockaddr*)&server, sizeof(server)) == 0 &&
+        send(sock, request.data(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size();
+
+    response.clear();
+    char chunk[4096];
+    while (ok) {
+        pollfd pfd = { sock, POLLIN, 0 };
+        if (poll(&pfd, 1, 10000) <= 0) {
+            ok = false;
+            break;
+        }
+        ssize_t got = recv(sock, chunk, sizeof(chunk), 0);
+        if (got <= 0) {
+            ok = got == 0;
+            break;
+        }
+        response.append(chunk, got);
+    }
+    closesocket(sock);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    long hosts = argc > 1 ? atol(argv[1]) : 20;
+    int lingerMs = argc > 2 ? atoi(argv[2]) : 100;
+
+    LoopbackServer server(1, PAGE_BYTES);
+    server.setLinger(lingerMs);
+    if (!server.start()) {
+        printf("failed to start loopback server\n");
+        return 1;
+    }
+    int port = server.getPort();
+    printf("%ld hosts, server lingers %d ms after each response\n", hosts, lingerMs);
+
+    // old reader
+    double legacyRobots = 0, legacyPage = 0;
+    long legacyOk = 0;
+    std::string response;
+    for (long i = 0; i < hosts; i++) {
+        auto start = Clock::now();
+        bool ok = legacyFetch(port, "HEAD", "/robots.txt", response);
+        legacyRobots += msSince(start);
+
+        start = Clock::now();
+        ok = ok && legacyFetch(port, "GET", "/", response) && response.size() > PAGE_BYTES;
+        legacyPage += msSince(start);
+        legacyOk += ok;
+    }
+
+    // framed reader
+    double framedRobots = 0, framedPage = 0;
+    long framedOk = 0;
+    Socket socket;
+    socket.resolveDNS("127.0.0.1");
+    HTTPResponse parsed;
+    for (long i = 0; i < hosts; i++) {
+        auto start = Clock::now();
+        bool ok = socket.connect("127.0.0.1", port) && socket.sendHTTPRequest("127.0.0.1", "/robots.txt", "HEAD") &&
+            socket.receiveResponse(parsed, ROBOTS_LIMIT) && parsed.statusCode == 404;
+        framedRobots += msSince(start);
+
+        start = Clock::now();
+        ok = ok && socket.connect("127.0.0.1", port) && socket.sendHTTPRequest("127.0.0.1", "/", "GET") &&
+            socket.receiveResponse(parsed, PAGE_LIMIT) && parsed.body.size() == PAGE_BYTES;
+        framedPage += msSince(start);
+        framedOk += ok;
+    }
+    socket.close();
+
+    printf("read to EOF   %8.2f ms robots %8.2f ms page  %ld/%ld ok\n", legacyRobots / hosts, legacyPage / hosts, legacyOk, hosts);
+    printf("framed        %8.2f ms robots %8.2f ms page  %ld/%ld ok\n", framedRobots / hosts, framedPage / hosts, framedOk, hosts);
+
+    server.stop();
+    return (legacyOk == hosts && framedOk == hosts) ? 0 : 1;
+}
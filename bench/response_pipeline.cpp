@@ -0,0 +1,109 @@
+// bytes copied and time spent per page between the socket buffer and the link
+// parser: the old pipeline (response string, body substr, mutable vector copy)
+// against HTTPResponse views parsed in place. each page is fetched once from a
+// loopback server, then both pipelines run over the same received buffer
+//
+// usage: bench_response_pipeline [pagesPerSize] [rounds]
+
+#include "LoopbackServer.h"
+#include "Socket.h"
+#include "HTMLParserBase.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct PipelineResult {
+    long long copied = 0;
+    long links = 0;
+    double seconds = 0;
+};
+
+// what Crawler::Run and processPage did before the views
+static void legacyPipeline(HTMLParserBase& parser, const HTTPResponse& received, PipelineResult& result) {
+    std::string response(received.raw);
+    result.copied += response.size();
+
+    size_t headerEnd = response.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        return;
+    }
+    std::string htmlBody = response.substr(headerEnd + 4);
+    result.copied += htmlBody.size();
+
+    std::vector<char> modifiableHtmlBody(htmlBody.begin(), htmlBody.end());
+    modifiableHtmlBody.push_back('\0');
+    result.copied += modifiableHtmlBody.size();
+
+    std::string baseUrlStr = "http://127.0.0.1";
+    std::vector<char> baseUrl(baseUrlStr.begin(), baseUrlStr.end());
+    baseUrl.push_back('\0');
+
+    int nLinks = 0;
+    parser.Parse((char*)htmlBody.c_str(), (int)htmlBody.length(), (char*)baseUrlStr.c_str(), (int)baseUrl.size(), &nLinks);
+    result.links += nLinks;
+}
+
+static void viewPipeline(HTMLParserBase& parser, const HTTPResponse& received, PipelineResult& result) {
+    std::string baseUrlStr = "http://127.0.0.1";
+    int nLinks = 0;
+    parser.Parse(const_cast<char*>(received.body.data()), (int)received.body.length(), (char*)baseUrlStr.c_str(), (int)baseUrlStr.length(), &nLinks);
+    result.links += nLinks;
+}
+
+int main(int argc, char* argv[]) {
+    int pages = argc > 1 ? atoi(argv[1]) : 20;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+    const size_t sizes[] = { 16 * 1024, 256 * 1024, 2 * 1024 * 1024 };
+
+    HTMLParserBase parser;
+    printf("%10s %18s %12s %18s %12s\n", "page", "legacy copied/pg", "legacy us/pg", "views copied/pg", "views us/pg");
+
+    for (size_t pageBytes : sizes) {
+        LoopbackServer server(1, pageBytes);
+        if (!server.start()) {
+            printf("failed to start the loopback server\n");
+            return 1;
+        }
+
+        Socket socket;
+        socket.resolveDNS("127.0.0.1");
+        PipelineResult legacy, views;
+        long fetched = 0;
+
+        for (int i = 0; i < pages; i++) {
+            HTTPResponse response;
+            if (!socket.connect("127.0.0.1", server.getPort()) ||
+                !socket.sendHTTPRequest("127.0.0.1", "/", "GET") ||
+                !socket.receiveResponse(response, 64 * 1024 * 1024) ||
+                response.statusCode != 200) {
+                continue;
+            }
+            fetched++;
+
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < rounds; r++) {
+                legacyPipeline(parser, response, legacy);
+            }
+            auto middle = std::chrono::steady_clock::now();
+            for (int r = 0; r < rounds; r++) {
+                viewPipeline(parser, response, views);
+            }
+            auto end = std::chrono::steady_clock::now();
+            legacy.seconds += std::chrono::duration<double>(middle - start).count();
+            views.seconds += std::chrono::duration<double>(end - middle).count();
+        }
+        server.stop();
+
+        if (fetched == 0 || legacy.links != views.links) {
+            printf("%zu-byte pages: fetched %ld, links legacy %ld views %ld\n", pageBytes, fetched, legacy.links, views.links);
+            return 1;
+        }
+        double runs = (double)fetched * rounds;
+        printf("%9zuK %18.0f %12.1f %18.0f %12.1f\n", pageBytes / 1024,
+            legacy.copied / runs, legacy.seconds * 1e6 / runs, views.copied / runs, views.seconds * 1e6 / runs);
+    }
+    return 0;
+}
@@ -0,0 +1,223 @@
+// robots.txt matching. A handful of hand-written files check group selection,
+// Crawl-delay and the longest-match rule; then random rule sets with '*' and '$'
+// are diffed against a backtracking reference matcher, and both are timed on
+// paths of a typical length. Last, a rule set whose DFA would outgrow its limits
+// within one path checks the switch to the NFA partway through the walk.
+//
+// usage: bench_robots [ruleSets] [rulesPerSet] [paths]
+
+#include "RobotsRules.h"
+#include "Socket.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+struct RefRule {
+    std::string pattern;
+    bool allow;
+};
+
+// whether pattern matches a prefix of path ('$' at the end: all of it)
+static bool refMatch(const char* p, const char* s) {
+    if (*p == '\0') {
+        return true;
+    }
+    if (*p == '$' && p[1] == '\0') {
+        return *s == '\0';
+    }
+    if (*p == '*') {
+        for (const char* t = s; ; t++) {
+            if (refMatch(p + 1, t)) {
+                return true;
+            }
+            if (*t == '\0') {
+                return false;
+            }
+        }
+    }
+    return *s != '\0' && *p == *s && refMatch(p + 1, s + 1);
+}
+
+static bool refAllowed(const std::vector<RefRule>& rules, const std::string& path) {
+    int best = -1;
+    bool allow = true;
+    for (const RefRule& rule : rules) {
+        int length = (int)rule.pattern.size();
+        if (refMatch(rule.pattern.c_str(), path.c_str()) && (length > best || (length == best && rule.allow))) {
+            best = length;
+            allow = rule.allow;
+        }
+    }
+    return allow;
+}
+
+static bool expect(const char* what, bool got, bool want) {
+    if (got != want) {
+        printf("%s: got %d, want %d: FAILED\n", what, got, want);
+    }
+    return got == want;
+}
+
+static bool checkFiles() {
+    bool ok = true;
+    auto rules = RobotsRules::parse(
+        "User-agent: *\n"
+        "Disallow: /\n"
+        "\n"
+        "User-agent: other\n"
+        "User-agent: AhmadCrawler/1.3   # us\n"
+        "Allow: /public\n"
+        "Disallow: /public/private\n"
+        "Disallow: /*.pdf$\n"
+        "Allow: /page\n"
+        "Disallow: /page\n"
+        "Crawl-delay: 1.5\n"
+        "Sitemap: http://example.com/sitemap.xml\n", "ahmadCrawler");
+    ok = expect("group for us, not '*'", rules->allowed("/index.html"), true) && ok;
+    ok = expect("longer disallow wins", rules->allowed("/public/private/x"), false) && ok;
+    ok = expect("allow prefix", rules->allowed("/public/x"), true) && ok;
+    ok = expect("anchored wildcard", rules->allowed("/docs/a.pdf"), false) && ok;
+    ok = expect("anchored wildcard, not at end", rules->allowed("/docs/a.pdf?x=1"), true) && ok;
+    ok = expect("tie goes to allow", rules->allowed("/page"), true) && ok;
+    ok = expect("crawl-delay", rules->getCrawlDelayMs() == 1500, true) && ok;
+
+    rules = RobotsRules::parse("User-agent: somebot\nDisallow: /\n\nUser-agent: *\nDisallow: /tmp/\n", "ahmadCrawler");
+    ok = expect("fallback to '*'", rules->allowed("/tmp/a"), false) && ok;
+    ok = expect("fallback to '*', other path", rules->allowed("/a"), true) && ok;
+
+    rules = RobotsRules::parse("User-agent: *\nDisallow:\n", "ahmadCrawler");
+    ok = expect("empty disallow", rules->allowed("/a"), true) && ok;
+
+    HTTPResponse response;
+    response.statusCode = 404;
+    ok = expect("404 allows", RobotsRules::fromResponse(response, "ahmadCrawler")->allowed("/a"), true) && ok;
+    response.statusCode = 503;
+    ok = expect("503 disallows", RobotsRules::fromResponse(response, "ahmadCrawler")->allowed("/a"), false) && ok;
+
+    printf("robots.txt files: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// paths and patterns over a small alphabet so rules actually overlap
+static std::string randomPath(std::mt19937& rng, int length) {
+    static const char alphabet[] = "/ab.?=x";
+    std::string path = "/";
+    for (int i = 1; i < length; i++) {
+        path += alphabet[rng() % (sizeof(alphabet) - 1)];
+    }
+    return path;
+}
+
+static std::string randomPattern(std::mt19937& rng) {
+    std::string pattern = randomPath(rng, 1 + rng() % 6);
+    for (int stars = rng() % 3; stars > 0; stars--) {
+        pattern.insert(1 + rng() % pattern.size(), "*");
+    }
+    if (rng() % 4 == 0) {
+        pattern += '$';
+    }
+    return pattern;
+}
+
+// 256 rules of "/*" then 24 random bytes of a and b: every state holds hundreds
+// of positions and there are thousands of states, so one long random path runs
+// past the limits partway through
+static bool checkFallback(std::mt19937& rng) {
+    std::vector<RefRule> ref;
+    std::string file = "User-agent: *\n";
+    for (int i = 0; i < 256; i++) {
+        RefRule rule;
+        rule.pattern = "/*";
+        for (int j = 0; j < 24; j++) {
+            rule.pattern += "ab"[rng() % 2];
+        }
+        rule.allow = i % 2 == 0;
+        ref.push_back(rule);
+        file += (rule.allow ? "Allow: " : "Disallow: ") + rule.pattern + "\n";
+    }
+    auto rules = RobotsRules::parse(file, "ahmadCrawler");
+
+    bool ok = true;
+    std::string path = "/";
+    for (int i = 0; i < 200000; i++) {
+        path += "ab"[rng() % 2];
+    }
+    // the long path first, so the limit is passed during a walk rather than between two
+    for (int i = 0; i < 200; i++) {
+        std::string tested = i == 0 ? path : path.substr(0, 1 + rng() % 200);
+        if (rules->allowed(tested) != refAllowed(ref, tested)) {
+            ok = false;
+        }
+    }
+    if (rules->getStateCount() != 0) {
+        ok = false;
+    }
+    printf("DFA past its limits: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    int ruleSets = argc > 1 ? atoi(argv[1]) : 2000;
+    int rulesPerSet = argc > 2 ? atoi(argv[2]) : 20;
+    int paths = argc > 3 ? atoi(argv[3]) : 2000;
+    bool allOk = checkFiles();
+
+    std::mt19937 rng(17);
+    long checked = 0, mismatches = 0, states = 0;
+    double compileSeconds = 0, compiledSeconds = 0, refSeconds = 0;
+    std::vector<std::string> testPaths;
+
+    for (int set = 0; set < ruleSets; set++) {
+        std::vector<RefRule> ref;
+        std::string file = "User-agent: *\n";
+        for (int i = 0; i < rulesPerSet; i++) {
+            RefRule rule;
+            rule.pattern = randomPattern(rng);
+            rule.allow = rng() % 2 == 0;
+            ref.push_back(rule);
+            file += (rule.allow ? "Allow: " : "Disallow: ") + rule.pattern + "\n";
+        }
+        auto compileStart = std::chrono::steady_clock::now();
+        auto rules = RobotsRules::parse(file, "ahmadCrawler");
+        compileSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - compileStart).count();
+
+        testPaths.clear();
+        for (int i = 0; i < paths; i++) {
+            testPaths.push_back(randomPath(rng, 1 + rng() % 60));
+        }
+
+        std::vector<char> got(testPaths.size()), want(testPaths.size());
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < testPaths.size(); i++) {
+            got[i] = rules->allowed(testPaths[i]);
+        }
+        auto middle = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < testPaths.size(); i++) {
+            want[i] = refAllowed(ref, testPaths[i]);
+        }
+        auto end = std::chrono::steady_clock::now();
+        compiledSeconds += std::chrono::duration<double>(middle - start).count();
+        refSeconds += std::chrono::duration<double>(end - middle).count();
+
+        for (size_t i = 0; i < testPaths.size(); i++) {
+            if (got[i] != want[i] && mismatches++ < 5) {
+                printf("mismatch on %s:\n%s", testPaths[i].c_str(), file.c_str());
+            }
+        }
+        checked += (long)testPaths.size();
+        states += (long)rules->getStateCount();
+    }
+
+    bool ok = mismatches == 0;
+    printf("%d rule sets of %d rules, %.0f DFA states built on average\n", ruleSets, rulesPerSet, (double)states / ruleSets);
+    printf("parse      %8.1f us/file\n", compileSeconds * 1e6 / ruleSets);
+    printf("compiled   %8.1f ns/path\n", compiledSeconds * 1e9 / checked);
+    printf("reference  %8.1f ns/path\n", refSeconds * 1e9 / checked);
+    printf("%ld paths diffed, %ld mismatches: %s\n", checked, mismatches, ok ? "ok" : "FAILED");
+    allOk = checkFallback(rng) && allOk;
+    return allOk && ok ? 0 : 1;
+}
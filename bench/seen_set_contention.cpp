@@ -0,0 +1,107 @@
+// contention on the crawler's seen-host set: the old single mutex around an
+// unordered_set versus ShardedSet and the FingerprintSet that replaced it, at
+// 1..1024 threads inserting host names where about one in four is a duplicate
+//
+// usage: bench_seen_set_contention [insertsPerRun] [maxThreads]
+
+#include "ShardedSet.h"
+#include "FingerprintSet.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// what Crawler used before: one lock guarding one set
+class LockedSet {
+    public:
+        bool insert(const std::string& key) {
+            std::lock_guard<std::mutex> guard(lock);
+            return keys.insert(key).second;
+        }
+
+    private:
+        std::mutex lock;
+        std::unordered_set<std::string> keys;
+};
+
+// what Crawler::checkAndInsertHost does now
+class FingerprintHosts {
+    public:
+        bool insert(const std::string& key) {
+            return set.insert(FingerprintSet::fingerprint(FingerprintKind::AdmittedHost, key));
+        }
+
+    private:
+        FingerprintSet set;
+};
+
+template <typename Set>
+static double run(const std::vector<std::string>& names, int numThreads, long& inserted) {
+    Set set;
+    std::vector<long> counts(numThreads, 0);
+    std::vector<std::thread> threads;
+    size_t perThread = names.size() / numThreads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t] {
+            size_t begin = t * perThread;
+            long count = 0;
+            for (size_t i = begin; i < begin + perThread; i++) {
+                count += set.insert(names[i]);
+            }
+            counts[t] = count;
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    inserted = 0;
+    for (long count : counts) {
+        inserted += count;
+    }
+    return seconds;
+}
+
+int main(int argc, char* argv[]) {
+    long total = argc > 1 ? atol(argv[1]) : 1000000;
+    int maxThreads = argc > 2 ? atoi(argv[2]) : 1024;
+
+    // every fourth name repeats an earlier one, like links to hosts already seen
+    std::vector<std::string> names;
+    names.reserve(total);
+    for (long i = 0; i < total; i++) {
+        long id = (i % 4 == 3) ? i / 2 : i;
+        names.push_back("www.host" + std::to_string(id) + ".example.com");
+    }
+
+    // spread the duplicates across threads instead of keeping them next to their originals
+    for (long i = total - 1; i > 0; i--) {
+        std::swap(names[i], names[(size_t)(i * 2654435761u) % (size_t)(i + 1)]);
+    }
+
+    printf("%ld inserts per run, %u hardware threads\n", total, std::thread::hardware_concurrency());
+    printf("%8s %14s %14s %14s %8s\n", "threads", "locked Mops/s", "sharded Mops/s", "fprint Mops/s", "speedup");
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        long lockedInserted, shardedInserted, fingerprintInserted;
+        double locked = run<LockedSet>(names, numThreads, lockedInserted);
+        double sharded = run<ShardedSet<std::string>>(names, numThreads, shardedInserted);
+        double fingerprint = run<FingerprintHosts>(names, numThreads, fingerprintInserted);
+        if (lockedInserted != shardedInserted || lockedInserted != fingerprintInserted) {
+            printf("mismatch: locked kept %ld names, sharded %ld, fingerprint %ld\n", lockedInserted, shardedInserted, fingerprintInserted);
+            return 1;
+        }
+
+        // speedup of what the crawler uses now over the single lock
+        long ops = (long)(names.size() / numThreads) * numThreads;
+        printf("%8d %14.2f %14.2f %14.2f %7.2fx\n", numThreads, ops / locked / 1e6, ops / sharded / 1e6, ops / fingerprint / 1e6, locked / fingerprint);
+    }
+    return 0;
+}
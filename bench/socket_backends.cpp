@@ -0,0 +1,228 @@
+// compares the Socket backends against a loopback server:
+//   blocking - one thread per connection, poll + recv per segment
+//   uring    - one thread per connection, linked connect/send + multishot recv;
+//              a ring per connection batches nothing, so expect blocking's numbers
+//   epoll    - one thread multiplexing every connection with the non-blocking API
+//
+// usage: bench_socket_backends [requests] [concurrency] [pageBytes]
+
+#include "LoopbackServer.h"
+#include "Socket.h"
+
+#include <sys/epoll.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct RunResult {
+    long ok = 0;
+    long failed = 0;
+    long long bytes = 0;
+    double seconds = 0;
+    double cpuSeconds = 0;  // client threads only
+};
+
+static double threadCpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static RunResult runThreaded(int port, long requests, int concurrency, bool useUring) {
+    std::atomic<long> remaining(requests);
+    std::atomic<long> ok(0), failed(0);
+    std::atomic<long long> bytes(0);
+    std::vector<double> cpu(concurrency, 0.0);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < concurrency; t++) {
+        threads.emplace_back([&, t] {
+            double cpuStart = threadCpuSeconds();
+            Socket socket;
+            if (useUring && !socket.enableUring()) {
+                failed += remaining.exchange(0);
+                return;
+            }
+            socket.resolveDNS("127.0.0.1");
+
+            HTTPResponse response;
+            while (remaining.fetch_sub(1) > 0) {
+                if (socket.connect("127.0.0.1", port) &&
+                    socket.sendHTTPRequest("127.0.0.1", "/", "GET") &&
+                    socket.receiveResponse(response, 64 * 1024 * 1024) &&
+                    response.statusCode == 200) {
+                    ok++;
+                    bytes += response.raw.size();
+                }
+                else {
+                    failed++;
+                }
+            }
+            socket.close();
+            cpu[t] = threadCpuSeconds() - cpuStart;
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    RunResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.ok = ok;
+    result.failed = failed;
+    result.bytes = bytes;
+    for (double c : cpu) {
+        result.cpuSeconds += c;
+    }
+    return result;
+}
+
+static RunResult runEpoll(int port, long requests, int concurrency) {
+    RunResult result;
+    int epfd = epoll_create1(0);
+    std::vector<Socket> sockets(concurrency);
+    std::vector<int> state(concurrency, 0);  // 0 idle, 1 connecting/sending, 2 reading
+    HTTPResponse response;
+    long started = 0;
+
+    auto begin = [&](int i) -> bool {
+        Socket& s = sockets[i];
+        if (!s.startConnect(port)) {
+            return false;
+        }
+        s.queueHTTPRequest("127.0.0.1", "/", "GET");
+        s.resetResponse();
+        state[i] = 1;
+        epoll_event ev;
+        ev.events = EPOLLOUT;
+        ev.data.u32 = i;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, s.getHandle(), &ev);
+        return true;
+    };
+    auto done = [&](int i, bool success) {
+        Socket& s = sockets[i];
+        if (success) {
+            s.parseResponse(response);
+            if (response.statusCode == 200) {
+                result.ok++;
+                result.bytes += response.raw.size();
+            }
+            else {
+                result.failed++;
+            }
+        }
+        else {
+            result.failed++;
+        }
+        s.close();
+        state[i] = 0;
+        while (started < requests) {
+            started++;
+            if (begin(i)) {
+                break;
+            }
+            result.failed++;
+        }
+    };
+
+    double cpuStart = threadCpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < concurrency; i++) {
+        sockets[i].resolveDNS("127.0.0.1");
+    }
+    for (int i = 0; i < concurrency && started < requests; i++) {
+        started++;
+        if (!begin(i)) {
+            done(i, false);
+        }
+    }
+
+    epoll_event events[256];
+    while (result.ok + result.failed < requests) {
+        int n = epoll_wait(epfd, events, 256, 1000);
+        if (n <= 0) {
+            break;
+        }
+        for (int e = 0; e < n; e++) {
+            int i = (int)events[e].data.u32;
+            Socket& s = sockets[i];
+            if (state[i] == 1) {
+                if (!s.finishConnect()) {
+                    done(i, false);
+                    continue;
+                }
+                int ret = s.flushRequest();
+                if (ret < 0) {
+                    done(i, false);
+                }
+                else if (ret > 0) {
+                    state[i] = 2;
+                    epoll_event ev;
+                    ev.events = EPOLLIN;
+                    ev.data.u32 = i;
+                    epoll_ctl(epfd, EPOLL_CTL_MOD, s.getHandle(), &ev);
+                }
+            }
+            else if (state[i] == 2) {
+                int ret = s.readSome(64 * 1024 * 1024);
+                if (ret != 0) {
+                    done(i, ret > 0);
+                }
+            }
+        }
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.cpuSeconds = threadCpuSeconds() - cpuStart;
+    close(epfd);
+    return result;
+}
+
+static void report(const char* name, const RunResult& r) {
+    double total = (double)(r.ok + r.failed);
+    printf("%-9s %9.0f req/s %9.1f MB/s %8.1f us CPU/req %7ld failed\n",
+        name,
+        r.ok / r.seconds,
+        r.bytes / (1024.0 * 1024.0) / r.seconds,
+        total > 0 ? r.cpuSeconds * 1e6 / total : 0.0,
+        r.failed);
+}
+
+int main(int argc, char* argv[]) {
+    long requests = argc > 1 ? atol(argv[1]) : 20000;
+    int concurrency = argc > 2 ? atoi(argv[2]) : 64;
+    size_t pageBytes = argc > 3 ? (size_t)atol(argv[3]) : 16 * 1024;
+    if (requests < 1 || concurrency < 1) {
+        printf("Usage: %s [requests] [concurrency] [pageBytes]\n", argv[0]);
+        return 1;
+    }
+
+    LoopbackServer server(4, pageBytes);
+    if (!server.start()) {
+        printf("failed to start loopback server\n");
+        return 1;
+    }
+    printf("%ld requests, %d concurrent, %zu byte pages, server on 127.0.0.1:%d\n", requests, concurrency, pageBytes, server.getPort());
+
+    report("blocking", runThreaded(server.getPort(), requests, concurrency, false));
+
+    Socket probe;
+    if (probe.enableUring()) {
+        report("uring", runThreaded(server.getPort(), requests, concurrency, true));
+    }
+    else {
+        printf("uring     unavailable on this kernel\n");
+    }
+
+    report("epoll", runEpoll(server.getPort(), requests, concurrency));
+
+    server.stop();
+    return 0;
+}
@@ -0,0 +1,201 @@
+// URL parsing cost per URL: the old std::regex parseURL versus the hand-written
+// single pass, plus a differential run over the same corpus that fails on any
+// disagreement not explained by the new parser's intended behavior changes.
+// Allocations are counted through a replaced global operator new.
+//
+// usage: bench_url_parser [urls-file]
+
+#include "Utility.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <random>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::atomic<long> allocations(0);
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// the parser as it was before, except that an overlong port no longer escapes as out_of_range
+static bool legacyParseURL(const std::string& url, std::string& scheme, std::string& host, int& port, std::string& request) {
+    std::regex urlRegex(R"(^([a-zA-Z][a-zA-Z0-9+.-]*)://([^/:]+)(?::(\d+))?(?:(/.*)?)?)");
+    std::smatch matches;
+
+    if (std::regex_match(url, matches, urlRegex)) {
+        if ((scheme = matches[1].str()) != "http") {
+            return false;
+        }
+        host = matches[2].str();
+
+        if (matches[3].matched) {
+            try {
+                port = std::stoi(matches[3].str());
+                if (port <= 0 || port > 65535) {
+                    return false;
+                }
+            }
+            catch (const std::logic_error&) {
+                return false;
+            }
+        }
+        else {
+            port = 80;
+        }
+
+        request = matches[4].length() > 0 ? matches[4].str() : "/";
+        return true;
+    }
+    return false;
+}
+
+static std::vector<std::string> syntheticCorpus(size_t count) {
+    static const char* schemes[] = { "http", "http", "http", "http", "https", "HTTP", "ftp" };
+    static const char* hosts[] = { "www.example.com", "tamu.edu", "a.b.c.d.example.org", "WWW.Example.COM",
+        "192.168.0.1", "[2001:db8::1]", "user:pw@host.net", "", "host.example.com?x=1", "host.example.com#top" };
+    static const char* ports[] = { "", "", "", ":80", ":8080", ":0", ":65536", ":abc", ":", ":0000080", ":123456789012" };
+    static const char* paths[] = { "", "/", "/index.html", "/a/b/c?q=1&r=2", "/search?q=crawler#results",
+        "/path/with:colon", "/very/long/path/to/some/resource/that/goes/on/page.php?id=123456&session=abcdef" };
+
+    std::mt19937 rng(7);
+    std::vector<std::string> urls;
+    urls.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        std::string url = schemes[rng() % 7];
+        url += "://";
+        url += hosts[rng() % 10];
+        url += ports[rng() % 11];
+        url += paths[rng() % 7];
+        urls.push_back(url);
+    }
+    return urls;
+}
+
+// why the new parser disagrees with the regex on purpose, nullptr if it should not
+static const char* intendedDifference(const std::string& url) {
+    size_t authority = url.find("://");
+    if (authority == std::string::npos) {
+        return nullptr;
+    }
+    authority += 3;
+    size_t slash = url.find('/', authority);
+    std::string head = url.substr(0, slash);
+    if (head.find('@') != std::string::npos) {
+        return "userinfo";
+    }
+    if (head.find('[') != std::string::npos) {
+        return "ipv6 literal";
+    }
+    if (head.find('?') != std::string::npos || head.find('#') != std::string::npos) {
+        return "authority ends at ? or #";
+    }
+    if (url.find('#') != std::string::npos) {
+        return "fragment dropped";
+    }
+    for (size_t i = 0; i < head.size(); i++) {
+        if (head[i] >= 'A' && head[i] <= 'Z') {
+            return "case-insensitive scheme and host";
+        }
+    }
+    size_t colon = head.find(':', authority);
+    if (colon != std::string::npos && head.size() - colon - 1 > 5) {
+        return "port over 5 digits";
+    }
+    return nullptr;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> urls;
+    if (argc > 1) {
+        std::ifstream in(argv[1]);
+        std::string line;
+        while (std::getline(in, line)) {
+            urls.push_back(line);
+        }
+        if (urls.empty()) {
+            printf("no URLs in %s\n", argv[1]);
+            return 1;
+        }
+    }
+    else {
+        urls = syntheticCorpus(200000);
+    }
+
+    // differential pass
+    long matched = 0, intended = 0, unexpected = 0;
+    std::string scheme, host, request;
+    std::map<std::string, long> reasons;
+    URLParts parts;
+    for (const std::string& url : urls) {
+        int port = 0;
+        bool oldOk = legacyParseURL(url, scheme, host, port, request);
+        bool newOk = parseURL(url, parts);
+        if (oldOk == newOk && (!oldOk || (parts.host == host && parts.port == port && parts.request == request))) {
+            matched++;
+        }
+        else if (const char* reason = intendedDifference(url)) {
+            reasons[reason]++;
+            intended++;
+        }
+        else {
+            if (unexpected++ < 10) {
+                printf("mismatch: %s\n  regex %d host '%s' port %d request '%s'\n  parser %d host '%.*s' port %d request '%.*s'\n",
+                    url.c_str(), oldOk, host.c_str(), port, request.c_str(), newOk, (int)parts.host.size(),
+                    parts.host.data(), parts.port, (int)parts.request.size(), parts.request.data());
+            }
+        }
+    }
+    printf("differential: %ld identical, %ld intended differences, %ld unexpected\n", matched, intended, unexpected);
+    for (const auto& reason : reasons) {
+        printf("  %-34s %ld\n", reason.first.c_str(), reason.second);
+    }
+
+    // timing, regex first
+    auto start = std::chrono::steady_clock::now();
+    long accepted = 0;
+    for (const std::string& url : urls) {
+        int port;
+        accepted += legacyParseURL(url, scheme, host, port, request);
+    }
+    double regexSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const int rounds = 20;
+    long before = allocations.load();
+    start = std::chrono::steady_clock::now();
+    long parsed = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (const std::string& url : urls) {
+            parsed += parseURL(url, parts);
+        }
+    }
+    double parserSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long parserAllocations = allocations.load() - before;
+
+    printf("regex   %9.1f ns/url (%ld of %zu accepted)\n", regexSeconds * 1e9 / urls.size(), accepted, urls.size());
+    printf("parser  %9.1f ns/url (%ld of %zu accepted), %ld allocations\n", parserSeconds * 1e9 / (urls.size() * rounds),
+        parsed / rounds, urls.size(), parserAllocations);
+
+    return (unexpected == 0 && parserAllocations == 0) ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+// the cost --warc puts on a fetch worker: how long WarcWriter::add takes from
+// several producer threads at once, while the writer thread gzips and writes
+// behind them. one run has room to queue everything and must archive every
+// fetch, with each file read back and its response records counted; the other
+// has a queue budget of a few pages and must drop, never block, with every
+// fetch either archived or counted as dropped
+//
+// usage: bench_warc_writer [fetchesPerThread] [threads] [pageBytes]
+
+#include "WarcWriter.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WINCRAWL_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+struct Result {
+    long pushed = 0;
+    double pushSeconds = 0;
+    double drainSeconds = 0;
+    std::vector<uint64_t> addNanos;  // every add, all threads
+};
+
+static std::string makePage(size_t bytes) {
+    std::string body = "<html><body>\n";
+    for (int i = 0; body.size() < bytes; i++) {
+        body += "<p>archived text, line " + std::to_string(i) + " <a href=\"/link" + std::to_string(i) + ".html\">link</a></p>\n";
+    }
+    body.resize(bytes);
+    return "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static Result run(WarcWriter& writer, int numThreads, long fetches, const std::string& page) {
+    Result result;
+    std::vector<std::vector<uint64_t>> nanos(numThreads);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&writer, &nanos, &page, t, fetches] {
+            nanos[t].reserve(fetches);
+            in_addr addr;
+            addr.s_addr = htonl(0x7f000001 + t);
+            for (long i = 0; i < fetches; i++) {
+                std::string host = "h" + std::to_string(t) + ".bench";
+                std::string path = "/p" + std::to_string(i) + ".html";
+                auto before = std::chrono::steady_clock::now();
+                writer.add(host, 80, path, addr, 1000 + i % 500, page);
+                nanos[t].push_back((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count());
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    auto pushed = std::chrono::steady_clock::now();
+    writer.close();
+    auto drained = std::chrono::steady_clock::now();
+
+    result.pushed = fetches * numThreads;
+    result.pushSeconds = std::chrono::duration<double>(pushed - start).count();
+    result.drainSeconds = std::chrono::duration<double>(drained - pushed).count();
+    for (std::vector<uint64_t>& own : nanos) {
+        result.addNanos.insert(result.addNanos.end(), own.begin(), own.end());
+    }
+    std::sort(result.addNanos.begin(), result.addNanos.end());
+    return result;
+}
+
+static uint64_t percentile(const std::vector<uint64_t>& sorted, double percent) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * percent / 100))];
+}
+
+static std::vector<std::string> listFiles(const std::string& dir) {
+    std::vector<std::string> files;
+    if (DIR* handle = opendir(dir.c_str())) {
+        while (dirent* entry = readdir(handle)) {
+            if (entry->d_name[0] != '.') {
+                files.push_back(dir + "/" + entry->d_name);
+            }
+        }
+        closedir(handle);
+    }
+    return files;
+}
+
+// response records across dir's files, read back through gzip when built with it
+static long countResponses(const std::string& dir) {
+    static const std::string marker = "WARC-Type: response\r\n";
+    long responses = 0;
+    std::vector<char> buffer(1 << 20);
+    for (const std::string& name : listFiles(dir)) {
+        std::string text;
+#ifdef WINCRAWL_HAVE_ZLIB
+        gzFile file = gzopen(name.c_str(), "rb");  // reads every gzip member in turn
+        if (!file) {
+            return -1;
+        }
+        int n;
+        while ((n = gzread(file, buffer.data(), (unsigned)buffer.size())) > 0) {
+            text.append(buffer.data(), n);
+        }
+        gzclose(file);
+#else
+        FILE* file = fopen(name.c_str(), "rb");
+        if (!file) {
+            return -1;
+        }
+        size_t n;
+        while ((n = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+            text.append(buffer.data(), n);
+        }
+        fclose(file);
+#endif
+        for (size_t pos = text.find(marker); pos != std::string::npos; pos = text.find(marker, pos + marker.size())) {
+            responses++;
+        }
+    }
+    return responses;
+}
+
+static void removeDir(const std::string& dir) {
+    for (const std::string& name : listFiles(dir)) {
+        unlink(name.c_str());
+    }
+    rmdir(dir.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    long fetches = argc > 1 ? atol(argv[1]) : 20000;
+    int numThreads = argc > 2 ? atoi(argv[2]) : 8;
+    size_t pageBytes = argc > 3 ? (size_t)atol(argv[3]) : 16384;
+    std::string page = makePage(pageBytes);
+
+    printf("%d producer threads, %ld fetches each, %zu byte pages\n", numThreads, fetches, page.size());
+    printf("%-8s %9s %9s %8s %9s %9s %9s %8s %8s %9s\n", "queue", "pushed", "archived", "dropped", "add p50", "add p99", "add max", "push s", "drain s",
+        "MB out");
+
+    bool ok = true;
+    struct Case {
+        const char* name;
+        size_t queueBytes;
+    };
+    // ample: everything fits; tight: about four pages
+    const Case cases[] = { { "ample", (size_t)8 << 30 }, { "tight", page.size() * 4 } };
+    for (const Case& c : cases) {
+        std::string dir = "bench-warc-" + std::to_string(getpid()) + "-" + c.name;
+        mkdir(dir.c_str(), 0755);
+        WarcWriter writer(dir + "/w", 64 << 20, c.queueBytes, false);
+        if (!writer.start()) {
+            printf("Cannot write to %s\n", dir.c_str());
+            return 1;
+        }
+        Result result = run(writer, numThreads, fetches, page);
+
+        printf("%-8s %9ld %9ld %8ld %7lluns %7lluns %7lluus %8.2f %8.2f %9.1f\n", c.name, result.pushed, writer.getFetches(), writer.getDropped(),
+            (unsigned long long)percentile(result.addNanos, 50), (unsigned long long)percentile(result.addNanos, 99),
+            (unsigned long long)(result.addNanos.back() / 1000), result.pushSeconds, result.drainSeconds, writer.getBytesWritten() / (1024.0 * 1024.0));
+
+        long responses = countResponses(dir);
+        if (writer.getFetches() + writer.getDropped() != result.pushed || responses != writer.getFetches() || writer.getQueuedBytes() != 0) {
+            printf("  %s: %ld archived + %ld dropped of %ld, %ld responses read back, %lld bytes still queued\n", c.name, writer.getFetches(),
+                writer.getDropped(), result.pushed, responses, writer.getQueuedBytes());
+            ok = false;
+        }
+        if (c.queueBytes > page.size() * result.pushed * 2 && writer.getDropped() != 0) {
+            printf("  %s: dropped fetches with room to queue them all\n", c.name);
+            ok = false;
+        }
+        removeDir(dir);
+    }
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
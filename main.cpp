@@ -4,88 +4,142 @@
 #include "Socket.h"
 #include "pch.h"
 #include "Crawler.h"
+#include "Options.h"
 
-#include <windows.h>
-
-#pragma comment(lib, "Ws2_32.lib")
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <system_error>
 
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        printf("Usage: %s <numThreads> <inputFilePath>\n", argv[0]);
-        return 1;
-    }
-
-    int numThreads = atoi(argv[1]);
-    if (numThreads < 1) {
-        printf("Invalid number of threads\n");
+    CrawlerOptions options;
+    if (!parseOptions(argc, argv, options)) {
         return 1;
     }
+    int numThreads = options.numThreads;
 
+#ifdef _WIN32
     // initialize Winsock once
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
         printf("WSAStartup error %d\n", WSAGetLastError());
         return 1;
     }
+#endif
+
+#ifdef __linux__
+    // probe once so a kernel without io_uring degrades to one message, not one per thread
+    if (options.io == IOBackend::Uring) {
+        Socket probe;
+        if (!probe.enableUring()) {
+            printf("io_uring unavailable, using blocking sockets\n");
+            options.io = IOBackend::Blocking;
+        }
+    }
+#endif
 
-    Crawler crawler(numThreads);
+    Crawler crawler(options);
 
-    crawler.ReadFile(argv[2]);
+    crawler.ReadFile(options.inputFile);
 
-    // start stats thread
-    HANDLE statsThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)Crawler::StatsThread, &crawler, 0, NULL);
-    if (statsThread == NULL) {
-        printf("Error creating stats thread: %d\n", GetLastError());
-        WSACleanup();
-        return 1;
+    // start the seed producer and stats threads
+    std::thread seedThread;
+    std::thread statsThread;
+    try {
+        seedThread = std::thread(Crawler::SeedThread, &crawler);
+        statsThread = std::thread(Crawler::StatsThread, &crawler);
+    }
+    catch (const std::system_error& e) {
+        printf("Error creating producer or stats thread: %s\n", e.what());
+        exit(1); // a thread that did start is still joinable, so do not unwind
+    }
+
+    // scrapes only read atomics, so the endpoint can run for the whole crawl
+    MetricsServer metrics([&crawler](std::vector<Metric>& out) { crawler.collectMetrics(out); });
+    if (options.metricsPort > 0) {
+        if (metrics.start(options.metricsAddress, options.metricsPort)) {
+            printf("Serving metrics on http://%s:%d/metrics\n", options.metricsAddress.c_str(), options.metricsPort);
+        }
+        else {
+            printf("Cannot listen on %s:%d, metrics disabled\n", options.metricsAddress.c_str(), options.metricsPort);
+        }
     }
 
     // start N crawling threads
-    HANDLE* threadHandles = new HANDLE[numThreads];
+    std::vector<std::thread> threadHandles;
+    threadHandles.reserve(numThreads);
     for (int i = 0; i < numThreads; i++) {
-        threadHandles[i] = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)Crawler::CrawlerThread, &crawler, 0, NULL);
-        if (threadHandles[i] == NULL) {
-            printf("Error creating crawling thread %d: %d\n", i, GetLastError());
-            // clean up
-            for (int j = 0; j < i; ++j) {
-                CloseHandle(threadHandles[j]);
+        try {
+#ifdef __linux__
+            if (options.engine == EngineMode::Epoll) {
+                threadHandles.emplace_back(Crawler::EventThread, &crawler, i, options.maxConnections);
+                continue;
+            }
+#endif
+            threadHandles.emplace_back(Crawler::CrawlerThread, &crawler, i);
+        }
+        catch (const std::system_error& e) {
+            printf("Error creating crawling thread %d: %s\n", i, e.what());
+            // threads that never started still count as active; let the rest drain the queue
+            for (int j = i; j < numThreads; j++) {
+                crawler.decrementActiveThreads();
             }
-            delete[] threadHandles;
-            CloseHandle(statsThread);
-            WSACleanup();
-            return 1;
+            break;
         }
     }
 
-    // wait for crawling threads to finish
-    for (int i = 0; i < numThreads; i++) {
-        WaitForSingleObject(threadHandles[i], INFINITE);
-        CloseHandle(threadHandles[i]);
+    // wait for crawling threads to finish; they only do once the producer has closed the queues
+    for (std::thread& t : threadHandles) {
+        t.join();
     }
+    seedThread.join();
 
     // signal stats thread to quit and wait for termination
     crawler.signalShutdown();
-    WaitForSingleObject(statsThread, INFINITE);
-    CloseHandle(statsThread);
-        
+    statsThread.join();
+    metrics.stop();
+
     // get end time
-    LARGE_INTEGER endTime;
-    QueryPerformanceCounter(&endTime);
-    double totalTime = (double)(endTime.QuadPart - crawler.getStartTime().QuadPart) / crawler.getFrequency().QuadPart;
+    auto endTime = std::chrono::steady_clock::now();
+    double totalTime = std::chrono::duration<double>(endTime - crawler.getStartTime()).count();
 
     // print final summary
-    printf("Extracted %ld URLs @ %.0f/s\n", crawler.getExtractedURLs(), crawler.getExtractedURLs() / totalTime);
-    printf("Looked up %ld DNS names @ %.0f/s\n", crawler.getUniqueHosts(), crawler.getUniqueHosts() / totalTime);
-    printf("Attempted %ld site robots @ %.0f/s\n", crawler.getUniqueIPs(), crawler.getUniqueIPs() / totalTime);
-    printf("Crawled %ld pages @ %.0f/s (%.2f MB)\n", crawler.getPagesCrawled(), crawler.getPagesCrawled() / totalTime, crawler.getTotalBytes() / (1024.0 * 1024.0));
-    printf("Parsed %ld links @ %.0f/s\n", crawler.getTotalLinks(), crawler.getTotalLinks() / totalTime);
-    printf("HTTP codes: 2xx = %ld, 3xx = %ld, 4xx = %ld, 5xx = %ld, other = %ld\n", crawler.getHttp2xx(), crawler.getHttp3xx(), crawler.getHttp4xx(), crawler.getHttp5xx(), crawler.getHttpOther());
-
-    // printf("Pages with TAMU.edu links: %ld\n", crawler.getTamuLinkPages());
-    // printf(" - Originating from outside TAMU: %ld\n", crawler.getTamuLinkPagesExternal());
-    // cleanup
-    // delete[] threadHandles;
+    auto get = [&crawler](Counter counter) { return (long long)crawler.getCounter(counter); };
+    printf("Extracted %lld URLs @ %.0f/s\n", get(Counter::ExtractedURLs), get(Counter::ExtractedURLs) / totalTime);
+    printf("Looked up %lld DNS names @ %.0f/s\n", get(Counter::UniqueHosts), get(Counter::UniqueHosts) / totalTime);
+    printf("Attempted %lld site robots @ %.0f/s\n", get(Counter::UniqueIPs), get(Counter::UniqueIPs) / totalTime);
+    printf("Crawled %lld pages @ %.0f/s (%.2f MB)\n", get(Counter::PagesCrawled), get(Counter::PagesCrawled) / totalTime, get(Counter::TotalBytes) / (1024.0 * 1024.0));
+    printf("Parsed %lld links @ %.0f/s\n", get(Counter::TotalLinks), get(Counter::TotalLinks) / totalTime);
+    if (options.maxDepth > 0) {
+        printf("Frontier queued %ld links, dropped %ld\n", crawler.getFrontierInserted(), crawler.getFrontierDropped());
+    }
+    if (const WarcWriter* warc = crawler.getWarc()) {
+        printf("Archived %ld fetches in %ld WARC files (%.2f MB, %ld dropped)\n", warc->getFetches(), warc->getFiles(), warc->getBytesWritten() / (1024.0 * 1024.0),
+            warc->getDropped());
+    }
+    printf("HTTP codes: 2xx = %lld, 3xx = %lld, 4xx = %lld, 5xx = %lld, other = %lld\n", get(Counter::Http2xx), get(Counter::Http3xx), get(Counter::Http4xx),
+        get(Counter::Http5xx), get(Counter::HttpOther));
+
+    // each stage's whole distribution over the run
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        LatencySnapshot latency = crawler.getLatency((Stage)stage);
+        if (latency.getCount() == 0) {
+            continue;
+        }
+        printf("Latency %-8s n=%-8llu mean %-7s p50 %-7s p75 %-7s p90 %-7s p95 %-7s p99 %-7s p99.9 %-7s max %s\n", Crawler::stageName((Stage)stage),
+            (unsigned long long)latency.getCount(), formatLatency((uint64_t)latency.getMean()).c_str(), formatLatency(latency.percentile(50)).c_str(),
+            formatLatency(latency.percentile(75)).c_str(), formatLatency(latency.percentile(90)).c_str(), formatLatency(latency.percentile(95)).c_str(),
+            formatLatency(latency.percentile(99)).c_str(), formatLatency(latency.percentile(99.9)).c_str(), formatLatency(latency.getMax()).c_str());
+    }
+
+    const DomainMatcher& domains = crawler.getDomains();
+    for (int set = 0; set < domains.getSetCount(); set++) {
+        DomainHits hits = crawler.getDomainHits(set);
+        printf("Links into %s: %ld, on %ld pages (%ld from outside it)\n", domains.getSetName(set).c_str(), hits.links, hits.pages, hits.externalPages);
+    }
+#ifdef _WIN32
     WSACleanup();
+#endif
 
     return 0;
 }
\ No newline at end of file
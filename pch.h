@@ -10,7 +10,9 @@
 // add headers that you want to pre-compile here
 
 #include <stdio.h>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #include "HTMLParserBase.h"
 